@@ -128,6 +128,8 @@ namespace ngcomp
     geom_free = flags.GetDefineFlag("geom_free");    
     if (spd) symmetric = true;
     SetCheckUnused (!flags.GetDefineFlagX("check_unused").IsFalse());
+    store_positions = flags.GetDefineFlag ("store_positions");
+    simd_ebe = flags.GetDefineFlag ("simd_ebe");
   }
 
 
@@ -184,6 +186,8 @@ namespace ngcomp
     precompute = flags.GetDefineFlag ("precompute");
     checksum = flags.GetDefineFlag ("checksum");
     SetCheckUnused (!flags.GetDefineFlagX("check_unused").IsFalse());    
+    store_positions = flags.GetDefineFlag ("store_positions");
+    simd_ebe = flags.GetDefineFlag ("simd_ebe");
   }
 
 
@@ -367,6 +371,144 @@ namespace ngcomp
   }
 
 
+  void ElementPositions :: Reset (const MeshAccess & ma)
+  {
+    for (VorB vb : { VOL, BND, BBND, BBBND })
+      {
+        size_t ne = ma.GetNE(vb);
+        data[vb] = Array<Array<int>> (ne);
+        state[vb].SetSize (ne);
+        state[vb] = 0;
+      }
+  }
+
+  FlatArray<int> ElementPositions :: Get (ElementId ei, FlatArray<int> dnums1, FlatArray<int> dnums2,
+                                          const function<void(FlatArray<int>)> & calcpos)
+  {
+    VorB vb = ei.VB();
+    size_t nr = ei.Nr();
+    if (nr >= state[vb].Size()) return FlatArray<int> (0, nullptr);
+
+    size_t n1 = dnums1.Size(), n2 = dnums2.Size();
+    int & st = state[vb][nr];
+
+    if (AsAtomic(st).load(memory_order_acquire) == 2)
+      {
+        FlatArray<int> rec = data[vb][nr];
+        if (size_t(rec[0]) != n1 || size_t(rec[1]) != n2)
+          return FlatArray<int> (0, nullptr);
+        for (size_t i = 0; i < n1; i++)
+          if (rec[2+i] != dnums1[i]) return FlatArray<int> (0, nullptr);
+        for (size_t i = 0; i < n2; i++)
+          if (rec[2+n1+i] != dnums2[i]) return FlatArray<int> (0, nullptr);
+        return rec.Range(2+n1+n2, rec.Size());
+      }
+
+    // first assembly of the element, only one thread creates the entry
+    int expected = 0;
+    if (!AsAtomic(st).compare_exchange_strong (expected, 1))
+      return FlatArray<int> (0, nullptr);
+
+    Array<int> rec(2+n1+n2+n1*n2);
+    rec[0] = n1;
+    rec[1] = n2;
+    rec.Range(2, 2+n1) = dnums1;
+    rec.Range(2+n1, 2+n1+n2) = dnums2;
+    calcpos (rec.Range(2+n1+n2, rec.Size()));
+    data[vb][nr] = move(rec);
+    AsAtomic(st).store(2, memory_order_release);
+
+    FlatArray<int> stored = data[vb][nr];
+    return stored.Range(2+n1+n2, stored.Size());
+  }
+
+
+  // order independent hash of an element-dof table
+  static size_t HashTable (const Table<int> & table)
+  {
+    auto mix = [] (uint64_t x)
+      {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+      };
+    return ParallelReduce (table.Size(),
+                           [&] (size_t i)
+                           {
+                             uint64_t h = mix (uint64_t(i) ^ (uint64_t(table[i].Size()) << 40));
+                             for (int d : table[i])
+                               h += mix ((uint64_t(i) << 32) ^ uint32_t(d));
+                             return h;
+                           },
+                           [] (uint64_t a, uint64_t b) { return a+b; },
+                           uint64_t(0)) + table.Size();
+  }
+
+  /*
+    Graphs shared by BilinearForms with the same element tables
+    (e.g. mass and stiffness matrix on the same space). The hash selects
+    candidates, a graph is reused only if it contains all (row,col) pairs
+    of the element tables, so a changed space (refinement, order,
+    definedon) never finds an outdated graph. The tables are not kept.
+    The cache holds weak pointers only, the graph is released with the
+    last matrix using it.
+  */
+  struct GraphCacheEntry
+  {
+    size_t height, width;
+    bool square, symmetric;
+    size_t hash;
+    weak_ptr<MatrixGraph> graph;
+  };
+  static mutex graph_cache_mutex;
+  static Array<GraphCacheEntry> graph_cache;
+
+  // does the graph contain all couplings of the element tables ?
+  static bool GraphContains (const MatrixGraph & graph, const Table<int> & rowtable,
+                             const Table<int> & coltable, bool symmetric)
+  {
+    atomic<bool> contains(true);
+    ParallelForRange (rowtable.Size(), [&] (IntRange r)
+                      {
+                        for (auto i : r)
+                          {
+                            if (!contains) return;
+                            for (int row : rowtable[i])
+                              for (int col : coltable[i])
+                                if ((!symmetric || col <= row) &&
+                                    graph.GetPositionTest (row, col) == numeric_limits<size_t>::max())
+                                  {
+                                    contains = false;
+                                    return;
+                                  }
+                          }
+                      });
+    return contains;
+  }
+
+  static shared_ptr<MatrixGraph> FindGraph (const GraphCacheEntry & key,
+                                            const Table<int> & table, const Table<int> & table2)
+  {
+    for (size_t i = 0; i < graph_cache.Size(); )
+      {
+        auto & entry = graph_cache[i];
+        auto cached = entry.graph.lock();
+        if (!cached)
+          {
+            graph_cache.DeleteElement(i);
+            continue;
+          }
+        if (entry.height == key.height && entry.width == key.width && entry.square == key.square &&
+            entry.symmetric == key.symmetric && entry.hash == key.hash &&
+            cached->Size() == key.height &&
+            GraphContains (*cached, key.square ? table : table2, table, key.symmetric))
+          return cached;
+        i++;
+      }
+    return nullptr;
+  }
+
   MatrixGraph BilinearForm :: GetGraph (int level, bool symmetric)
   {
     static Timer timer ("BilinearForm::GetGraph");
@@ -512,18 +654,9 @@ namespace ngcomp
 
       }
     
-    MatrixGraph * graph;
-
-    if (!fespace2)
-      {
-        /*
-        graph = new MatrixGraph (ndof, *creator.GetTable(), *creator.GetTable(), symmetric);
-        delete creator.GetTable();
-        */
-        auto table = creator.MoveTable();
-        graph = new MatrixGraph (ndof, ndof, table, table, symmetric);        
-      }
-    else
+    auto table = creator.MoveTable();
+    Table<int> table2;
+    if (fespace2)
       {
         TableCreator<int> creator2(maxind);
         for ( ; !creator2.Done(); creator2++)
@@ -580,20 +713,38 @@ namespace ngcomp
                 }
               }
 	  }
+        table2 = creator2.MoveTable();
+      }
 
-        /*
-        graph = new MatrixGraph (fespace2->GetNDof(), *creator2.GetTable(), *creator.GetTable(), symmetric);        
-        delete creator.GetTable();
-        delete creator2.GetTable();
-        */
-        auto table = creator.MoveTable();
-        auto table2 = creator2.MoveTable();
-        graph = new MatrixGraph (fespace2->GetNDof(), fespace->GetNDof(),
-                                 table2, table, symmetric);
+    // the graph of the element tables is shared by all forms with the same tables
+    size_t height = fespace2 ? fespace2->GetNDof() : ndof;
+    size_t hash = HashTable (table);
+    if (fespace2) hash += 31 * HashTable (table2);
+
+    GraphCacheEntry key { height, ndof, !fespace2, symmetric, hash };
+    shared_ptr<MatrixGraph> graph;
+    {
+      lock_guard<mutex> guard(graph_cache_mutex);
+      graph = FindGraph (key, table, table2);
+    }
+
+    if (!graph)
+      {
+        // build outside the lock, another form may have inserted an equal graph meanwhile
+        auto newgraph = make_shared<MatrixGraph> (height, ndof, fespace2 ? table2 : table, table, symmetric);
+        newgraph->FindSameNZE();
+        lock_guard<mutex> guard(graph_cache_mutex);
+        graph = FindGraph (key, table, table2);
+        if (!graph)
+          {
+            graph = newgraph;
+            key.graph = graph;
+            graph_cache.Append (key);
+          }
       }
-    
-    graph -> FindSameNZE();
-    return move(*graph);
+
+    // the arrays are used without copying, the matrix keeps the cached graph alive
+    return MatrixGraph (ndof, graph->GetFirstArray(), graph->GetColIndices(), graph);
   }
 
 
@@ -940,6 +1091,20 @@ namespace ngcomp
   S_BilinearForm<SCAL> :: ~S_BilinearForm () { ; }
 
   
+  template <class SCAL>
+  void S_BilinearForm<SCAL> :: FinalizeElementByElementMatrices ()
+  {
+    // regroup the element matrices for the batched application, on request
+    if (!simd_ebe) return;
+    if (mats.Size())
+      if (auto ebe = dynamic_pointer_cast<ElementByElementMatrix<SCAL>> (mats.Last()))
+        ebe->Finalize();
+
+    if (eliminate_internal && keep_internal && harmonicext)
+      for (auto ebe : { harmonicext_ptr, harmonicexttrans_ptr, innersolve_ptr, innermatrix_ptr })
+        if (ebe) ebe->Finalize();
+  }
+
   template <class SCAL>
   void S_BilinearForm<SCAL> :: AllocateInternalMatrices ()
   {
@@ -2974,6 +3139,8 @@ namespace ngcomp
         if (checksum)
           cout << "|matrix| = " 
                << setprecision(16) << L2Norm (GetMatrix().AsVector()) << endl;
+
+        FinalizeElementByElementMatrices();
       }
     catch (Exception & e)
       {
@@ -3765,6 +3932,8 @@ namespace ngcomp
              << ", unused = " << useddof.Size()-cntused
              << ", total = " << useddof.Size() << endl;
 
+        FinalizeElementByElementMatrices();
+
         for (int j = 0; j < preconditioners.Size(); j++)
           preconditioners[j] -> FinalizeLevel(&GetMatrix());
       }
@@ -5834,6 +6003,8 @@ namespace ngcomp
     MatrixGraph graph = this->GetGraph (this->ma->GetNLevels()-1, false);
 
     auto spmat = make_shared<SparseMatrix<TM,TV,TV>> (graph, 1);
+    if (this->store_positions)
+      this->elmat_positions.Reset (*this->ma);
     this->GetMemoryTracer().Track(*spmat, "mymatrix");
     mymatrix = spmat; // .get();
     
@@ -5935,6 +6106,17 @@ namespace ngcomp
                     ElementId id,
                     LocalHeap & lh) 
   {
+    if (this->store_positions)
+      {
+        auto pos = this->elmat_positions.Get
+          (id, dnums1, dnums2, [&] (FlatArray<int> pos)
+           { mymatrix -> GetElementPositions (dnums1, dnums2, false, pos); });
+        if (pos.Size())
+          {
+            mymatrix -> AddElementMatrixPositions (dnums1, pos, elmat, this->fespace->HasAtomicDofs());
+            return;
+          }
+      }
     mymatrix -> TMATRIX::AddElementMatrix (dnums1, dnums2, elmat, this->fespace->HasAtomicDofs());
   }
 
@@ -6012,6 +6194,8 @@ namespace ngcomp
     MatrixGraph graph = this->GetGraph (this->ma->GetNLevels()-1, true);
 
     auto spmat = make_shared<SparseMatrixSymmetric<TM,TV>> (graph, 1);
+    if (this->store_positions)
+      this->elmat_positions.Reset (*this->ma);
     mymatrix = spmat; // .get();
     this->GetMemoryTracer().Track(*spmat, "mymatrix");
     
@@ -6078,6 +6262,17 @@ namespace ngcomp
                     ElementId id, 
                     LocalHeap & lh) 
   {
+    if (this->store_positions)
+      {
+        auto pos = this->elmat_positions.Get
+          (id, dnums1, dnums1, [&] (FlatArray<int> pos)
+           { mymatrix -> GetElementPositions (dnums1, dnums1, true, pos); });
+        if (pos.Size())
+          {
+            mymatrix -> AddElementMatrixPositions (dnums1, pos, elmat, this->fespace->HasAtomicDofs());
+            return;
+          }
+      }
     mymatrix -> TMATRIX::AddElementMatrixSymmetric (dnums1, elmat, this->fespace->HasAtomicDofs());
   }
 
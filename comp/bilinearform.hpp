@@ -13,6 +13,26 @@ namespace ngcomp
   class LinearForm;
   class Preconditioner;
 
+
+  /**
+     Positions of the element matrices in the sparse matrix, kept for
+     reassembly on the same graph. An element stores the positions for the
+     dof-numbers of its first assembly, other dof-numbers with the same
+     ElementId use the search of AddElementMatrix.
+  */
+  class NGS_DLL_HEADER ElementPositions
+  {
+    /// per element: n1, n2, dnums1, dnums2, positions
+    Array<Array<int>> data[4];
+    /// 0 .. empty, 1 .. in construction, 2 .. ready
+    Array<int> state[4];
+  public:
+    void Reset (const MeshAccess & ma);
+    /// stored positions, or positions calculated by calcpos. empty if not available
+    FlatArray<int> Get (ElementId ei, FlatArray<int> dnums1, FlatArray<int> dnums2,
+                        const function<void(FlatArray<int>)> & calcpos);
+  };
+
   /** 
       A bilinear-form.
       A bilinear-form provides the system matrix. 
@@ -50,6 +70,11 @@ namespace ngcomp
     double unuseddiag;
     /// check if all dofs declared used are used in assemble
     bool check_unused = true;
+    /// keep the positions of the element matrices for reassembly
+    bool store_positions = false;
+    ElementPositions elmat_positions;
+    /// element-by-element matrices are applied SIMD-batched
+    bool simd_ebe = false;
     /// low order bilinear-form, 0 if not used
     shared_ptr<BilinearForm> low_order_bilinear_form;
 
@@ -629,6 +654,8 @@ namespace ngcomp
 				    const SpecialElement * sel = NULL) const;
     */
     virtual void AllocateInternalMatrices ();
+    /// switch element-by-element matrices to the batched application
+    void FinalizeElementByElementMatrices ();
   };
 
 
@@ -4,119 +4,18 @@
 using namespace ngcomp;
 
 
-#include <core/concurrentqueue.h>
-
-typedef moodycamel::ConcurrentQueue<size_t> TQueue;
-typedef moodycamel::ProducerToken TPToken;
-typedef moodycamel::ConsumerToken TCToken;
-
-
 namespace ngcomp
 {
 
-  static TQueue queue;
-
-  template <typename TFUNC>
-  void RunParallelDependency (FlatTable<int> dag,
-                              TFUNC func)
+  // one timer per level, shows up in the profiling output
+  static Timer & H1AMGLevelTimer (size_t level)
   {
-    Array<atomic<int>> cnt_dep(dag.Size());
-
-    for (auto & d : cnt_dep)
-      d.store (0, memory_order_relaxed);
-
-    static Timer t_cntdep("count dep");
-    t_cntdep.Start();
-    ParallelFor (Range(dag),
-                 [&] (int i)
-                 {
-                   for (int j : dag[i])
-                     cnt_dep[j]++;
-                 });
-    t_cntdep.Stop();
-
-    atomic<size_t> num_ready(0), num_final(0);
-    ParallelForRange (cnt_dep.Size(), [&] (IntRange r)
-                      {
-                        size_t my_ready = 0, my_final = 0;
-                        for (size_t i : r)
-                          {
-                            if (cnt_dep[i] == 0) my_ready++;
-                            if (dag[i].Size() == 0) my_final++;
-                          }
-                        num_ready += my_ready;
-                        num_final += my_final;
-                      });
-
-    Array<int> ready(num_ready);
-    ready.SetSize0();
-    for (int j : Range(cnt_dep))
-      if (cnt_dep[j] == 0) ready.Append(j);
-
-
-    if (!task_manager)
-      // if (true)
-      {
-        while (ready.Size())
-          {
-            int size = ready.Size();
-            int nr = ready[size-1];
-            ready.SetSize(size-1);
-
-            func(nr);
-
-            for (int j : dag[nr])
-              {
-                cnt_dep[j]--;
-                if (cnt_dep[j] == 0)
-                  ready.Append(j);
-              }
-          }
-        return;
-      }
-
-    atomic<int> cnt_final(0);
-    SharedLoop2 sl(Range(ready));
-
-    task_manager -> CreateJob
-      ([&] (const TaskInfo & ti)
-       {
-         size_t my_final = 0;
-         TPToken ptoken(queue);
-         TCToken ctoken(queue);
-
-         for (int i : sl)
-           queue.enqueue (ptoken, ready[i]);
-
-         while (1)
-           {
-             if (cnt_final >= num_final) break;
-
-             int nr;
-             if(!queue.try_dequeue_from_producer(ptoken, nr))
-               if(!queue.try_dequeue(ctoken, nr))
-                 {
-                   if (my_final)
-                     {
-                       cnt_final += my_final;
-                       my_final = 0;
-                     }
-                   continue;
-                 }
-
-             if (dag[nr].Size() == 0)
-               my_final++;
-             // cnt_final++;
-
-             func(nr);
-
-             for (int j : dag[nr])
-               {
-                 if (--cnt_dep[j] == 0)
-                   queue.enqueue (ptoken, j);
-               }
-           }
-       });
+    static Array<shared_ptr<Timer>> timers;
+    static mutex m;
+    lock_guard<mutex> guard(m);
+    while (timers.Size() <= level)
+      timers.Append (make_shared<Timer> ("H1AMG - level " + ToString(timers.Size())));
+    return *timers[level];
   }
 
 
@@ -130,6 +29,14 @@ namespace ngcomp
   : mat(amat)
   {
       static Timer t("H1AMG"); RegionTimer reg(t);
+      static Timer tweights("H1AMG - collapse weights");
+      static Timer tmatch("H1AMG - matching");
+      static Timer tcoarse("H1AMG - coarse graph");
+      static Timer tsmoother("H1AMG - smoother");
+      static Timer tprol("H1AMG - prolongation");
+      static Timer trap("H1AMG - coarse matrix");
+      Timer & tlevel = H1AMGLevelTimer(level);
+      tlevel.Start();
 
       size_t num_edges = edge_weights.Size();
       size_t num_vertices = vertex_weights.Size();
@@ -138,10 +45,11 @@ namespace ngcomp
 
       size = mat->Height();
 
+      tweights.Start();
       Array<double> edge_collapse_weights(num_edges);
       Array<double> sum_vertex_weights(num_vertices);
-      for (auto i : Range(num_vertices))
-        sum_vertex_weights[i] = vertex_weights[i];
+      ParallelFor (num_vertices, [&] (size_t i)
+                   { sum_vertex_weights[i] = vertex_weights[i]; });
 
       ParallelFor (num_edges, [&] (size_t i)
                    {
@@ -156,29 +64,15 @@ namespace ngcomp
 
                      edge_collapse_weights[i] = edge_weights[i] * (vstr1+vstr2) / (vstr1 * vstr2);
                    });
-
-      // sort edges by collapse weights
-      /*
-      Array<int> indices(num_edges);
-      ParallelFor (num_edges, [&] (size_t edge)
-                   { indices[edge] = edge; });
-
-      SampleSortI(edge_collapse_weights, indices);
-
-      Array<size_t> invindices(num_edges);
-      ParallelFor (num_edges, [&] (size_t edge)
-                   {
-                     invindices[indices[edge]] = edge;
-                   });
-      */
+      tweights.Stop();
 
 
       // which edges to collapse ?
-
+      tmatch.Start();
       Array<bool> vertex_collapse(num_vertices);
       Array<bool> edge_collapse(num_edges);
-      edge_collapse = false;
-      vertex_collapse = false;
+      ParallelFor (num_vertices, [&] (size_t v) { vertex_collapse[v] = false; });
+      ParallelFor (num_edges, [&] (size_t e) { edge_collapse[e] = false; });
 
       TableCreator<int> v2e_creator(num_vertices);
       for ( ; !v2e_creator.Done(); v2e_creator++)
@@ -189,88 +83,169 @@ namespace ngcomp
                      });
       Table<int> v2e = v2e_creator.MoveTable();
 
-      /*
-      ParallelFor (v2e.Size(), [&] (size_t vnr)
-                   {
-                     // QuickSortI (invindices, v2e[vnr]);
-                     QuickSortI (edge_collapse_weights, v2e[vnr]);
-                   }, TasksPerThread(5));
-      */
+      // total order of the edges: collapse weight, then edge number
+      auto edge_less = [&edge_collapse_weights](size_t e1, size_t e2)
+        {
+          double w1 = edge_collapse_weights[e1], w2 = edge_collapse_weights[e2];
+          if (w1 == w2) return e1 < e2;
+          return w1 < w2;
+        };
 
       ParallelFor (v2e.Size(), [&] (size_t vnr)
                    {
-                     QuickSort (v2e[vnr], [&edge_collapse_weights](size_t e1, size_t e2)
-                                {
-                                  double w1 = edge_collapse_weights[e1], w2 = edge_collapse_weights[e2];
-                                  if (w1 == w2) return e1 < e2;
-                                  return w1 < w2;
-                                } );
+                     QuickSort (v2e[vnr], edge_less);
                    }, TasksPerThread(5));
 
-      // build edge dependency
-      TableCreator<int> edge_dag_creator(num_edges);
-      for ( ; !edge_dag_creator.Done(); edge_dag_creator++)
-        ParallelFor (v2e.Size(), [&] (size_t vnr)
-                     {
-                       auto vedges = v2e[vnr];
-                       for (int j = 0; j+1 < vedges.Size(); j++)
-                         edge_dag_creator.Add (vedges[j+1], vedges[j]);
-                     }, TasksPerThread(5));
-      Table<int> edge_dag = edge_dag_creator.MoveTable();
-
-      
       BitArray isolated_verts(num_vertices);
       isolated_verts.Clear();
-      for (size_t i = 0; i < num_vertices; i++)
-        if (sum_vertex_weights[i] <= 1.1 * vertex_weights[i] ||
-            (*freedofs)[i] == false)
-          isolated_verts.SetBit(i);
+      ParallelFor (num_vertices, [&] (size_t i)
+                   {
+                     if (sum_vertex_weights[i] <= 1.1 * vertex_weights[i] ||
+                         (*freedofs)[i] == false)
+                       isolated_verts.SetBitAtomic(i);
+                   });
 
-      
-      RunParallelDependency (edge_dag,
-                             [&] (int edgenr)
-                             {
-                               auto v0 = e2v[edgenr][0];
-                               auto v1 = e2v[edgenr][1];
-                               if (edge_collapse_weights[edgenr] >= 0.01 && !vertex_collapse[v0] && !vertex_collapse[v1]
-                                   && !isolated_verts[v0] && !isolated_verts[v1])
-                                 // && (*freedofs)[v0] && (*freedofs)[v1])
-                                 {
-                                   edge_collapse[edgenr] = true;
-                                   vertex_collapse[v0] = true;
-                                   vertex_collapse[v1] = true;
-                                 }
-                             });
-      edge_dag = Table<int>();
-
-      // collapse the larger vertex
-      vertex_collapse = false;
-      for (int e = 0; e < num_edges; e++)
-        if (edge_collapse[e])
-          {
-            auto v0 = e2v[e][0];
-            auto v1 = e2v[e][1];
-            vertex_collapse[max2(v0,v1)] = true;
-          }
+      auto collapsible = [&] (size_t edgenr)
+        {
+          auto v0 = e2v[edgenr][0];
+          auto v1 = e2v[edgenr][1];
+          return edge_collapse_weights[edgenr] >= 0.01
+            && !isolated_verts[v0] && !isolated_verts[v1];
+        };
+
+      /*
+        Parallel matching by rounds: every free vertex proposes its heaviest
+        collapsible edge to an unmatched neighbour, mutual proposals are matched.
+        The heaviest remaining edge is matched in every round, and the result is
+        the same as the greedy matching processing the edges by decreasing weight.
+        Only vertices whose proposed neighbour was matched propose again, and
+        their scan resumes where it stopped, edges never become valid again.
+      */
+      Array<int> proposal(num_vertices), scanpos(num_vertices), queued(num_vertices);
+      ParallelFor (num_vertices, [&] (size_t v)
+                   {
+                     proposal[v] = -1;
+                     scanpos[v] = v2e[v].Size();
+                     queued[v] = 0;
+                   });
+
+      Array<int> active, next(num_vertices), matched(num_vertices);
+      for (size_t v = 0; v < num_vertices; v++)
+        if (!isolated_verts[v])
+          active.Append (v);
+
+      while (active.Size())
+        {
+          ParallelFor (active.Size(), [&] (size_t i)
+                       {
+                         int v = active[i];
+                         auto vedges = v2e[v];
+                         int j = scanpos[v];
+                         proposal[v] = -1;
+                         while (j-- > 0)
+                           {
+                             int e = vedges[j];
+                             auto vother = e2v[e][0]+e2v[e][1]-v;
+                             if (collapsible(e) && !vertex_collapse[vother])
+                               {
+                                 proposal[v] = e;
+                                 break;
+                               }
+                           }
+                         scanpos[v] = j+1;
+                         queued[v] = 1;
+                       }, TasksPerThread(5));
+
+          // the partner may have kept its proposal from an earlier round
+          atomic<size_t> num_matched(0);
+          ParallelFor (active.Size(), [&] (size_t i)
+                       {
+                         int v = active[i];
+                         int e = proposal[v];
+                         if (e == -1) return;
+                         int u = e2v[e][0]+e2v[e][1]-v;
+                         if (proposal[u] != e) return;
+                         if (queued[u] && u < v) return;
+                         edge_collapse[e] = true;
+                         vertex_collapse[v] = true;
+                         vertex_collapse[u] = true;
+                         matched[num_matched++] = e;
+                       });
+          ParallelFor (active.Size(), [&] (size_t i) { queued[active[i]] = 0; });
+
+          // unmatched vertices which proposed to a matched vertex
+          atomic<size_t> num_next(0);
+          ParallelFor (num_matched.load(), [&] (size_t k)
+                       {
+                         int e = matched[k];
+                         for (int l = 0; l < 2; l++)
+                           {
+                             int v = e2v[e][l];
+                             for (int e2 : v2e[v])
+                               {
+                                 int w = e2v[e2][0]+e2v[e2][1]-v;
+                                 if (vertex_collapse[w] || proposal[w] != e2) continue;
+                                 if (AsAtomic(queued[w]).exchange(1) == 0)
+                                   next[num_next++] = w;
+                               }
+                           }
+                       });
+
+          active.SetSize (num_next);
+          ParallelFor (active.Size(), [&] (size_t i)
+                       {
+                         active[i] = next[i];
+                         queued[next[i]] = 0;
+                       });
+        }
+
+      // collapse the larger vertex, the matched edges are disjoint
+      ParallelFor (num_vertices, [&] (size_t v) { vertex_collapse[v] = false; });
+      ParallelFor (num_edges, [&] (size_t e)
+                   {
+                     if (edge_collapse[e])
+                       vertex_collapse[max2(e2v[e][0], e2v[e][1])] = true;
+                   });
 
 
-      // vertex 2 coarse vertex
+      // vertex 2 coarse vertex, numbered by prefix sums over blocks of vertices
       Array<size_t> v2cv(num_vertices);
-      size_t num_coarse_vertices = 0;
-      v2cv = -1;
-      for (size_t i = 0; i < num_vertices; i++)
-        if (!vertex_collapse[i] && !isolated_verts.Test(i))
-          v2cv[i] = num_coarse_vertices++;
-      for (size_t e = 0; e < num_edges; e++)
-        if (edge_collapse[e])
-          {
-            auto v0 = e2v[e][0];
-            auto v1 = e2v[e][1];
-            if (v0 > v1) Swap (v0,v1);
-            v2cv[v1] = v2cv[v0];
-          }
+      size_t num_blocks = min2(size_t(4 * TaskManager::GetNumThreads()),
+                               num_vertices+1);
+      Array<size_t> block_first(num_blocks+1);
+      ParallelFor (num_blocks, [&] (size_t b)
+                   {
+                     size_t cnt = 0;
+                     for (size_t i : Range(num_vertices).Split(b, num_blocks))
+                       if (!vertex_collapse[i] && !isolated_verts.Test(i))
+                         cnt++;
+                     block_first[b+1] = cnt;
+                   });
+      block_first[0] = 0;
+      for (size_t b = 0; b < num_blocks; b++)
+        block_first[b+1] += block_first[b];
+      size_t num_coarse_vertices = block_first[num_blocks];
+
+      ParallelFor (num_blocks, [&] (size_t b)
+                   {
+                     size_t cnt = block_first[b];
+                     for (size_t i : Range(num_vertices).Split(b, num_blocks))
+                       v2cv[i] = (!vertex_collapse[i] && !isolated_verts.Test(i)) ? cnt++ : -1;
+                   });
+      ParallelFor (num_edges, [&] (size_t e)
+                   {
+                     if (edge_collapse[e])
+                       {
+                         auto v0 = e2v[e][0];
+                         auto v1 = e2v[e][1];
+                         if (v0 > v1) Swap (v0,v1);
+                         v2cv[v1] = v2cv[v0];
+                       }
+                   });
+      tmatch.Stop();
 
       // edge to coarse edge
+      tcoarse.Start();
 
       Array<size_t> e2ce(num_edges);
 
@@ -357,9 +332,10 @@ namespace ngcomp
                     if (v2cv[v] != -1)
                       AtomicAdd(coarse_vertex_weights[v2cv[v]], vertex_weights[v]);
                   });
-
+      tcoarse.Stop();
 
       // build smoother
+      tsmoother.Start();
       TableCreator<int> smoothing_blocks_creator(num_coarse_vertices);
       for ( ; !smoothing_blocks_creator.Done(); smoothing_blocks_creator++)
         ParallelFor (v2cv.Size(), [&] (size_t v)
@@ -370,22 +346,29 @@ namespace ngcomp
 
       auto blocks = make_shared<Table<int>> (smoothing_blocks_creator.MoveTable());
       smoother = mat->CreateBlockJacobiPrecond(blocks);
+      tsmoother.Stop();
 
       // build prolongation
+      tprol.Start();
       Array<int> nne(num_vertices);
 
-      for (int i = 0; i < num_vertices; i++)
-        nne[i] = (v2cv[i] != -1) ? 1 : 0;
+      ParallelFor (num_vertices, [&] (size_t i)
+                   { nne[i] = (v2cv[i] != -1) ? 1 : 0; });
       prolongation = make_shared<SparseMatrix<double,SCAL,SCAL>> (nne, num_coarse_vertices);
-      for (int i = 0; i < num_vertices; i++)
-        if (v2cv[i] != -1)
-          (*prolongation)(i, v2cv[i]) = 1;
+      ParallelFor (num_vertices, [&] (size_t i)
+                   {
+                     if (v2cv[i] != -1)
+                       {
+                         prolongation->GetRowIndices(i)[0] = v2cv[i];
+                         prolongation->GetRowValues(i)(0) = 1;
+                       }
+                   });
 
       // smoothed prolongation
       if (level % 4 == 2)
         {
-          for (auto i : Range(num_vertices))
-            nne[i] = 1+v2e[i].Size();
+          ParallelFor (num_vertices, [&] (size_t i)
+                       { nne[i] = 1+v2e[i].Size(); });
 
           auto smoothprol = make_shared<SparseMatrix<double,SCAL,SCAL>> (nne, num_vertices);
           ParallelFor
@@ -413,7 +396,14 @@ namespace ngcomp
           prolongation = MatMult (*smoothprol, *prolongation);
         }
 
+      // restriction = TransposeMatrix (*prolongation);
+      restriction = dynamic_pointer_cast<SparseMatrixTM<double>>(prolongation->CreateTranspose());
+      tprol.Stop();
+
+      trap.Start();
       auto coarsemat = mat -> Restrict (*prolongation);
+      trap.Stop();
+
       // coarse freedofs
       auto coarse_freedofs = make_shared<BitArray> (num_coarse_vertices);
       coarse_freedofs->Clear();
@@ -423,6 +413,8 @@ namespace ngcomp
                       coarse_freedofs->SetBitAtomic(v2cv[v]);
                   });
 
+      tlevel.Stop();
+
       if ( (num_coarse_vertices < 10) || (num_coarse_vertices == num_vertices) )
 	{
 	  coarsemat->SetInverseType(SPARSECHOLESKY);
@@ -431,9 +423,6 @@ namespace ngcomp
       else
         coarse_precond = make_shared<H1AMG_Matrix> (dynamic_pointer_cast<SparseMatrixTM<SCAL>> (coarsemat), coarse_freedofs,
                                                     coarse_e2v, coarse_edge_weights, coarse_vertex_weights, level+1);
-
-      // restriction = TransposeMatrix (*prolongation);
-      restriction = dynamic_pointer_cast<SparseMatrixTM<double>>(prolongation->CreateTranspose());
     }
 
   template <typename SCAL>
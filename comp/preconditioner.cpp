@@ -270,6 +270,10 @@ namespace ngcomp
 	else
 	  sm = make_shared<BlockSmoother> (*ma, *lo_bfa, *lfconstraint, flags);
       }
+    else if (smoothertype == "chebyshev")
+      {
+	sm = make_shared<ChebyshevSmoother> (*ma, *lo_bfa, flags);
+      }
     /*
     else if (smoothertype == "potential")
       {
@@ -369,6 +373,10 @@ namespace ngcomp
             sm = new BlockSmoother (*ma, *lo_bfa, *lfconstraint, flags);
           */
       }
+    else if (smoothertype == "chebyshev")
+      {
+	sm = make_shared<ChebyshevSmoother> (*ma, *lo_bfa, flags);
+      }
     /*
     else if (smoothertype == "potential")
       {
@@ -17,6 +17,7 @@
 #include "compressedfespace.hpp"
 #include "../fem/integratorcf.hpp"
 #include "contact.hpp"
+#include "saamg.hpp"
 using namespace ngcomp;
 
 using ngfem::ELEMENT_TYPE;
@@ -1387,14 +1388,29 @@ BND : boolean or None
 	docu_string(R"delimiter(Reordered Finite Element Spaces.
 ...
 )delimiter"))
-    .def(py::init([] (shared_ptr<FESpace> & fes)
+    .def(py::init([] (shared_ptr<FESpace> & fes, string reorder)
                   {
                     Flags flags = fes->GetFlags();
+                    flags.SetFlag("reorder", reorder);
                     auto refes = make_shared<ReorderedFESpace>(fes, flags);
                     refes->Update();
                     refes->FinalizeUpdate();
                     return refes;
-                  }), py::arg("fespace"))
+                  }), py::arg("fespace"), py::arg("reorder")="groups",
+         docu_string(R"raw_string(
+Parameters:
+
+fespace : ngsolve.FESpace
+  base space
+
+reorder : string
+  'groups': dofs grouped around seed elements
+  'rcm': bandwidth reducing reverse Cuthill-McKee numbering
+  'hilbert': numbering along a Hilbert curve through the element centers
+
+Matrices and vectors are assembled in the new numbering, GridFunctions
+on the reordered space evaluate through the permutation.
+)raw_string"))
     /*
     .def(py::pickle([](const PeriodicFESpace* per_fes)
                     {
@@ -2147,7 +2163,14 @@ space : ngsolve.FESpace
                      "  when element matrices are independent of geometry, we store them \n"
                      "  only for the referecne elements",
                      py::arg("check_unused") = "bool = True\n"
-		     "  If set prints warnings if not UNUSED_DOFS are not used."
+		     "  If set prints warnings if not UNUSED_DOFS are not used.",
+                     py::arg("store_positions") = "bool = False\n"
+                     "  Keep the positions of the element matrices in the sparse matrix.\n"
+                     "  Reassembly on the same mesh adds element matrices without searching.",
+                     py::arg("simd_ebe") = "bool = False\n"
+                     "  Element-by-element matrices (e.g. of static condensation) are regrouped\n"
+                     "  for the SIMD-batched application after assembly. The element matrices\n"
+                     "  are kept in the batched layout only."
                      );
                 })
 
@@ -2603,6 +2626,17 @@ integrator : ngsolve.fem.LFI
                    }, "matrix of the preconditioner")
     ;
 
+  py::class_<SAAMG_Matrix, shared_ptr<SAAMG_Matrix>, BaseMatrix>
+    (m, "SAAMG_Matrix", "smoothed aggregation AMG, the matrix of the 'saamg' preconditioner")
+    .def_property_readonly("aggregates", [](SAAMG_Matrix & self)
+                           {
+                             py::list aggs;
+                             for (auto a : self.GetAggregates())
+                               aggs.append (a);
+                             return aggs;
+                           }, "aggregate of every node on the finest level, -1 for non-free nodes")
+    ;
+
   auto prec_multigrid = py::class_<MGPreconditioner, shared_ptr<MGPreconditioner>, Preconditioner>
     (m,"MultiGridPreconditioner");
   prec_multigrid
@@ -2620,7 +2654,16 @@ integrator : ngsolve.fem.LFI
                     "  Smoother between multigrid levels, available options are:\n"
                     "    'point': Gauss-Seidel-Smoother\n"
                     "    'line':  Anisotropic smoother\n"
-                    "    'block': Block smoother";
+                    "    'block': Block smoother\n"
+                    "    'chebyshev': Chebyshev accelerated Jacobi smoother";
+                  mg_flags["chebyshev_degree"] = "int = 3\n"
+                    "  Polynomial degree of one Chebyshev smoothing step.";
+                  mg_flags["chebyshev_ratio"] = "double = 30\n"
+                    "  Ratio of largest to smallest eigenvalue damped by the Chebyshev smoother.";
+                  mg_flags["chebyshev_blocks"] = "bool = False\n"
+                    "  Use FESpace smoothing blocks (block-Jacobi) in the Chebyshev smoother.";
+                  mg_flags["lanczossteps"] = "int = 10\n"
+                    "  Lanczos steps to estimate the largest eigenvalue for the Chebyshev smoother.";
                   mg_flags["coarsetype"] = "string = direct\n"
                     "  How to solve coarse problem.";
                   mg_flags["coarsesmoothingsteps"] = "int = 1\n"
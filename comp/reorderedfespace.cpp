@@ -12,6 +12,7 @@ namespace ngcomp {
   ReorderedFESpace :: ReorderedFESpace (shared_ptr<FESpace> aspace, const Flags & flags)
     : FESpace(aspace->GetMeshAccess(), flags), space(aspace)
   {
+    reorder = flags.GetStringFlag("reorder", "groups");
     type = "Reordered" + space->type;
     evaluator[VOL] = space->GetEvaluator(VOL);
     flux_evaluator[VOL] = space->GetFluxEvaluator(VOL);
@@ -36,8 +37,8 @@ namespace ngcomp {
 
     SetNDof(space->GetNDof());
     size_t ndof = space->GetNDof();
-    Array<DofId> dofs;
     /*
+    Array<DofId> dofs;
     dofmap.SetSize(ndof);
     dofmap = UNUSED_DOF;
     size_t cnt = 0;
@@ -50,6 +51,47 @@ namespace ngcomp {
         }
     */
 
+    if (reorder == "rcm")
+      CalcRCMOrdering();
+    else if (reorder == "hilbert")
+      CalcHilbertOrdering();
+    else if (reorder == "groups")
+      CalcGroupOrdering();
+    else
+      throw Exception ("ReorderedFESpace: unknown reordering '" + reorder +
+                       "', available are 'groups', 'rcm', 'hilbert'");
+
+    ctofdof.SetSize(ndof);
+    for (auto i : Range(ndof))
+      ctofdof[dofmap[i]] = space->GetDofCouplingType(i);
+  }
+
+
+  Table<DofId> ReorderedFESpace :: CreateElementDofTable () const
+  {
+    Array<DofId> dofs;
+    TableCreator<DofId> creator;
+    for ( ; !creator.Done(); creator++)
+      {
+        size_t cnt = 0;
+        for (VorB vb : { VOL, BND })
+          for (size_t i : Range(ma->GetNE(vb)))
+            {
+              space->GetDofNrs (ElementId(vb, i), dofs);
+              for (auto d : dofs)
+                if (IsRegularDof(d))
+                  creator.Add (cnt, d);
+              cnt++;
+            }
+      }
+    return creator.MoveTable();
+  }
+  
+
+  void ReorderedFESpace :: CalcGroupOrdering ()
+  {
+    size_t ndof = space->GetNDof();
+    Array<DofId> dofs;
     Array<int> dofgroup(ndof);
     Array<int> elgroup(ma->GetNE());
     dofgroup = -1;
@@ -96,10 +138,233 @@ namespace ngcomp {
       for (DofId d = 0; d < ndof; d++)
         if (dofgroup[d] == i)
           dofmap[d] = cnt++;
+  }
 
-    ctofdof.SetSize(ndof);
-    for (auto i : Range(ndof))
-      ctofdof[dofmap[i]] = space->GetDofCouplingType(i);
+
+  /*
+    Reverse Cuthill-McKee on the dof-graph given by element connectivity.
+    Every connected component starts from a pseudo-peripheral dof
+    (George-Liu), neighbours are numbered by increasing degree.
+  */
+  void ReorderedFESpace :: CalcRCMOrdering ()
+  {
+    static Timer t("ReorderedFESpace - RCM");
+    RegionTimer reg(t);
+    
+    size_t ndof = space->GetNDof();
+    Table<DofId> el2dof = CreateElementDofTable();
+
+    TableCreator<int> creator(ndof);
+    for ( ; !creator.Done(); creator++)
+      for (auto el : Range(el2dof.Size()))
+        for (auto d : el2dof[el])
+          creator.Add (d, el);
+    Table<int> dof2el = creator.MoveTable();
+
+    // degree = number of distinct neighbours
+    Array<int> degree(ndof);
+    ParallelForRange (ndof, [&] (IntRange r)
+                      {
+                        Array<DofId> nb;
+                        for (auto d : r)
+                          {
+                            nb.SetSize0();
+                            for (auto el : dof2el[d])
+                              for (auto d2 : el2dof[el])
+                                if (d2 != d) nb.Append(d2);
+                            QuickSort (nb);
+                            int cnt = 0;
+                            for (auto i : Range(nb))
+                              if (i == 0 || nb[i] != nb[i-1]) cnt++;
+                            degree[d] = cnt;
+                          }
+                      });
+
+    // level structure rooted at root, returns the last level
+    Array<int> mark(ndof);
+    mark = -1;
+    int stamp = 0;
+    Array<DofId> queue;
+    queue.SetAllocSize(ndof);
+    auto bfs = [&] (DofId root, Array<DofId> & lastlevel)
+      {
+        stamp++;
+        queue.SetSize0();
+        queue.Append(root);
+        mark[root] = stamp;
+        size_t first = 0;
+        int nlevels = 0;
+        while (first < queue.Size())
+          {
+            size_t last = queue.Size();
+            lastlevel.SetSize0();
+            for (size_t i = first; i < last; i++)
+              {
+                lastlevel.Append(queue[i]);
+                for (auto el : dof2el[queue[i]])
+                  for (auto d2 : el2dof[el])
+                    if (mark[d2] != stamp)
+                      {
+                        mark[d2] = stamp;
+                        queue.Append(d2);
+                      }
+              }
+            first = last;
+            nlevels++;
+          }
+        return nlevels;
+      };
+    
+    BitArray numbered(ndof);
+    numbered.Clear();
+    Array<DofId> order;
+    order.SetAllocSize(ndof);
+    Array<DofId> lastlevel, nb;
+    
+    for (DofId seed = 0; seed < ndof; seed++)
+      {
+        if (numbered.Test(seed)) continue;
+
+        // pseudo-peripheral root
+        DofId root = seed;
+        int nlevels = bfs(root, lastlevel);
+        for (int it = 0; it < 5; it++)
+          {
+            DofId cand = lastlevel[0];
+            for (auto d : lastlevel)
+              if (degree[d] < degree[cand]) cand = d;
+            int candlevels = bfs(cand, lastlevel);
+            if (candlevels <= nlevels) break;
+            root = cand;
+            nlevels = candlevels;
+          }
+
+        // Cuthill-McKee numbering of the component
+        size_t first = order.Size();
+        order.Append(root);
+        numbered.SetBit(root);
+        for (size_t i = first; i < order.Size(); i++)
+          {
+            nb.SetSize0();
+            for (auto el : dof2el[order[i]])
+              for (auto d2 : el2dof[el])
+                if (!numbered.Test(d2))
+                  {
+                    numbered.SetBit(d2);
+                    nb.Append(d2);
+                  }
+            QuickSort (nb, [&] (DofId a, DofId b)
+                       { return degree[a] < degree[b] || (degree[a] == degree[b] && a < b); });
+            for (auto d : nb)
+              order.Append(d);
+          }
+      }
+
+    dofmap.SetSize(ndof);
+    for (auto i : Range(order))
+      dofmap[order[i]] = ndof-1-i;
+  }
+
+
+  // Hilbert index of a point in [0,2^bits)^dim, J. Skilling, AIP Conf. Proc. 707 (2004)
+  static uint64_t HilbertIndex (int dim, int bits, uint32_t * x)
+  {
+    uint32_t m = uint32_t(1) << (bits-1);
+    // inverse undo excess work
+    for (uint32_t q = m; q > 1; q >>= 1)
+      {
+        uint32_t p = q-1;
+        for (int i = 0; i < dim; i++)
+          if (x[i] & q)
+            x[0] ^= p;
+          else
+            {
+              uint32_t t = (x[0] ^ x[i]) & p;
+              x[0] ^= t;
+              x[i] ^= t;
+            }
+      }
+    // Gray encode
+    for (int i = 1; i < dim; i++)
+      x[i] ^= x[i-1];
+    uint32_t t = 0;
+    for (uint32_t q = m; q > 1; q >>= 1)
+      if (x[dim-1] & q)
+        t ^= q-1;
+    for (int i = 0; i < dim; i++)
+      x[i] ^= t;
+
+    uint64_t key = 0;
+    for (int b = bits-1; b >= 0; b--)
+      for (int i = 0; i < dim; i++)
+        key = (key << 1) | ((x[i] >> b) & 1);
+    return key;
+  }
+  
+  /*
+    Elements are sorted along a Hilbert curve through their centers,
+    dofs are numbered in order of their first appearance.
+  */
+  void ReorderedFESpace :: CalcHilbertOrdering ()
+  {
+    static Timer t("ReorderedFESpace - Hilbert");
+    RegionTimer reg(t);
+
+    size_t ndof = space->GetNDof();
+    int dim = ma->GetDimension();
+    constexpr int bits = 16;
+    Table<DofId> el2dof = CreateElementDofTable();
+
+    Array<Vec<3>> centers(el2dof.Size());
+    size_t cnt = 0;
+    for (VorB vb : { VOL, BND })
+      for (size_t i : Range(ma->GetNE(vb)))
+        {
+          auto verts = ma->GetElement(ElementId(vb, i)).Vertices();
+          Vec<3> c = 0;
+          for (auto v : verts)
+            c += ma->GetPoint<3>(v);
+          centers[cnt++] = 1.0/verts.Size() * c;
+        }
+
+    Vec<3> pmin = 1e99, pmax = -1e99;
+    for (auto & c : centers)
+      for (int j = 0; j < 3; j++)
+        {
+          pmin(j) = min2(pmin(j), c(j));
+          pmax(j) = max2(pmax(j), c(j));
+        }
+    double scale = 0;
+    for (int j = 0; j < 3; j++)
+      scale = max2(scale, pmax(j)-pmin(j));
+    if (scale > 0) scale = ((uint32_t(1) << bits) - 1) / scale;
+    
+    Array<uint64_t> keys(centers.Size());
+    ParallelFor (centers.Size(), [&] (size_t i)
+                 {
+                   uint32_t x[3];
+                   for (int j = 0; j < dim; j++)
+                     x[j] = uint32_t(scale * (centers[i](j)-pmin(j)));
+                   keys[i] = HilbertIndex (dim, bits, x);
+                 });
+
+    Array<int> elorder(centers.Size());
+    for (auto i : Range(elorder))
+      elorder[i] = i;
+    QuickSort (elorder, [&] (int a, int b)
+               { return keys[a] < keys[b] || (keys[a] == keys[b] && a < b); });
+
+    dofmap.SetSize(ndof);
+    dofmap = NO_DOF_NR;
+    DofId nr = 0;
+    for (auto el : elorder)
+      for (auto d : el2dof[el])
+        if (dofmap[d] == NO_DOF_NR)
+          dofmap[d] = nr++;
+    // dofs without element
+    for (auto & d : dofmap)
+      if (d == NO_DOF_NR)
+        d = nr++;
   }
            
 
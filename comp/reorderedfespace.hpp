@@ -17,6 +17,8 @@ namespace ngcomp
   protected:
     Array<DofId> dofmap;
     shared_ptr<FESpace> space;
+    /// "groups", "rcm" (reverse Cuthill-McKee) or "hilbert" (space filling curve)
+    string reorder;
     
   public:
     ReorderedFESpace (shared_ptr<FESpace> space, const Flags & flags);
@@ -27,6 +29,15 @@ namespace ngcomp
 
     virtual void FinalizeUpdate() override;
 
+  protected:
+    /// element-to-dof table over volume and boundary elements of the base space
+    Table<DofId> CreateElementDofTable () const;
+    void CalcGroupOrdering ();
+    void CalcRCMOrdering ();
+    void CalcHilbertOrdering ();
+
+  public:
+
     ProxyNode MakeProxyFunction (bool testfunction,
                                  const function<shared_ptr<ProxyFunction>(shared_ptr<ProxyFunction>)> & addblock) const override
     {
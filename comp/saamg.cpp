@@ -0,0 +1,704 @@
+/*********************************************************************/
+/* File:   saamg.cpp                                                 */
+/* Date:   Oct. 2026                                                 */
+/*********************************************************************/
+
+/*
+   Smoothed aggregation AMG for linear elasticity:
+   MIS(2) aggregation on the strength graph of the nodal blocks,
+   tentative prolongation from the near null-space by a local QR,
+   one step of Jacobi prolongation smoothing,
+   l1-Jacobi or Chebyshev smoothing.
+ */
+
+#include <saamg.hpp>
+
+#include <comp.hpp>
+using namespace ngcomp;
+
+
+namespace ngcomp
+{
+
+  /*
+    real scalar copy of a block matrix, the dof k of block i becomes BS*i+k.
+    from symmetric storage the full matrix is generated.
+   */
+  template <typename TM>
+  static shared_ptr<SparseMatrix<double>> SAAMG_ScalarCopy (const SparseMatrixTM<TM> & mat, bool symmetric)
+  {
+    static Timer t("SAAMG - scalar copy"); RegionTimer reg(t);
+    constexpr int BS = mat_traits<TM>::HEIGHT;
+    size_t n = mat.Height();
+
+    Array<int> cnt(n);
+    cnt = 0;
+    for (size_t i = 0; i < n; i++)
+      for (auto j : mat.GetRowIndices(i))
+        {
+          cnt[i]++;
+          if (symmetric && j != i) cnt[j]++;
+        }
+
+    // upper part from symmetric storage is appended after the lower part, rows stay sorted
+    Table<int> cols(cnt);
+    Table<TM> vals(cnt);
+    cnt = 0;
+    for (size_t i = 0; i < n; i++)
+      {
+        auto ci = mat.GetRowIndices(i);
+        auto vi = mat.GetRowValues(i);
+        for (size_t k = 0; k < ci.Size(); k++)
+          {
+            int j = ci[k];
+            cols[i][cnt[i]] = j;
+            vals[i][cnt[i]++] = vi(k);
+            if (symmetric && j != i)
+              {
+                cols[j][cnt[j]] = i;
+                vals[j][cnt[j]++] = Trans(vi(k));
+              }
+          }
+      }
+
+    Array<int> scnt(BS*n);
+    for (size_t i = 0; i < n; i++)
+      for (int k = 0; k < BS; k++)
+        scnt[BS*i+k] = BS*cols[i].Size();
+
+    auto smat = make_shared<SparseMatrix<double>> (scnt, BS*n);
+    ParallelFor (n, [&] (size_t i)
+                 {
+                   for (int k = 0; k < BS; k++)
+                     {
+                       auto sci = smat->GetRowIndices(BS*i+k);
+                       auto svi = smat->GetRowValues(BS*i+k);
+                       size_t pos = 0;
+                       for (size_t jj = 0; jj < cols[i].Size(); jj++)
+                         for (int l = 0; l < BS; l++, pos++)
+                           {
+                             sci[pos] = BS*cols[i][jj]+l;
+                             if constexpr (BS == 1)
+                               svi[pos] = vals[i][jj];
+                             else
+                               svi[pos] = vals[i][jj](k,l);
+                           }
+                     }
+                 });
+    return smat;
+  }
+
+  template <typename TM>
+  static shared_ptr<SparseMatrix<double>> SAAMG_TryScalarCopy (const BaseSparseMatrix & mat)
+  {
+    auto tmat = dynamic_cast<const SparseMatrixTM<TM>*> (&mat);
+    if (!tmat) return nullptr;
+    bool symmetric = dynamic_cast<const SparseMatrixSymmetric<TM>*> (&mat) != nullptr;
+    if constexpr (is_same<TM,double>::value)
+      if (!symmetric)
+        if (auto smat = dynamic_cast<const SparseMatrix<double>*> (&mat))
+          return dynamic_pointer_cast<SparseMatrix<double>>
+            (const_cast<SparseMatrix<double>*>(smat)->shared_from_this());
+    return SAAMG_ScalarCopy (*tmat, symmetric);
+  }
+
+
+  // D^-1 on the flat vectors, for the Lanczos estimate
+  class SAAMG_DiagonalInverse : public BaseMatrix
+  {
+    FlatArray<double> dinv;
+  public:
+    SAAMG_DiagonalInverse (FlatArray<double> adinv) : dinv(adinv) { ; }
+    virtual int VHeight() const override { return dinv.Size(); }
+    virtual int VWidth() const override { return dinv.Size(); }
+    virtual bool IsComplex() const override { return false; }
+
+    virtual void MultAdd (double s, const BaseVector & x, BaseVector & y) const override
+    {
+      ParallelForRange (dinv.Size(), [&] (IntRange r)
+                        {
+                          auto fx = x.FVDouble();
+                          auto fy = y.FVDouble();
+                          for (auto i : r)
+                            fy(i) += s * dinv[i] * fx(i);
+                        });
+    }
+  };
+
+
+  // random priority for the MIS rounds
+  inline uint64_t SAAMG_Hash (uint64_t i, uint64_t round)
+  {
+    uint64_t h = i * 0x9e3779b97f4a7c15ull + (round+1) * 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 31; h *= 0x94d049bb133111ebull; h ^= h >> 29;
+    return h & 0x7fffffff;
+  }
+
+  enum { MIS_OUT = 0, MIS_UNDECIDED = 1, MIS_IN = 2 };
+
+
+  SAAMG_Matrix :: SAAMG_Matrix (shared_ptr<BaseSparseMatrix> amat,
+                                shared_ptr<BitArray> freedofs,
+                                FlatMatrix<double> nullspace,
+                                int ablocksize,
+                                const SAAMG_Options & aopts,
+                                size_t level)
+    : bs(ablocksize), mat(amat), opts(aopts)
+  {
+    static Timer t("SAAMG setup"); RegionTimer reg(t);
+    static Timer tstrong("SAAMG setup - strength graph");
+    static Timer tagg("SAAMG setup - aggregation");
+    static Timer ttent("SAAMG setup - tentative prolongation");
+    static Timer tsmooth("SAAMG setup - prolongation smoothing");
+    static Timer trap("SAAMG setup - coarse matrix");
+
+    if (mat->IsComplex())
+      throw Exception ("SAAMG: only real matrices are supported");
+
+    int eh = get<0> (mat->EntrySizes());
+    size = mat->Height() * eh;
+    if (size % bs != 0 || nullspace.Height() != size)
+      throw Exception ("SAAMG: dimensions of matrix, blocksize and near null-space don't fit");
+
+    // freedofs refer to the matrix rows
+    auto free_dof = [&] (size_t d) { return !freedofs || freedofs->Test(d / eh); };
+
+    if (size <= opts.coarse_size || level+1 >= opts.max_levels)
+      {
+        direct = true;
+        if (level > 0) mat->SetInverseType(SPARSECHOLESKY);
+        coarse_precond = mat->InverseMatrix(freedofs);
+        return;
+      }
+
+    shared_ptr<SparseMatrix<double>> smat = SAAMG_TryScalarCopy<double> (*mat);
+    if (!smat) smat = SAAMG_TryScalarCopy<Mat<2,2,double>> (*mat);
+    if (!smat) smat = SAAMG_TryScalarCopy<Mat<3,3,double>> (*mat);
+    if (!smat)
+      throw Exception ("SAAMG: only real sparse matrices with 1x1, 2x2 or 3x3 blocks are supported");
+
+    // diagonal and l1-diagonal restricted to the free dofs
+    Array<double> diaginv(size);
+    l1diaginv.SetSize(size);
+    ParallelFor (size, [&] (size_t i)
+                 {
+                   diaginv[i] = l1diaginv[i] = 0;
+                   if (!free_dof(i)) return;
+                   double diag = 0, l1 = 0;
+                   auto ci = smat->GetRowIndices(i);
+                   auto vi = smat->GetRowValues(i);
+                   for (size_t k = 0; k < ci.Size(); k++)
+                     {
+                       if (size_t(ci[k]) == i) diag = vi(k);
+                       if (free_dof(ci[k])) l1 += fabs(vi(k));
+                     }
+                   if (diag > 0)
+                     {
+                       diaginv[i] = 1.0/diag;
+                       l1diaginv[i] = 1.0/l1;
+                     }
+                 });
+
+    size_t n = size / bs;
+    Array<bool> free_node(n);
+    ParallelFor (n, [&] (size_t i)
+                 {
+                   free_node[i] = false;
+                   for (int k = 0; k < bs; k++)
+                     if (free_dof(bs*i+k)) free_node[i] = true;
+                 });
+
+    // neighbour nodes with squared Frobenius norms of the coupling blocks
+    auto node_connections = [&] (size_t i, Array<int> & nodes, Array<double> & weights)
+      {
+        Array<INT<2,double>> pairs;
+        for (int k = 0; k < bs; k++)
+          {
+            auto ci = smat->GetRowIndices(bs*i+k);
+            auto vi = smat->GetRowValues(bs*i+k);
+            for (size_t j = 0; j < ci.Size(); j++)
+              pairs.Append (INT<2,double> (ci[j]/bs, sqr(vi(j))));
+          }
+        QuickSort (pairs, [] (auto a, auto b) { return a[0] < b[0]; });
+        nodes.SetSize0();
+        weights.SetSize0();
+        for (auto p : pairs)
+          if (nodes.Size() && nodes.Last() == int(p[0]))
+            weights.Last() += p[1];
+          else
+            {
+              nodes.Append (int(p[0]));
+              weights.Append (p[1]);
+            }
+      };
+
+    Array<double> node_diag(n);
+    ParallelFor (n, [&] (size_t i)
+                 {
+                   Array<int> nodes;
+                   Array<double> weights;
+                   node_connections (i, nodes, weights);
+                   node_diag[i] = 0;
+                   for (size_t k = 0; k < nodes.Size(); k++)
+                     if (size_t(nodes[k]) == i)
+                       node_diag[i] = weights[k];
+                 });
+
+    // |A_ij| > theta sqrt(|A_ii| |A_jj|), the weights are squared norms
+    auto is_strong = [&] (size_t i, size_t j, double w)
+      {
+        return i != j && free_node[i] && free_node[j] &&
+          w > sqr(opts.theta) * sqrt(node_diag[i] * node_diag[j]);
+      };
+
+    tstrong.Start();
+    TableCreator<int> creator(n);
+    for ( ; !creator.Done(); creator++)
+      ParallelFor (n, [&] (size_t i)
+                   {
+                     Array<int> nodes;
+                     Array<double> weights;
+                     node_connections (i, nodes, weights);
+                     for (size_t k = 0; k < nodes.Size(); k++)
+                       if (is_strong (i, nodes[k], weights[k]))
+                         creator.Add (i, nodes[k]);
+                   });
+    Table<int> strong = creator.MoveTable();
+    tstrong.Stop();
+
+
+    tagg.Start();
+    // distance-2 maximal independent set by rounds of max-propagation,
+    // key = (state, random, node)
+    Array<int> state(n);
+    ParallelFor (n, [&] (size_t i) { state[i] = free_node[i] ? MIS_UNDECIDED : MIS_OUT; });
+
+    Array<uint64_t> key0(n), key1(n);
+    for (int round = 0; ; round++)
+      {
+        ParallelFor (n, [&] (size_t i)
+                     {
+                       key0[i] = (uint64_t(state[i]) << 62) | (SAAMG_Hash(i, round) << 31) | i;
+                     });
+        ParallelFor (n, [&] (size_t i)
+                     {
+                       uint64_t m = key0[i];
+                       for (int j : strong[i])
+                         m = max2(m, key0[j]);
+                       key1[i] = m;
+                     });
+
+        atomic<size_t> num_undecided(0);
+        ParallelForRange (n, [&] (IntRange r)
+                          {
+                            size_t my_undecided = 0;
+                            for (size_t i : r)
+                              {
+                                if (state[i] != MIS_UNDECIDED) continue;
+                                uint64_t m = key1[i];
+                                for (int j : strong[i])
+                                  m = max2(m, key1[j]);
+                                if (m == key0[i])
+                                  state[i] = MIS_IN;
+                                else if ((m >> 62) == MIS_IN)
+                                  state[i] = MIS_OUT;
+                                else
+                                  my_undecided++;
+                              }
+                            num_undecided += my_undecided;
+                          });
+        if (num_undecided == 0) break;
+      }
+
+    // roots form the aggregates, roots are at distance >= 3,
+    // so strong neighbours of a root don't see another root
+    Array<int> agg(n), agg2(n);
+    size_t nagg = 0;
+    for (size_t i = 0; i < n; i++)
+      agg[i] = -1;
+    for (size_t i = 0; i < n; i++)
+      if (state[i] == MIS_IN)
+        agg[i] = nagg++;
+
+    ParallelFor (n, [&] (size_t i)
+                 {
+                   if (state[i] != MIS_IN)
+                     for (int j : strong[i])
+                       if (state[j] == MIS_IN)
+                         agg[i] = agg[j];
+                 });
+
+    // the remaining nodes join the strongest connected aggregate of the previous phase
+    ParallelFor (n, [&] (size_t i)
+                 {
+                   agg2[i] = agg[i];
+                   if (agg[i] != -1 || !free_node[i]) return;
+                   Array<int> nodes;
+                   Array<double> weights;
+                   node_connections (i, nodes, weights);
+                   double maxw = -1;
+                   for (size_t k = 0; k < nodes.Size(); k++)
+                     if (is_strong(i, nodes[k], weights[k]) && agg[nodes[k]] != -1 && weights[k] > maxw)
+                       {
+                         maxw = weights[k];
+                         agg2[i] = agg[nodes[k]];
+                       }
+                 });
+
+    for (size_t i = 0; i < n; i++)
+      if (free_node[i] && agg2[i] == -1)
+        agg2[i] = nagg++;
+    aggregates = agg2;
+
+    TableCreator<int> agg_creator(nagg);
+    for ( ; !agg_creator.Done(); agg_creator++)
+      ParallelFor (n, [&] (size_t i)
+                   {
+                     if (agg2[i] != -1)
+                       agg_creator.Add (agg2[i], i);
+                   });
+    Table<int> agg2node = agg_creator.MoveTable();
+    ParallelFor (nagg, [&] (size_t k) { QuickSort (agg2node[k]); });
+    tagg.Stop();
+
+    int nns = nullspace.Width();
+    size_t ncoarse = nagg * nns;
+    cout << IM(4) << "SAAMG level " << level << ", ndof = " << size
+         << ", aggregates = " << nagg << ", coarse ndof = " << ncoarse << endl;
+
+    if (ncoarse == 0 || ncoarse >= size)
+      {
+        direct = true;
+        if (level > 0) mat->SetInverseType(SPARSECHOLESKY);
+        coarse_precond = mat->InverseMatrix(freedofs);
+        return;
+      }
+
+
+    // tentative prolongation by QR of the near null-space on every aggregate,
+    // R is the coarse near null-space
+    ttent.Start();
+    Array<int> cnt(size);
+    ParallelFor (size, [&] (size_t i) { cnt[i] = (agg2[i/bs] != -1) ? nns : 0; });
+    auto ptent = make_shared<SparseMatrix<double>> (cnt, ncoarse);
+
+    Matrix<double> coarse_nullspace(ncoarse, nns);
+    auto coarse_freedofs = make_shared<BitArray> (ncoarse);
+    coarse_freedofs->Clear();
+
+    ParallelFor (nagg, [&] (size_t k)
+                 {
+                   auto nodes = agg2node[k];
+                   Matrix<double> q(bs*nodes.Size(), nns);
+                   Matrix<double> r(nns, nns);
+                   r = 0.0;
+                   for (size_t l = 0; l < nodes.Size(); l++)
+                     for (int c = 0; c < bs; c++)
+                       {
+                         size_t row = bs*nodes[l]+c;
+                         if (free_dof(row))
+                           q.Row(bs*l+c) = nullspace.Row(row);
+                         else
+                           q.Row(bs*l+c) = 0.0;
+                       }
+
+                   // modified Gram-Schmidt, dependent columns become non-free coarse dofs
+                   for (int m = 0; m < nns; m++)
+                     {
+                       double norm0 = L2Norm(q.Col(m));
+                       for (int p = 0; p < m; p++)
+                         {
+                           double s = InnerProduct (q.Col(p), q.Col(m));
+                           r(p,m) = s;
+                           q.Col(m) -= s * q.Col(p);
+                         }
+                       double norm = L2Norm(q.Col(m));
+                       if (norm0 > 0 && norm > 1e-10 * norm0)
+                         {
+                           r(m,m) = norm;
+                           q.Col(m) *= 1.0/norm;
+                           coarse_freedofs->SetBitAtomic(k*nns+m);
+                         }
+                       else
+                         q.Col(m) = 0.0;
+                     }
+
+                   for (size_t l = 0; l < nodes.Size(); l++)
+                     for (int c = 0; c < bs; c++)
+                       {
+                         size_t row = bs*nodes[l]+c;
+                         auto ci = ptent->GetRowIndices(row);
+                         auto vi = ptent->GetRowValues(row);
+                         for (int m = 0; m < nns; m++)
+                           {
+                             ci[m] = k*nns+m;
+                             vi(m) = q(bs*l+c, m);
+                           }
+                       }
+                   for (int m = 0; m < nns; m++)
+                     coarse_nullspace.Row(k*nns+m) = r.Row(m);
+                 });
+    ttent.Stop();
+
+
+    // P = (I - omega D^-1 A) P_tent
+    tsmooth.Start();
+    SAAMG_DiagonalInverse dinvmat(diaginv);
+    EigenSystem eigen(*smat, dinvmat);
+    eigen.SetMaxSteps (opts.lanczos_steps);
+    eigen.SetPrintWarning (false);
+    eigen.Calc();
+    double omega = opts.omega_scale / (1.1 * eigen.MaxEigenValue());
+
+    auto ap = MatMult (*smat, *ptent);
+    ParallelFor (size, [&] (size_t i)
+                 {
+                   auto vi = ap->GetRowValues(i);
+                   vi *= -omega * diaginv[i];
+                   auto pci = ptent->GetRowIndices(i);
+                   auto pvi = ptent->GetRowValues(i);
+                   for (size_t j = 0; j < pci.Size(); j++)
+                     {
+                       size_t pos = ap->GetPositionTest(i, pci[j]);
+                       if (pos == numeric_limits<size_t>::max())
+                         throw Exception ("SAAMG: matrix has no diagonal entry");
+                       (*ap)[pos] += pvi(j);
+                     }
+                 });
+    prolongation = ap;
+    restriction = dynamic_pointer_cast<SparseMatrixTM<double>> (prolongation->CreateTranspose());
+    tsmooth.Stop();
+
+    trap.Start();
+    auto coarsemat = smat->Restrict (*prolongation);
+    trap.Stop();
+    smat = nullptr;
+
+    coarse_precond = make_shared<SAAMG_Matrix> (coarsemat, coarse_freedofs, coarse_nullspace,
+                                                nns, opts, level+1);
+  }
+
+
+  void SAAMG_Matrix :: Smooth (BaseVector & x, const BaseVector & b, BaseVector & res) const
+  {
+    res = b;
+    mat->MultAdd (-1, x, res);
+
+    auto add_precond = [&] (double s, const BaseVector & r, BaseVector & y)
+      {
+        ParallelForRange (size, [&] (IntRange myrange)
+                          {
+                            auto fr = r.FVDouble();
+                            auto fy = y.FVDouble();
+                            for (auto i : myrange)
+                              fy(i) += s * l1diaginv[i] * fr(i);
+                          });
+      };
+
+    if (!opts.chebyshev)
+      {
+        add_precond (1, res, x);
+        return;
+      }
+
+    // l1-Jacobi bounds the spectrum by 1
+    double lmax = 1, lmin = lmax / opts.chebyshev_ratio;
+    double theta = 0.5 * (lmax + lmin);
+    double delta = 0.5 * (lmax - lmin);
+    double sigma = theta / delta;
+    double rho = 1 / sigma;
+
+    auto d = x.CreateVector();
+    d = 0.0;
+    add_precond (1/theta, res, d);
+    for (int k = 1; k <= opts.chebyshev_degree; k++)
+      {
+        x += d;
+        if (k == opts.chebyshev_degree) break;
+
+        mat->MultAdd (-1, d, res);
+        double rhonew = 1 / (2*sigma - rho);
+        d *= rhonew * rho;
+        add_precond (2*rhonew/delta, res, d);
+        rho = rhonew;
+      }
+  }
+
+
+  void SAAMG_Matrix :: Mult (const BaseVector & b, BaseVector & x) const
+  {
+    static Timer t("SAAMG::Mult"); RegionTimer reg(t);
+    if (direct)
+      {
+        coarse_precond->Mult (b, x);
+        return;
+      }
+
+    x = 0;
+    auto residuum = b.CreateVector();
+    for (int i = 0; i < opts.smoothing_steps; i++)
+      Smooth (x, b, residuum);
+
+    residuum = b - (*mat) * x;
+
+    auto coarse_residuum = coarse_precond->CreateColVector();
+    coarse_residuum = *restriction * residuum;
+
+    auto coarse_x = coarse_precond->CreateColVector();
+    coarse_precond->Mult(coarse_residuum, coarse_x);
+
+    x += *prolongation * coarse_x;
+    for (int i = 0; i < opts.smoothing_steps; i++)
+      Smooth (x, b, residuum);
+  }
+
+
+
+  Matrix<double> RigidBodyModes (const FESpace & fes, size_t nblocks, int bs)
+  {
+    int nns = (bs == 3) ? 6 : ( (bs == 2) ? 3 : 1);
+    Matrix<double> modes(bs*nblocks, nns);
+    modes = 0.0;
+
+    const MeshAccess & ma = *fes.GetMeshAccess();
+    size_t nv = ma.GetNV();
+    if (nv == 0) return modes;
+
+    // center and scale the coordinates for well balanced columns
+    Vec<3> center = 0.0, pmin = ma.GetPoint<3>(0), pmax = pmin;
+    for (size_t v = 0; v < nv; v++)
+      {
+        auto p = ma.GetPoint<3>(v);
+        center += p;
+        for (int j = 0; j < 3; j++)
+          {
+            pmin(j) = min2(pmin(j), p(j));
+            pmax(j) = max2(pmax(j), p(j));
+          }
+      }
+    center /= nv;
+    double h = max2(L2Norm(pmax-pmin), 1e-30);
+
+    // the dofs of the vertices get the rigid body modes of the vertex point
+    ParallelFor (nv, [&] (size_t v)
+                 {
+                   Array<DofId> dnums;
+                   fes.GetDofNrs (NodeId(NT_VERTEX, v), dnums);
+                   Vec<3> p = (1/h) * (ma.GetPoint<3>(v) - center);
+                   for (auto d : dnums)
+                     {
+                       if (!IsRegularDof(d) || size_t(d) >= nblocks) continue;
+                       auto rows = modes.Rows(bs*d, bs*d+bs);
+                       for (int k = 0; k < bs; k++)
+                         rows(k,k) = 1;
+                       if (bs == 2)
+                         {
+                           rows(0,2) = -p(1);
+                           rows(1,2) = p(0);
+                         }
+                       if (bs == 3)
+                         {
+                           rows(1,3) = -p(2); rows(2,3) = p(1);
+                           rows(0,4) = p(2);  rows(2,4) = -p(0);
+                           rows(0,5) = -p(1); rows(1,5) = p(0);
+                         }
+                     }
+                 });
+    return modes;
+  }
+
+
+
+  class SAAMG_Preconditioner : public Preconditioner
+  {
+    shared_ptr<FESpace> fes;
+    shared_ptr<BitArray> freedofs;
+    shared_ptr<BaseSparseMatrix> amat;
+    shared_ptr<SAAMG_Matrix> mat;
+    SAAMG_Options opts;
+
+  public:
+
+    static shared_ptr<Preconditioner> Create (const PDE & pde, const Flags & flags, const string & name)
+    {
+      return make_shared<SAAMG_Preconditioner> (pde, flags, name);
+    }
+
+    static shared_ptr<Preconditioner> CreateBF (shared_ptr<BilinearForm> bfa, const Flags & flags, const string & name)
+    {
+      return make_shared<SAAMG_Preconditioner> (bfa, flags, name);
+    }
+
+    SAAMG_Preconditioner (shared_ptr<BilinearForm> abfa, const Flags & aflags,
+                          const string aname = "SAAMG_cprecond")
+      : Preconditioner (abfa, aflags, aname), fes(abfa->GetFESpace())
+    {
+      cout << IM(3) << "Create smoothed aggregation AMG" << endl;
+      if (abfa->GetFESpace()->IsComplex())
+        throw Exception ("SAAMG: only real spaces are supported");
+
+      opts.theta = flags.GetNumFlag ("theta", opts.theta);
+      opts.smoothing_steps = int(flags.GetNumFlag ("smoothingsteps", opts.smoothing_steps));
+      opts.chebyshev = flags.GetStringFlag ("smoother", "l1jacobi") == "chebyshev";
+      opts.chebyshev_degree = int(flags.GetNumFlag ("chebyshev_degree", opts.chebyshev_degree));
+      opts.chebyshev_ratio = flags.GetNumFlag ("chebyshev_ratio", opts.chebyshev_ratio);
+      opts.coarse_size = size_t(flags.GetNumFlag ("coarsesize", opts.coarse_size));
+      opts.max_levels = int(flags.GetNumFlag ("maxlevels", opts.max_levels));
+      opts.lanczos_steps = int(flags.GetNumFlag ("lanczossteps", opts.lanczos_steps));
+    }
+
+    SAAMG_Preconditioner (const PDE & pde, const Flags & aflags, const string & aname)
+      : SAAMG_Preconditioner (pde.GetBilinearForm (aflags.GetStringFlag ("bilinearform")),
+                              aflags, aname)
+    { ; }
+
+
+    virtual void InitLevel (shared_ptr<BitArray> _freedofs) override
+    {
+      freedofs = _freedofs;
+    }
+
+    virtual void FinalizeLevel (const BaseMatrix * matrix) override
+    {
+      amat = dynamic_pointer_cast<BaseSparseMatrix> (const_cast<BaseMatrix*>(matrix)->shared_from_this());
+      if (!amat)
+        throw Exception ("SAAMG: needs a sparse matrix");
+
+      int bs = get<0> (amat->EntrySizes());
+      Matrix<double> nullspace = RigidBodyModes (*fes, amat->Height(), bs);
+      mat = make_shared<SAAMG_Matrix> (amat, freedofs, nullspace, bs, opts);
+    }
+
+    virtual void Update () override { ; }
+
+    virtual const BaseMatrix & GetAMatrix() const override
+    {
+      return *amat;
+    }
+
+    virtual const BaseMatrix & GetMatrix() const override
+    {
+      if (!mat)
+        ThrowPreconditionerNotReady();
+      return *mat;
+    }
+
+    virtual shared_ptr<BaseMatrix> GetMatrixPtr() override
+    {
+      if (!mat)
+        ThrowPreconditionerNotReady();
+      return mat;
+    }
+
+    virtual const char * ClassName() const override
+    { return "Smoothed Aggregation AMG Preconditioner"; }
+  };
+
+
+  auto initsaamg = [] () {
+    GetPreconditionerClasses().AddPreconditioner("saamg",
+                                                 SAAMG_Preconditioner::Create,
+                                                 SAAMG_Preconditioner::CreateBF);
+    return 1;
+  } ();
+}
@@ -0,0 +1,76 @@
+#ifndef SAAMG_HPP_
+#define SAAMG_HPP_
+
+#include <comp.hpp>
+
+namespace ngcomp
+{
+  /// parameters of the smoothed aggregation AMG
+  struct SAAMG_Options
+  {
+    /// strength of connection threshold
+    double theta = 0.02;
+    /// prolongation smoothing parameter is omega_scale / lambda_max(D^-1 A)
+    double omega_scale = 4.0/3.0;
+    /// Lanczos steps for lambda_max
+    int lanczos_steps = 10;
+    int smoothing_steps = 1;
+    /// Chebyshev instead of l1-Jacobi smoothing
+    bool chebyshev = false;
+    int chebyshev_degree = 3;
+    double chebyshev_ratio = 30;
+    /// sparse direct solver below this number of dofs
+    size_t coarse_size = 500;
+    int max_levels = 20;
+  };
+
+
+  /**
+     Smoothed aggregation AMG for systems, in particular linear elasticity.
+     The matrix is a real sparse matrix with blocks up to 3x3, the
+     near null-space (the rigid body modes) is given by one row per scalar dof.
+     Coarse levels are scalar matrices with one block of nns dofs per aggregate.
+  */
+  class NGS_DLL_HEADER SAAMG_Matrix : public ngla::BaseMatrix
+  {
+    size_t size;       // scalar dofs
+    int bs;            // scalar dofs per aggregation node
+    std::shared_ptr<ngla::BaseSparseMatrix> mat;
+    ngcore::Array<double> l1diaginv;
+    std::shared_ptr<ngla::SparseMatrixTM<double>> prolongation, restriction;
+    std::shared_ptr<ngla::BaseMatrix> coarse_precond;
+    bool direct = false;
+    SAAMG_Options opts;
+    /// aggregate of every node, -1 for non-free nodes. empty on the coarsest level
+    ngcore::Array<int> aggregates;
+
+  public:
+    SAAMG_Matrix (std::shared_ptr<ngla::BaseSparseMatrix> amat,
+                  std::shared_ptr<ngcore::BitArray> freedofs,
+                  ngbla::FlatMatrix<double> nullspace,
+                  int ablocksize,
+                  const SAAMG_Options & aopts,
+                  size_t level = 0);
+
+    virtual int VHeight() const override { return mat->Height(); }
+    virtual int VWidth() const override { return mat->Width(); }
+    virtual bool IsComplex() const override { return false; }
+
+    virtual AutoVector CreateRowVector () const override { return mat->CreateColVector(); }
+    virtual AutoVector CreateColVector () const override { return mat->CreateRowVector(); }
+
+    virtual void Mult (const ngla::BaseVector & b, ngla::BaseVector & x) const override;
+
+    ngcore::FlatArray<int> GetAggregates () const { return aggregates; }
+
+  protected:
+    /// one l1-Jacobi or Chebyshev step, res is a work vector
+    void Smooth (ngla::BaseVector & x, const ngla::BaseVector & b, ngla::BaseVector & res) const;
+  };
+
+
+  /// rigid body modes from the vertex coordinates, rows of non-vertex dofs are zero
+  NGS_DLL_HEADER Matrix<double> RigidBodyModes (const FESpace & fes, size_t nblocks, int bs);
+}
+
+#endif // SAAMG_HPP_
@@ -309,6 +309,7 @@ namespace ngla
       case MUMPS:           return "mumps";
       case MASTERINVERSE:   return "masterinverse";
       case UMFPACK:         return "umfpack";
+      case SPARSECHOLESKY_MIXED: return "sparsecholesky_mixed";
       }
     return "";
   }
@@ -439,6 +440,31 @@ namespace ngla
         return make_shared<EmbeddedMatrix> (emba->Height(), emba->GetRange(), b);
       }
 
+    // projectors around sparse matrices become masks of the product
+    if (auto proja = dynamic_pointer_cast<Projector> (a))
+      {
+        if (auto spb = dynamic_pointer_cast<BaseSparseMatrix> (b))
+          if (proja->Width() == spb->Height())
+            return make_shared<MaskedMatrix> (spb, proja->GetMask(), proja->KeepValues(),
+                                              nullptr, true);
+        if (auto maskb = dynamic_pointer_cast<MaskedMatrix> (b))
+          if (!maskb->GetRowMask() && proja->Width() == maskb->Height())
+            return make_shared<MaskedMatrix> (maskb->GetMatrix(), proja->GetMask(), proja->KeepValues(),
+                                              maskb->GetColMask(), maskb->ColKeep());
+      }
+
+    if (auto projb = dynamic_pointer_cast<Projector> (b))
+      {
+        if (auto spa = dynamic_pointer_cast<BaseSparseMatrix> (a))
+          if (spa->Width() == projb->Height())
+            return make_shared<MaskedMatrix> (spa, nullptr, true,
+                                              projb->GetMask(), projb->KeepValues());
+        if (auto maska = dynamic_pointer_cast<MaskedMatrix> (a))
+          if (!maska->GetColMask() && maska->Width() == projb->Height())
+            return make_shared<MaskedMatrix> (maska->GetMatrix(), maska->GetRowMask(), maska->RowKeep(),
+                                              projb->GetMask(), projb->KeepValues());
+      }
+
     auto para = dynamic_pointer_cast<ParallelMatrix> (a);
     auto parb = dynamic_pointer_cast<ParallelMatrix> (b);
 
@@ -13,7 +13,8 @@ namespace ngla
 
 
   // sets the solver which is used for InverseMatrix
-  enum INVERSETYPE { PARDISO, PARDISOSPD, SPARSECHOLESKY, SUPERLU, SUPERLU_DIST, MUMPS, MASTERINVERSE, UMFPACK };
+  enum INVERSETYPE { PARDISO, PARDISOSPD, SPARSECHOLESKY, SUPERLU, SUPERLU_DIST, MUMPS, MASTERINVERSE, UMFPACK,
+                     SPARSECHOLESKY_MIXED };
   extern string GetInverseName (INVERSETYPE type);
 
   /**
@@ -294,6 +295,8 @@ namespace ngla
     Transpose (const BaseMatrix & abm) : bm(abm) { ; }
     Transpose (shared_ptr<BaseMatrix> aspbm) : bm(*aspbm), spbm(aspbm) { ; }
     ///
+    const BaseMatrix & GetMatrix () const { return bm; }
+    ///
     virtual bool IsComplex() const override { return bm.IsComplex(); }
     virtual BaseMatrix::OperatorInfo GetOperatorInfo () const override;
     
@@ -437,6 +440,9 @@ namespace ngla
         }
     }
     ///
+    const BaseMatrix & GetMatrixA () const { return bma; }
+    const BaseMatrix & GetMatrixB () const { return bmb; }
+    ///
     virtual bool IsComplex() const override { return bma.IsComplex() || bmb.IsComplex(); }
     virtual BaseMatrix::OperatorInfo GetOperatorInfo () const override;
 
@@ -519,6 +525,11 @@ namespace ngla
                    double aa = 1, double ab = 1)
       : bma(*aspbma), bmb(*aspbmb), spbma(aspbma), spbmb(aspbmb), a(aa), b(ab)
     { ; }
+    /// the sum is a * A + b * B
+    const BaseMatrix & GetMatrixA () const { return bma; }
+    const BaseMatrix & GetMatrixB () const { return bmb; }
+    double GetScaleA () const { return a; }
+    double GetScaleB () const { return b; }
     ///
     virtual bool IsComplex() const override { return bma.IsComplex() || bmb.IsComplex(); }
 
@@ -651,6 +662,9 @@ namespace ngla
     VScaleMatrix (const BaseMatrix & abm, TSCAL ascale) : bm(abm), scale(ascale) { ; }
     VScaleMatrix (shared_ptr<BaseMatrix> aspbm, TSCAL ascale)
       : bm(*aspbm), spbm(aspbm), scale(ascale) { ; }
+    ///
+    const BaseMatrix & GetMatrix () const { return bm; }
+    TSCAL GetScale () const { return scale; }
     virtual bool IsComplex() const override
     { return bm.IsComplex() || typeid(TSCAL)==typeid(Complex); } 
     ///
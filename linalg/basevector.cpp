@@ -20,6 +20,68 @@
 namespace ngla
 {
   using namespace ngbla;
+
+
+  /*
+    Static partition of the flat data (n scalars) of a vector:
+    the partitioning of the vector (the matrix rows) if there is one
+    for all threads, else nparts equal parts.
+    Task i always works on part i, such that the thread touching
+    a page at allocation also works on it in SpMV and vector operations.
+  */
+  class VectorPartition
+  {
+    const Partitioning * part = nullptr;
+    size_t n, fac = 1, nparts;
+  public:
+    VectorPartition (const BaseVector & v, size_t an, size_t anparts = 16)
+      : n(an), nparts(anparts)
+    {
+      auto p = v.GetPartitioning().get();
+      if (p && v.Size() && p->Range().Next() == v.Size() && n % v.Size() == 0 &&
+          p->Size() >= size_t(TaskManager::GetNumThreads()))
+        {
+          part = p;
+          fac = n / v.Size();
+          nparts = p->Size();
+        }
+    }
+    bool IsStatic () const { return part != nullptr; }
+    size_t Size () const { return nparts; }
+    IntRange operator[] (size_t i) const
+    {
+      if (part)
+        return IntRange (fac*(*part)[i].First(), fac*(*part)[i].Next());
+      return ngstd::Range(n).Split (i, nparts);
+    }
+  };
+
+  // f(range) on the flat data of v
+  template <typename FUNC>
+  static void ParallelForVector (const BaseVector & v, size_t n, FUNC f)
+  {
+    VectorPartition vp(v, n);
+    if (vp.IsStatic())
+      ParallelJob ([&vp,&f] (TaskInfo ti) { f (vp[ti.task_nr]); }, vp.Size());
+    else
+      ParallelForRange (n, f);
+  }
+
+  // sum of f(range) over the flat data of v, in a fixed order
+  template <typename TSUM, typename FUNC>
+  static TSUM ParallelSumVector (const BaseVector & v, size_t n, FUNC f)
+  {
+    VectorPartition vp(v, n);
+    ArrayMem<TSUM,64> parts(vp.Size());
+    ParallelJob ([&vp,&f,&parts] (TaskInfo ti)
+                 {
+                   parts[ti.task_nr] = f (vp[ti.task_nr]);
+                 }, vp.Size());
+    TSUM sum = 0.0;
+    for (auto part : parts) sum += part;
+    return sum;
+  }
+
   
   unique_ptr<MultiVector> BaseVector :: CreateMultiVector (size_t cnt) const
   {
@@ -48,14 +110,8 @@ namespace ngla
                          sum += mysum;
                        });
     */
-    double parts[16];
-    ParallelJob ([me,&parts] (TaskInfo ti)
-                 {
-                   auto r = ngstd::Range(me).Split (ti.task_nr, ti.ntasks);
-                   parts[ti.task_nr] = ngbla::L2Norm2 (me.Range(r));
-                 }, 16);
-    double sum = 0;
-    for (double part : parts) sum += part;
+    double sum = ParallelSumVector<double> (*this, me.Size(), [me] (IntRange r)
+                                            { return ngbla::L2Norm2 (me.Range(r)); });
     return sqrt(double(sum));
   }
 
@@ -69,8 +125,8 @@ namespace ngla
     RegionTimer reg(t);
     t.AddFlops (me.Size());
 
-    ParallelFor ( me.Range(),
-                  [me,scal] (size_t i) { me(i) *= scal; });
+    ParallelForVector (*this, me.Size(),
+                       [me,scal] (IntRange r) { me.Range(r) *= scal; });
 
     return *this;
   }
@@ -90,10 +146,8 @@ namespace ngla
     auto fv = FVDouble();
     t.AddFlops (fv.Size());
 
-    ParallelFor ( fv.Range(),
-                  [fv,scal] (size_t i) { fv(i) = scal; },
-                  TasksPerThread(1), TotalCosts(fv.Size())
-                  );
+    ParallelForVector (*this, fv.Size(),
+                       [fv,scal] (IntRange r) { fv.Range(r) = scal; });
     
     return *this; 
   }
@@ -120,8 +174,8 @@ namespace ngla
     
     t.AddFlops (me.Size());
 
-    ParallelFor ( me.Range(),
-                  [me,you,scal] (size_t i) { me(i) = scal * you(i); });
+    ParallelForVector (*this, me.Size(),
+                       [me,you,scal] (IntRange r) { me.Range(r) = scal * you.Range(r); });
     
     return *this;
   }
@@ -155,8 +209,8 @@ namespace ngla
     
     t.AddFlops (me.Size());
 
-    ParallelFor (me.Range(),
-                 [me,you,scal] (size_t i) { me(i) += scal * you(i); });
+    ParallelForVector (*this, me.Size(),
+                       [me,you,scal] (IntRange r) { me.Range(r) += scal * you.Range(r); });
     
     return *this;
   }
@@ -187,6 +241,400 @@ namespace ngla
       InnerProduct (v2, conjugate);
   }
 
+  // the fused kernels work on the local data of sequential vectors
+  static bool LocalVectors (initializer_list<const BaseVector*> vecs)
+  {
+    for (auto v : vecs)
+      {
+        if (v->GetParallelStatus() != NOT_PARALLEL) return false;
+        if (!dynamic_cast<const S_BaseVector<double>*> (v) &&
+            !dynamic_cast<const S_BaseVector<Complex>*> (v)) return false;
+      }
+    return true;
+  }
+
+  static bool ComplexVectors (initializer_list<const BaseVector*> vecs)
+  {
+    for (auto v : vecs)
+      if (!v->IsComplex()) return false;
+    return true;
+  }
+
+  // splits the range into blocks which stay in the cache
+  template <typename FUNC>
+  INLINE void CacheBlocks (IntRange r, FUNC f)
+  {
+    constexpr size_t BS = 1024;
+    for (size_t first = r.First(); first < r.Next(); first += BS)
+      f (IntRange (first, min2 (first+BS, r.Next())));
+  }
+
+  template <typename TSCAL>
+  static void CheckSizes (const char * name, FlatVector<TSCAL> me, initializer_list<FlatVector<TSCAL>> vecs)
+  {
+    for (auto v : vecs)
+      if (v.Size() != me.Size())
+        throw Exception (string("BaseVector::") + name + ": size of me = " + ToString(me.Size())
+                         + " != size of other = " + ToString(v.Size()));
+  }
+
+  
+  void BaseVector :: AddPair (double s1, const BaseVector & v1, BaseVector & y, double s2, const BaseVector & v2)
+  {
+    if (!LocalVectors ({ this, &v1, &y, &v2 }))
+      {
+        Add (s1, v1);
+        y.Add (s2, v2);
+        return;
+      }
+
+    static Timer t("BaseVector::AddPair");
+    RegionTimer reg(t);
+
+    auto me = FVDouble();
+    auto fv1 = v1.FVDouble();
+    auto fy = y.FVDouble();
+    auto fv2 = v2.FVDouble();
+    CheckSizes ("AddPair", me, { fv1, fy, fv2 });
+    t.AddFlops (2*me.Size());
+
+    ParallelForVector (*this, me.Size(), [=] (IntRange r)
+                       {
+                         me.Range(r) += s1 * fv1.Range(r);
+                         fy.Range(r) += s2 * fv2.Range(r);
+                       });
+  }
+
+  void BaseVector :: AddPair (Complex s1, const BaseVector & v1, BaseVector & y, Complex s2, const BaseVector & v2)
+  {
+    if (!LocalVectors ({ this, &v1, &y, &v2 }) || !ComplexVectors ({ this, &v1, &y, &v2 }))
+      {
+        Add (s1, v1);
+        y.Add (s2, v2);
+        return;
+      }
+
+    static Timer t("BaseVector::AddPair, complex");
+    RegionTimer reg(t);
+
+    auto me = FVComplex();
+    auto fv1 = v1.FVComplex();
+    auto fy = y.FVComplex();
+    auto fv2 = v2.FVComplex();
+    CheckSizes ("AddPair", me, { fv1, fy, fv2 });
+    t.AddFlops (8*me.Size());
+
+    ParallelForVector (*this, me.Size(), [=] (IntRange r)
+                       {
+                         me.Range(r) += s1 * fv1.Range(r);
+                         fy.Range(r) += s2 * fv2.Range(r);
+                       });
+  }
+
+  BaseVector & BaseVector :: ScaleAdd (double scal, const BaseVector & v)
+  {
+    if (!LocalVectors ({ this, &v }))
+      {
+        Scale (scal);
+        return Add (1, v);
+      }
+
+    static Timer t("BaseVector::ScaleAdd");
+    RegionTimer reg(t);
+
+    auto me = FVDouble();
+    auto you = v.FVDouble();
+    CheckSizes ("ScaleAdd", me, { you });
+    t.AddFlops (me.Size());
+
+    ParallelForVector (*this, me.Size(), [me,you,scal] (IntRange r)
+                       {
+                         for (size_t i : r)
+                           me(i) = scal * me(i) + you(i);
+                       });
+    return *this;
+  }
+
+  BaseVector & BaseVector :: ScaleAdd (Complex scal, const BaseVector & v)
+  {
+    if (!LocalVectors ({ this, &v }) || !ComplexVectors ({ this, &v }))
+      {
+        Scale (scal);
+        return Add (1, v);
+      }
+
+    static Timer t("BaseVector::ScaleAdd, complex");
+    RegionTimer reg(t);
+
+    auto me = FVComplex();
+    auto you = v.FVComplex();
+    CheckSizes ("ScaleAdd", me, { you });
+    t.AddFlops (4*me.Size());
+
+    ParallelForVector (*this, me.Size(), [me,you,scal] (IntRange r)
+                       {
+                         for (size_t i : r)
+                           me(i) = scal * me(i) + you(i);
+                       });
+    return *this;
+  }
+
+  double BaseVector :: AddInnerProductD (double scal, const BaseVector & v, const BaseVector & w)
+  {
+    if (!LocalVectors ({ this, &v, &w }) || IsComplex() || v.IsComplex() || w.IsComplex())
+      {
+        Add (scal, v);
+        return InnerProductD (w);
+      }
+
+    static Timer t("BaseVector::AddInnerProduct");
+    RegionTimer reg(t);
+
+    auto me = FVDouble();
+    auto fv = v.FVDouble();
+    auto fw = w.FVDouble();
+    CheckSizes ("AddInnerProduct", me, { fv, fw });
+    t.AddFlops (2*me.Size());
+
+    return ParallelSumVector<double> (*this, me.Size(), [me,fv,fw,scal] (IntRange r)
+                                      {
+                                        double sum = 0;
+                                        CacheBlocks (r, [&] (IntRange rb)
+                                                     {
+                                                       me.Range(rb) += scal * fv.Range(rb);
+                                                       sum += ngbla::InnerProduct (me.Range(rb), fw.Range(rb));
+                                                     });
+                                        return sum;
+                                      });
+  }
+
+  Complex BaseVector :: AddInnerProductC (Complex scal, const BaseVector & v, const BaseVector & w,
+                                          bool conjugate)
+  {
+    if (!LocalVectors ({ this, &v, &w }) || !ComplexVectors ({ this, &v, &w }))
+      {
+        Add (scal, v);
+        return InnerProductC (w, conjugate);
+      }
+
+    static Timer t("BaseVector::AddInnerProduct, complex");
+    RegionTimer reg(t);
+
+    auto me = FVComplex();
+    auto fv = v.FVComplex();
+    auto fw = w.FVComplex();
+    CheckSizes ("AddInnerProduct", me, { fv, fw });
+    t.AddFlops (8*me.Size());
+
+    return ParallelSumVector<Complex> (*this, me.Size(), [me,fv,fw,scal,conjugate] (IntRange r)
+                                       {
+                                         Complex sum = 0;
+                                         CacheBlocks (r, [&] (IntRange rb)
+                                                      {
+                                                        me.Range(rb) += scal * fv.Range(rb);
+                                                        if (conjugate)
+                                                          sum += ngbla::InnerProduct (me.Range(rb), Conj(fw.Range(rb)));
+                                                        else
+                                                          sum += ngbla::InnerProduct (me.Range(rb), fw.Range(rb));
+                                                      });
+                                         return sum;
+                                       });
+  }
+
+  double BaseVector :: AddL2Norm (double scal, const BaseVector & v)
+  {
+    if (!LocalVectors ({ this, &v }))
+      {
+        Add (scal, v);
+        return L2Norm();
+      }
+
+    static Timer t("BaseVector::AddL2Norm");
+    RegionTimer reg(t);
+
+    auto me = FVDouble();
+    auto fv = v.FVDouble();
+    CheckSizes ("AddL2Norm", me, { fv });
+    t.AddFlops (2*me.Size());
+
+    double sum = ParallelSumVector<double> (*this, me.Size(), [me,fv,scal] (IntRange r)
+                                            {
+                                              double sum = 0;
+                                              CacheBlocks (r, [&] (IntRange rb)
+                                                           {
+                                                             me.Range(rb) += scal * fv.Range(rb);
+                                                             sum += ngbla::L2Norm2 (me.Range(rb));
+                                                           });
+                                              return sum;
+                                            });
+    return sqrt(sum);
+  }
+
+  double BaseVector :: AddL2Norm (Complex scal, const BaseVector & v)
+  {
+    if (!LocalVectors ({ this, &v }) || !ComplexVectors ({ this, &v }))
+      {
+        Add (scal, v);
+        return L2Norm();
+      }
+
+    static Timer t("BaseVector::AddL2Norm, complex");
+    RegionTimer reg(t);
+
+    auto me = FVComplex();
+    auto fv = v.FVComplex();
+    CheckSizes ("AddL2Norm", me, { fv });
+    auto med = FVDouble();
+    t.AddFlops (6*me.Size());
+
+    double sum = ParallelSumVector<double> (*this, me.Size(), [me,med,fv,scal] (IntRange r)
+                                            {
+                                              double sum = 0;
+                                              CacheBlocks (r, [&] (IntRange rb)
+                                                           {
+                                                             me.Range(rb) += scal * fv.Range(rb);
+                                                             sum += ngbla::L2Norm2 (med.Range(2*rb.First(), 2*rb.Next()));
+                                                           });
+                                              return sum;
+                                            });
+    return sqrt(sum);
+  }
+
+
+
+  // me = / += sum_k scal_k src_k, the result of a block stays in cache
+  template <typename TSCAL>
+  static void LinearCombinationSweep (const BaseVector & v, FlatVector<TSCAL> me, FlatArray<TSCAL> scal,
+                                      FlatArray<const BaseVector*> src, bool add)
+  {
+    size_t n = me.Size();
+    // terms reading the target itself only scale it, e.g. x = 0.5*x - y
+    TSCAL selfscal = add ? TSCAL(1.0) : TSCAL(0.0);
+    Array<size_t> terms;
+    Array<void*> mem(src.Size());
+    for (size_t k = 0; k < src.Size(); k++)
+      {
+        mem[k] = src[k]->Memory();
+        if (mem[k] == me.Data())
+          selfscal += scal[k];
+        else
+          terms.Append (k);
+      }
+
+    ParallelForVector (v, n, [&] (IntRange r)
+                      {
+                        CacheBlocks (r, [&] (IntRange rb)
+                                     {
+                                       auto meb = me.Range(rb);
+                                       if (selfscal == TSCAL(0.0))
+                                         meb = TSCAL(0.0);
+                                       else if (selfscal != TSCAL(1.0))
+                                         meb *= selfscal;
+                                       for (size_t k : terms)
+                                         if (is_same<TSCAL,Complex>::value && src[k]->IsComplex())
+                                           meb += scal[k] * FlatVector<TSCAL> (n, mem[k]).Range(rb);
+                                         else
+                                           meb += scal[k] * FlatVector<double> (n, mem[k]).Range(rb);
+                                     });
+                      });
+  }
+
+  void DynamicLinearCombination :: Evaluate (BaseVector & v2, bool add) const
+  {
+    bool fused = vecs.Size() > 0 && LocalVectors ({ &v2 });
+    for (auto v : vecs)
+      if (!LocalVectors ({ v })) fused = false;
+
+    if (fused)
+      {
+        if (complex && !v2.IsComplex())
+          fused = false;
+        else
+          {
+            size_t n = complex ? v2.FVComplex().Size() : v2.FVDouble().Size();
+            for (auto v : vecs)
+              {
+                size_t nv = (complex && v->IsComplex()) ? v->FVComplex().Size() : v->FVDouble().Size();
+                if (nv != n) fused = false;
+              }
+          }
+      }
+
+    bool first = !add;
+    if (fused)
+      {
+        static Timer t("DynamicLinearCombination - fused");
+        RegionTimer reg(t);
+        if (complex)
+          LinearCombinationSweep<Complex> (v2, v2.FVComplex(), vscal, vecs, add);
+        else
+          {
+            Array<double> rscal(vscal.Size());
+            for (size_t i = 0; i < vscal.Size(); i++)
+              rscal[i] = vscal[i].real();
+            LinearCombinationSweep<double> (v2, v2.FVDouble(), rscal, vecs, add);
+          }
+        first = false;
+      }
+    else
+      {
+        // terms reading the target go first, they only scale it
+        Complex selfscal = add ? 1.0 : 0.0;
+        bool self = false;
+        for (size_t i = 0; i < vecs.Size(); i++)
+          if (vecs[i] == &v2)
+            {
+              selfscal += vscal[i];
+              self = true;
+            }
+        if (self)
+          {
+            if (complex)
+              v2 *= selfscal;
+            else
+              v2 *= selfscal.real();
+            first = false;
+          }
+        
+        for (size_t i = 0; i < vecs.Size(); i++)
+          {
+            if (vecs[i] == &v2)
+              continue;
+            if (complex)
+              {
+                if (first) v2.Set (vscal[i], *vecs[i]);
+                else v2.Add (vscal[i], *vecs[i]);
+              }
+            else
+              {
+                if (first) v2.Set (vscal[i].real(), *vecs[i]);
+                else v2.Add (vscal[i].real(), *vecs[i]);
+              }
+            first = false;
+          }
+      }
+
+    for (size_t i = 0; i < exprs.Size(); i++)
+      {
+        if (complex)
+          {
+            if (first) exprs[i]->AssignTo (escal[i], v2);
+            else exprs[i]->AddTo (escal[i], v2);
+          }
+        else
+          {
+            if (first) exprs[i]->AssignTo (escal[i].real(), v2);
+            else exprs[i]->AddTo (escal[i].real(), v2);
+          }
+        first = false;
+      }
+
+    if (first)
+      v2 = 0.0;
+  }
+
+
+
   /*
   AutoVector BaseVector ::Range (size_t begin, size_t end) const
   {
@@ -638,8 +1086,8 @@ namespace ngla
     RegionTimer reg(t);
     
     auto me = FVScal();
-    ParallelForRange (me.Size(),
-                      [me, scal] (IntRange r) { me.Range(r) = scal; });
+    ParallelForVector (*this, me.Size(),
+                       [me, scal] (IntRange r) { me.Range(r) = scal; });
     
     // FVScal() = scal;
     return *this;
@@ -680,15 +1128,8 @@ namespace ngla
                         scal += myscal;
                       } );
     */
-    double parts[16];
-    ParallelJob ([me,you,&parts] (TaskInfo ti)
-                 {
-                   auto r = ngstd::Range(me).Split (ti.task_nr, ti.ntasks);
-                   parts[ti.task_nr] =  ngbla::InnerProduct (me.Range(r), you.Range(r));
-                 }, 16);
-    double scal = 0;
-    for (double part : parts) scal += part;
-    return scal;
+    return ParallelSumVector<double> (*this, me.Size(), [me,you] (IntRange r)
+                                      { return ngbla::InnerProduct (me.Range(r), you.Range(r)); });
   }
 
 
@@ -897,10 +1338,7 @@ namespace ngla
   S_BaseVectorPtr<TSCAL> :: ~S_BaseVectorPtr ()
   {
     if (ownmem)
-      {
-        GetMemoryTracer().Free(sizeof(TSCAL) * this->entrysize * this->size);
-        delete [] pdata;
-      }
+      FreeData ();
   }
 
   template <typename TSCAL>
@@ -908,11 +1346,11 @@ namespace ngla
   {
     switch (es)
       {
-      case 1: return make_unique<VVector<TSCAL>> (this->size);
-      case 2: return make_unique<VVector<Vec<2,TSCAL>>> (this->size);
-      case 3: return make_unique<VVector<Vec<3,TSCAL>>> (this->size);
+      case 1: return make_unique<VVector<TSCAL>> (this->size, this->partition);
+      case 2: return make_unique<VVector<Vec<2,TSCAL>>> (this->size, this->partition);
+      case 3: return make_unique<VVector<Vec<3,TSCAL>>> (this->size, this->partition);
       }
-    return make_unique<S_BaseVectorPtr<TSCAL>> (this->size, es);
+    return make_unique<S_BaseVectorPtr<TSCAL>> (this->size, es, this->partition);
   }
   
   template <typename TSCAL>
@@ -1217,10 +1655,409 @@ namespace ngla
 
   };
 
+  /*
+    component of a ContiguousMultiVector, keeps its memory block alive.
+   */
+  template <typename TSCAL>
+  class ContiguousMVComponent : public S_BaseVectorPtr<TSCAL>
+  {
+    shared_ptr<Array<TSCAL>> block;
+  public:
+    ContiguousMVComponent (size_t as, int aes, shared_ptr<Array<TSCAL>> ablock, TSCAL * adata)
+      : S_BaseVectorPtr<TSCAL> (as, aes, adata), block(ablock) { ; }
+  };
+
+  
+  /*
+    The component vectors are stored in a chain of blocks, within a block
+    they are the rows of a row-major matrix. Growing allocates a new block
+    for the new vectors only, vectors handed out before are never moved.
+    Inner products and linear combinations are matrix-matrix products
+    on the groups of equally spaced vectors (one per block, or fewer after
+    Replace or SubSet), other operands use the pointer-based kernels
+    of BaseVectorPtrMV.
+   */
+  template <typename TSCAL>
+  class ContiguousMultiVector : public BaseVectorPtrMV
+  {
+    shared_ptr<Array<TSCAL>> block;   // the block new vectors go to, nullptr for views
+    size_t capacity = 0;              // vectors fitting into block
+    size_t used = 0;                  // vectors in block
+    bool view;
+    size_t n;      // scalars per vector
+    int es;        // scalars per entry
+
+    static constexpr size_t BS = 256;
+
+    /// consecutive component vectors, equally spaced in memory
+    struct Segment
+    {
+      size_t first, next, dist;
+      TSCAL * data;
+      IntRange Rows() const { return IntRange(first, next); }
+      SliceMatrix<TSCAL> Mat (size_t width) const
+      { return SliceMatrix<TSCAL> (next-first, width, dist, data); }
+    };
+    
+  public:
+    ContiguousMultiVector (shared_ptr<BaseVector> arefvec, size_t cnt, bool aview = false)
+      : BaseVectorPtrMV (arefvec, 0), view(aview)
+    {
+      es = arefvec->EntrySize() * sizeof(double) / sizeof(TSCAL);
+      n = arefvec->Size() * es;
+      if (!view)
+        Extend (cnt);
+    }
+
+    /// splits the component vectors into maximal groups which are rows of a matrix
+    static bool AsMatrices (const MultiVector & mv, Array<Segment> & segs, size_t & width)
+    {
+      segs.SetSize0();
+      size_t cnt = mv.Size();
+      if (cnt == 0) return false;
+      for (size_t i = 0; i < cnt; i++)
+        {
+          auto vi = dynamic_cast<const S_BaseVectorPtr<TSCAL>*> (mv[i].get());
+          if (!vi || vi->GetParallelStatus() != NOT_PARALLEL) return false;
+          TSCAL * pi = static_cast<TSCAL*> (vi->Memory());
+          size_t wi = vi->Size() * vi->EntrySize() * sizeof(double) / sizeof(TSCAL);
+          if (i == 0)
+            width = wi;
+          else if (wi != width)
+            return false;
+
+          if (segs.Size())
+            {
+              auto & last = segs.Last();
+              TSCAL * prev = last.data + (last.next-last.first-1) * last.dist;
+              if (pi > prev && size_t(pi-prev) >= width &&
+                  (last.next-last.first == 1 || size_t(pi-prev) == last.dist))
+                {
+                  last.dist = pi-prev;
+                  last.next++;
+                  continue;
+                }
+            }
+          segs.Append (Segment { i, i+1, width, pi });
+        }
+      return true;
+    }
+
+    static bool Overlap (SliceMatrix<TSCAL> a, SliceMatrix<TSCAL> b)
+    {
+      TSCAL * a0 = a.Data(), * a1 = a.Data() + (a.Height()-1)*a.Dist() + a.Width();
+      TSCAL * b0 = b.Data(), * b1 = b.Data() + (b.Height()-1)*b.Dist() + b.Width();
+      return a0 < b1 && b0 < a1;
+    }
+
+    
+    void Extend (size_t nr = 1) override
+    {
+      if (view)   // views don't own memory
+        {
+          BaseVectorPtrMV::Extend (nr);
+          return;
+        }
+      
+      size_t cnt = vecs.Size();
+      if (used+nr > capacity)
+        {
+          // the old block stays alive as long as its vectors
+          capacity = max2 (nr, cnt);
+          block = make_shared<Array<TSCAL>> (capacity*n);
+          used = 0;
+        }
+      for (size_t i = 0; i < nr; i++, used++)
+        vecs.Append (make_shared<ContiguousMVComponent<TSCAL>> (refvec->Size(), es, block, block->Data()+used*n));
+    }
+
+    void Append (shared_ptr<BaseVector> v) override
+    {
+      Extend (1);
+      *vecs.Last() = *v;
+    }
+    
+    unique_ptr<MultiVector> Range (IntRange r) const override
+    {
+      auto mv2 = make_unique<ContiguousMultiVector>(refvec, 0, true);
+      for (auto i : r)
+        mv2->vecs.Append (vecs[i]);
+      return mv2;
+    }
+
+    unique_ptr<MultiVector> SubSet (const Array<int> & indices) const override
+    {
+      auto mv2 = make_unique<ContiguousMultiVector>(refvec, 0, true);
+      for (auto i : indices)
+        mv2->vecs.Append (vecs[i]);
+      return mv2;
+    }
+
+    
+    /// res = a * Trans(b), or a * Trans(Conj(b))
+    static void RowInnerProducts (SliceMatrix<TSCAL> a, SliceMatrix<TSCAL> b, bool conjugate,
+                                  SliceMatrix<TSCAL> res)
+    {
+      // the partition depends on the sizes only, and the partial sums
+      // are added in a fixed order: results are reproducible
+      size_t ha = a.Height(), hb = b.Height();
+      size_t nparts = min3 ((a.Width()+4*BS-1) / (4*BS), (size_t(1) << 22) / (ha*hb), size_t(256));
+      nparts = max2 (nparts, size_t(1));
+      Array<TSCAL> partial(nparts*ha*hb);
+      ParallelFor (nparts, [&] (size_t part)
+                   {
+                     IntRange r = ngstd::Range(a.Width()).Split (part, nparts);
+                     FlatMatrix<TSCAL> sum(ha, hb, partial.Addr(part*ha*hb));
+                     Matrix<TSCAL> hbt(hb, BS);
+                     sum = TSCAL(0.0);
+                     for (size_t i = r.First(); i < r.Next(); i += BS)
+                       {
+                         IntRange ri(i, min2(i+BS, r.Next()));
+                         if constexpr (is_same<TSCAL,Complex>::value)
+                           if (conjugate)
+                             {
+                               auto hbi = hbt.Cols(0, ri.Size());
+                               hbi = Conj(b.Cols(ri));
+                               sum += a.Cols(ri) * Trans(hbi);
+                               continue;
+                             }
+                         sum += a.Cols(ri) * Trans(b.Cols(ri));
+                       }
+                   });
+      
+      for (size_t i = 0; i < ha; i++)
+        for (size_t j = 0; j < hb; j++)
+          {
+            TSCAL sum = partial[i*hb+j];
+            for (size_t part = 1; part < nparts; part++)
+              sum += partial[(part*ha+i)*hb+j];
+            res(i,j) = sum;
+          }
+    }
+
+    /// res = (*this) * Trans(v2), conjugated v2 if conjugate
+    bool RowInnerProducts (const MultiVector & v2, bool conjugate, FlatMatrix<TSCAL> res) const
+    {
+      Array<Segment> sa, sb;
+      size_t wa, wb;
+      if (!AsMatrices (*this, sa, wa) || !AsMatrices (v2, sb, wb) || wa != wb)
+        return false;
+      for (auto & a : sa)
+        for (auto & b : sb)
+          RowInnerProducts (a.Mat(wa), b.Mat(wb), conjugate, res.Rows(a.Rows()).Cols(b.Rows()));
+      return true;
+    }
+    
+    Matrix<> InnerProductD (const MultiVector & v2) const override
+    {
+      if constexpr (is_same<TSCAL,double>::value)
+        {
+          static Timer t("ContiguousMultiVector::InnerProductD");
+          RegionTimer reg(t);
+          Matrix<> res(Size(), v2.Size());
+          if (RowInnerProducts (v2, false, res))
+            {
+              t.AddFlops (Size()*v2.Size()*n);
+              return res;
+            }
+        }
+      return BaseVectorPtrMV::InnerProductD (v2);
+    }
+
+    Matrix<Complex> InnerProductC (const MultiVector & v2, bool conjugate) const override
+    {
+      if constexpr (is_same<TSCAL,Complex>::value)
+        {
+          static Timer t("ContiguousMultiVector::InnerProductC");
+          RegionTimer reg(t);
+          Matrix<Complex> res(Size(), v2.Size());
+          if (RowInnerProducts (v2, conjugate, res))
+            {
+              t.AddFlops (4*Size()*v2.Size()*n);
+              return res;
+            }
+        }
+      return BaseVectorPtrMV::InnerProductC (v2, conjugate);
+    }
+
+    Vector<> InnerProductD (const BaseVector & v2) const override
+    {
+      if constexpr (is_same<TSCAL,double>::value)
+        {
+          Array<Segment> sa;
+          size_t wa;
+          if (AsMatrices (*this, sa, wa) && v2.FVDouble().Size() == wa)
+            {
+              static Timer t("ContiguousMultiVector::InnerProductD - vec");
+              RegionTimer reg(t);
+              t.AddFlops (Size()*wa);
+              FlatMatrix<double> bv(1, wa, v2.FVDouble().Data());
+              Matrix<> res(Size(), 1);
+              for (auto & a : sa)
+                RowInnerProducts (a.Mat(wa), bv, false, res.Rows(a.Rows()));
+              return res.Col(0);
+            }
+        }
+      return BaseVectorPtrMV::InnerProductD (v2);
+    }
+
+    
+    // me[i] += v2[j] mat(j,i)
+    template <typename TM>
+    bool AddMatrix (const MultiVector & v2, FlatMatrix<TM> mat)
+    {
+      if constexpr (!is_same<TSCAL,TM>::value)
+        return false;
+      else
+        {
+          Array<Segment> sa, sb;
+          size_t wa, wb;
+          if (!AsMatrices (*this, sa, wa) || !AsMatrices (v2, sb, wb))
+            return false;
+          if (wa != wb || mat.Height() != v2.Size() || mat.Width() != Size())
+            return false;
+          for (auto & a : sa)
+            for (auto & b : sb)
+              if (Overlap (a.Mat(wa), b.Mat(wb)))
+                return false;
+
+          static Timer t("ContiguousMultiVector::Add");
+          RegionTimer reg(t);
+          t.AddFlops (Size()*v2.Size()*wa);
+          ParallelForRange (wa, [&] (IntRange r)
+                            {
+                              for (size_t i = r.First(); i < r.Next(); i += BS)
+                                {
+                                  IntRange ri(i, min2(i+BS, r.Next()));
+                                  for (auto & a : sa)
+                                    for (auto & b : sb)
+                                      a.Mat(wa).Cols(ri) +=
+                                        Trans(mat.Rows(b.Rows()).Cols(a.Rows())) * b.Mat(wb).Cols(ri);
+                                }
+                            });
+          return true;
+        }
+    }
+    
+    void Add (const MultiVector & v2, FlatMatrix<double> mat) override
+    {
+      if (!AddMatrix (v2, mat))
+        BaseVectorPtrMV::Add (v2, mat);
+    }
+
+    void Add (const MultiVector & v2, FlatMatrix<Complex> mat) override
+    {
+      if (!AddMatrix (v2, mat))
+        BaseVectorPtrMV::Add (v2, mat);
+    }
+
+    
+    // v2 += sum_i vec(i) * me[i]
+    template <typename TV>
+    bool AddToVector (FlatVector<TV> vec, BaseVector & v2)
+    {
+      if constexpr (!is_same<TSCAL,TV>::value)
+        return false;
+      else
+        {
+          Array<Segment> sa;
+          size_t wa;
+          if (!AsMatrices (*this, sa, wa)) return false;
+          if (v2.FV<TSCAL>().Size() != wa || vec.Size() != Size())
+            return false;
+          FlatVector<TSCAL> fv2 = v2.FV<TSCAL>();
+          ParallelForRange (wa, [&] (IntRange r)
+                            {
+                              for (auto & a : sa)
+                                fv2.Range(r) += Trans(a.Mat(wa).Cols(r)) * vec.Range(a.Rows());
+                            });
+          return true;
+        }
+    }
+
+    void AddTo (FlatVector<double> vec, BaseVector & v2) override
+    {
+      if (!AddToVector (vec, v2))
+        BaseVectorPtrMV::AddTo (vec, v2);
+    }
+
+    void AddTo (FlatVector<Complex> vec, BaseVector & v2) override
+    {
+      if (!AddToVector (vec, v2))
+        BaseVectorPtrMV::AddTo (vec, v2);
+    }
+
+    
+    // v[i] = s[i] * me[i], or v[i] += s[i] * me[i]
+    template <typename TS>
+    bool ScaleTo (FlatVector<TS> s, MultiVector & v, bool add) const
+    {
+      if constexpr (!is_same<TSCAL,TS>::value && !is_same<TS,double>::value)
+        return false;
+      else
+        {
+          Array<Segment> sa, sb;
+          size_t wa, wb;
+          if (!AsMatrices (*this, sa, wa) || !AsMatrices (v, sb, wb))
+            return false;
+          if (wa != wb || v.Size() != Size() || s.Size() != Size())
+            return false;
+          auto rows = [] (FlatArray<Segment> segs)
+            {
+              Array<TSCAL*> ptrs;
+              for (auto & seg : segs)
+                for (size_t i = 0; i < seg.next-seg.first; i++)
+                  ptrs.Append (seg.data + i*seg.dist);
+              return ptrs;
+            };
+          Array<TSCAL*> pa = rows(sa), pb = rows(sb);
+          ParallelForRange (wa, [&] (IntRange r)
+                            {
+                              for (size_t i = 0; i < pa.Size(); i++)
+                                {
+                                  FlatVector<TSCAL> a(wa, pa[i]), b(wa, pb[i]);
+                                  if (add)
+                                    b.Range(r) += s(i) * a.Range(r);
+                                  else
+                                    b.Range(r) = s(i) * a.Range(r);
+                                }
+                            });
+          return true;
+        }
+    }
+
+    void AssignTo (FlatVector<double> s, MultiVector & v) const override
+    {
+      if (!ScaleTo (s, v, false))
+        BaseVectorPtrMV::AssignTo (s, v);
+    }
+
+    void AddTo (FlatVector<double> s, MultiVector & v) const override
+    {
+      if (!ScaleTo (s, v, true))
+        BaseVectorPtrMV::AddTo (s, v);
+    }
+
+    void AssignTo (FlatVector<Complex> s, MultiVector & v) const override
+    {
+      if (!ScaleTo (s, v, false))
+        BaseVectorPtrMV::AssignTo (s, v);
+    }
+
+    void AddTo (FlatVector<Complex> s, MultiVector & v) const override
+    {
+      if (!ScaleTo (s, v, true))
+        BaseVectorPtrMV::AddTo (s, v);
+    }
+  };
+
+  
   template <typename TSCAL>  
   unique_ptr<MultiVector> S_BaseVectorPtr<TSCAL> ::
     CreateMultiVector (size_t cnt) const 
   {
+    if (this->GetParallelStatus() == NOT_PARALLEL)
+      return make_unique<ContiguousMultiVector<TSCAL>> (CreateVector(), cnt);
     return make_unique<BaseVectorPtrMV> (CreateVector(), cnt);
   }
   
@@ -93,6 +93,8 @@ namespace ngla
     size_t size;
     /// number of doubles per entry
     int entrysize;
+    /// static partitioning of the entries (e.g. the matrix rows)
+    shared_ptr<Partitioning> partition;
     ///
     // shared_ptr<ParallelDofs> paralleldofs;
 
@@ -134,6 +136,10 @@ namespace ngla
     {
       SetScalar(0);
     }
+
+    /// first touch and vector operations follow the partitioning, one range per task
+    void SetPartitioning (shared_ptr<Partitioning> apartition) { partition = apartition; }
+    shared_ptr<Partitioning> GetPartitioning () const { return partition; }
     
     ///
     template <typename T>
@@ -251,6 +257,24 @@ namespace ngla
     virtual BaseVector & Add (double scal, const BaseVector & v);
     virtual BaseVector & Add (Complex scal, const BaseVector & v);
 
+    /*
+      fused kernels: one sweep over the data of sequential vectors,
+      distributed vectors use the composed operations.
+    */
+    /// this += s1 * v1,  y += s2 * v2
+    virtual void AddPair (double s1, const BaseVector & v1, BaseVector & y, double s2, const BaseVector & v2);
+    virtual void AddPair (Complex s1, const BaseVector & v1, BaseVector & y, Complex s2, const BaseVector & v2);
+    /// this = scal * this + v
+    virtual BaseVector & ScaleAdd (double scal, const BaseVector & v);
+    virtual BaseVector & ScaleAdd (Complex scal, const BaseVector & v);
+    /// this += scal * v,  returns <this, w>
+    virtual double AddInnerProductD (double scal, const BaseVector & v, const BaseVector & w);
+    virtual Complex AddInnerProductC (Complex scal, const BaseVector & v, const BaseVector & w,
+                                      bool conjugate = false);
+    /// this += scal * v,  returns the L2-norm of the result
+    virtual double AddL2Norm (double scal, const BaseVector & v);
+    virtual double AddL2Norm (Complex scal, const BaseVector & v);
+
     virtual ostream & Print (ostream & ost) const;
     virtual void Save(ostream & ost) const;
     virtual void Load(istream & ist);
@@ -1134,6 +1158,22 @@ namespace ngla
     // return InnerProduct( v2.FVComplex(), Conj(v1.FVComplex()) );
   }
 
+  /// v1 += scal * v, returns S_InnerProduct<IPTYPE> (v1, v2)
+  template <class IPTYPE>
+  inline typename SCAL_TRAIT<IPTYPE>::SCAL
+  S_AddInnerProduct (BaseVector & v1, typename SCAL_TRAIT<IPTYPE>::SCAL scal,
+                     const BaseVector & v, const BaseVector & v2)
+  {
+    if constexpr (is_same<IPTYPE,double>::value)
+      return v1.AddInnerProductD (scal, v, v2);
+    else if constexpr (is_same<IPTYPE,Complex>::value)
+      return v1.AddInnerProductC (scal, v, v2);
+    else if constexpr (is_same<IPTYPE,ComplexConjugate>::value)
+      return v1.AddInnerProductC (scal, v, v2, true);
+    else
+      return conj (v1.AddInnerProductC (scal, v, v2, true));
+  }
+
   ///
   inline double L2Norm (const BaseVector & v)
   {
@@ -1149,6 +1189,33 @@ namespace ngla
 
 
 
+  class DynamicBaseExpression;
+
+  /**
+     Flattened expression  sum_i vscal_i vecs_i + sum_j escal_j exprs_j.
+     The vector terms are evaluated in one sweep over the memory, 
+     the remaining terms (matrix-vector products, ...) are added afterwards.
+  */
+  class NGS_DLL_HEADER DynamicLinearCombination
+  {
+  public:
+    Array<Complex> vscal;
+    Array<const BaseVector*> vecs;
+    Array<Complex> escal;
+    Array<const DynamicBaseExpression*> exprs;
+    /// some scaling factor is complex
+    bool complex = false;
+
+    void AddVector (Complex s, const BaseVector * v)
+    { vscal.Append (s); vecs.Append (v); }
+    void AddExpression (Complex s, const DynamicBaseExpression * e)
+    { escal.Append (s); exprs.Append (e); }
+
+    /// v2 = sum (add = false), or v2 += sum (add = true)
+    void Evaluate (BaseVector & v2, bool add) const;
+  };
+
+
   class DynamicBaseExpression 
   {
   protected:
@@ -1160,6 +1227,9 @@ namespace ngla
     virtual void AddTo (double s, BaseVector & v2) const = 0;
     virtual void AssignTo (Complex s, BaseVector & v2) const = 0;
     virtual void AddTo (Complex s, BaseVector & v2) const = 0;
+    /// splits the expression tree into vector terms and other terms
+    virtual void CollectTerms (Complex s, DynamicLinearCombination & lc) const
+    { lc.AddExpression (s, this); }
   };
 
 
@@ -1179,6 +1249,8 @@ namespace ngla
     { v2.Set (s, *a); }
     void AddTo (Complex s, BaseVector & v2) const override
     { v2.Add (s, *a); }
+    void CollectTerms (Complex s, DynamicLinearCombination & lc) const override
+    { lc.AddVector (s, a.get()); }
   };
 
   class DynamicSumExpression : public DynamicBaseExpression
@@ -1207,6 +1279,11 @@ namespace ngla
       a->AddTo(s, v2);
       b->AddTo(s, v2);
     }
+    void CollectTerms (Complex s, DynamicLinearCombination & lc) const override
+    {
+      a->CollectTerms(s, lc);
+      b->CollectTerms(s, lc);
+    }
   public:
     DynamicSumExpression (shared_ptr<DynamicBaseExpression> aa,
                           shared_ptr<DynamicBaseExpression> ab)
@@ -1240,6 +1317,11 @@ namespace ngla
       a->AddTo(s, v2);
       b->AddTo(-s, v2);
     }
+    void CollectTerms (Complex s, DynamicLinearCombination & lc) const override
+    {
+      a->CollectTerms(s, lc);
+      b->CollectTerms(-s, lc);
+    }
   public:
     DynamicSubExpression (shared_ptr<DynamicBaseExpression> aa,
                           shared_ptr<DynamicBaseExpression> ab)
@@ -1271,6 +1353,12 @@ namespace ngla
     {
       a->AddTo(s*scale, v2);
     }
+    void CollectTerms (Complex s, DynamicLinearCombination & lc) const override
+    {
+      if constexpr (is_same<T,Complex>::value)
+        lc.complex = true;
+      a->CollectTerms(s*scale, lc);
+    }
   public:
     DynamicScaleExpression (T ascale, shared_ptr<DynamicBaseExpression> aa)
       : scale(ascale), a(aa) { ; } 
@@ -1291,18 +1379,33 @@ namespace ngla
     AutoVector Evaluate() const
     {
       auto vec = ve->CreateVector();
-      ve->AssignTo (1, vec);
+      AssignTo (1.0, vec);
       return vec;
     }
+
+    /// evaluates chained sums of vectors in one sweep
+    void FusedEvaluate (double s, BaseVector & v2, bool add) const
+    {
+      DynamicLinearCombination lc;
+      ve->CollectTerms (s, lc);
+      lc.Evaluate (v2, add);
+    }
+    void FusedEvaluate (Complex s, BaseVector & v2, bool add) const
+    {
+      DynamicLinearCombination lc;
+      lc.complex = true;
+      ve->CollectTerms (s, lc);
+      lc.Evaluate (v2, add);
+    }
     
     void AssignTo (double s, BaseVector & v2) const
-    { ve->AssignTo(s,v2); }
+    { FusedEvaluate(s,v2,false); }
     void AddTo (double s, BaseVector & v2) const
-    { ve->AddTo(s,v2); }
+    { FusedEvaluate(s,v2,true); }
     void AssignTo (Complex s, BaseVector & v2) const
-    { ve->AssignTo(s,v2); }
+    { FusedEvaluate(s,v2,false); }
     void AddTo (Complex s, BaseVector & v2) const
-    { ve->AddTo(s,v2); }
+    { FusedEvaluate(s,v2,true); }
     auto Ptr() const { return ve; }
   };
 
@@ -0,0 +1,356 @@
+/*
+   Flat binary images of sparse matrices and vectors
+*/
+
+#include <la.hpp>
+
+#include <cstring>
+#include <fstream>
+#ifdef WIN32
+#include <cstdio>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ngla
+{
+  namespace
+  {
+    constexpr char binary_magic[8] = { 'N','G','S','B','I','N','\0','\0' };
+    constexpr uint32_t binary_version = 1;
+    constexpr size_t binary_alignment = 64;
+    enum BINARY_KIND : uint32_t { BINARY_SPARSEMATRIX = 0, BINARY_VECTOR = 1 };
+    
+    struct BinaryHeader
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t kind;
+      uint32_t is_complex;
+      uint32_t symmetric;
+      int32_t entry_height, entry_width;   // entry size in scalars for vectors 
+      int64_t height, width, nze;
+      uint64_t offset_firsti, offset_colnr, offset_values;
+      uint64_t filesize;
+    };
+
+    size_t AlignUp (size_t n)
+    {
+      return (n + binary_alignment-1) / binary_alignment * binary_alignment;
+    }
+
+    BinaryHeader NewHeader (BINARY_KIND kind)
+    {
+      BinaryHeader header;
+      memset (&header, 0, sizeof(header));
+      memcpy (header.magic, binary_magic, sizeof(binary_magic));
+      header.version = binary_version;
+      header.kind = kind;
+      return header;
+    }
+
+    void WritePadded (ofstream & out, const void * data, size_t bytes)
+    {
+      out.write (static_cast<const char*>(data), bytes);
+      static const char zeros[binary_alignment] = { 0 };
+      out.write (zeros, AlignUp(bytes)-bytes);
+    }
+    
+    /// count entries of size elsize starting at offset must lie within the file
+    void CheckRange (const MappedFile & file, uint64_t offset, uint64_t count, uint64_t elsize)
+    {
+      if (offset < sizeof(BinaryHeader) || offset % binary_alignment != 0 || offset > file.Size())
+        throw Exception ("LoadBinary: corrupt file, invalid array offset");
+      if (count > (file.Size()-offset) / elsize)
+        throw Exception ("LoadBinary: corrupt file, array exceeds file size");
+    }
+    
+    const BinaryHeader & CheckHeader (const MappedFile & file, BINARY_KIND kind)
+    {
+      if (file.Size() < sizeof(BinaryHeader))
+        throw Exception ("LoadBinary: file too short");
+      auto & header = *static_cast<const BinaryHeader*> (file.Data());
+      if (memcmp (header.magic, binary_magic, sizeof(binary_magic)) != 0 ||
+          header.version != binary_version)
+        throw Exception ("LoadBinary: not an ngsolve binary file");
+      if (header.kind != kind)
+        throw Exception (kind == BINARY_VECTOR ? "LoadBinary: file does not contain a vector"
+                         : "LoadBinary: file does not contain a sparse matrix");
+      if (header.filesize != file.Size())
+        throw Exception ("LoadBinary: file size mismatch, file truncated ?");
+
+      if (header.height < 0 || header.width < 0 || header.nze < 0 ||
+          header.entry_height < 1 || header.entry_height > 64 ||
+          header.entry_width < 1 || header.entry_width > 64 ||
+          (kind == BINARY_VECTOR && header.entry_width != 1))
+        throw Exception ("LoadBinary: corrupt file, invalid sizes in header");
+      uint64_t entrysize = uint64_t(header.entry_height) * header.entry_width *
+        (header.is_complex ? sizeof(Complex) : sizeof(double));
+      if (kind == BINARY_SPARSEMATRIX)
+        {
+          CheckRange (file, header.offset_firsti, uint64_t(header.height)+1, sizeof(size_t));
+          CheckRange (file, header.offset_colnr, header.nze, sizeof(int));
+          CheckRange (file, header.offset_values, header.nze, entrysize);
+        }
+      else
+        CheckRange (file, header.offset_values, header.height, entrysize);
+      return header;
+    }
+
+    /// checks the graph read from file before it is used for a matrix
+    void CheckGraph (FlatArray<size_t> firsti, FlatArray<int> colnr, size_t width)
+    {
+      size_t height = firsti.Size()-1;
+      if (firsti[0] != 0 || firsti[height] != colnr.Size())
+        throw Exception ("LoadBinary: inconsistent matrix graph");
+      
+      // firsti is monotone, the column indices are strictly increasing within a row
+      atomic<bool> valid(true);
+      ParallelForRange (height, [&] (IntRange r)
+        {
+          for (auto i : r)
+            {
+              if (firsti[i] > firsti[i+1] || firsti[i+1] > colnr.Size())
+                {
+                  valid = false;
+                  return;
+                }
+              for (size_t j = firsti[i]+1; j < firsti[i+1]; j++)
+                if (colnr[j] <= colnr[j-1])
+                  {
+                    valid = false;
+                    return;
+                  }
+            }
+        });
+      if (!valid)
+        throw Exception ("LoadBinary: inconsistent matrix graph, firsti not monotone or rows not sorted");
+      
+      ParallelForRange (colnr.Size(), [&] (IntRange r)
+        {
+          for (auto j : r)
+            if (colnr[j] < 0 || size_t(colnr[j]) >= width)
+              {
+                valid = false;
+                return;
+              }
+        });
+      if (!valid)
+        throw Exception ("LoadBinary: inconsistent matrix graph, column index out of range");
+    }
+    
+    /// calls func with a dummy object of the sparse matrix entry type
+    template <typename FUNC>
+    void DispatchEntryType (bool is_complex, int eh, int ew, FUNC func)
+    {
+      auto dispatch = [&] (auto scal)
+        {
+          typedef decltype(scal) TSCAL;
+          if (eh == 1 && ew == 1) { func (TSCAL(0)); return true; }
+#if MAX_SYS_DIM >= 2
+          if (eh == 2 && ew == 2) { func (Mat<2,2,TSCAL>()); return true; }
+#endif
+#if MAX_SYS_DIM >= 3
+          if (eh == 3 && ew == 3) { func (Mat<3,3,TSCAL>()); return true; }
+#endif
+          return false;
+        };
+      bool found = is_complex ? dispatch(Complex(0)) : dispatch(double(0));
+      if (!found)
+        throw Exception ("binary storage of sparse matrices with entry size " +
+                         ToString(eh) + "x" + ToString(ew) + " not supported");
+    }
+
+    /// vector on external storage
+    template <typename TSCAL>
+    class MappedVector : public S_BaseVectorPtr<TSCAL>
+    {
+      shared_ptr<MappedFile> file;
+    public:
+      MappedVector (size_t as, int aes, TSCAL * adata, shared_ptr<MappedFile> afile)
+        : S_BaseVectorPtr<TSCAL> (as, aes, adata), file(afile) { ; }
+    };
+  }
+
+  
+  MappedFile :: MappedFile (const string & filename)
+  {
+#ifdef WIN32
+    ifstream in(filename, ios::binary | ios::ate);
+    if (!in)
+      throw Exception ("MappedFile: cannot open file " + filename);
+    size = in.tellg();
+    ptr = new char[size];
+    in.seekg(0);
+    in.read (static_cast<char*>(ptr), size);
+#else
+    int fd = open (filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw Exception ("MappedFile: cannot open file " + filename);
+    struct stat st;
+    if (fstat (fd, &st) != 0)
+      {
+        close (fd);
+        throw Exception ("MappedFile: cannot stat file " + filename);
+      }
+    size = st.st_size;
+    // private mapping: pages are copied only when written to
+    ptr = mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (ptr == MAP_FAILED)
+      throw Exception ("MappedFile: mmap failed for file " + filename);
+    mapped = true;
+#endif
+  }
+
+  MappedFile :: ~MappedFile ()
+  {
+#ifndef WIN32
+    if (mapped)
+      {
+        munmap (ptr, size);
+        return;
+      }
+#endif
+    delete [] static_cast<char*> (ptr);
+  }
+
+  
+  void SaveBinary (const BaseSparseMatrix & mat, const string & filename)
+  {
+    static Timer t("SaveBinary - matrix");
+    RegionTimer reg(t);
+    
+    auto [eh, ew] = mat.EntrySizes();
+    auto header = NewHeader (BINARY_SPARSEMATRIX);
+    header.is_complex = mat.IsComplex();
+    header.entry_height = eh;
+    header.entry_width = ew;
+    header.height = mat.Height();
+    header.width = mat.Width();
+    header.nze = mat.NZE();
+    DispatchEntryType (mat.IsComplex(), eh, ew, [&] (auto tm)
+      {
+        typedef decltype(tm) TM;
+        if (!dynamic_cast<const SparseMatrixTM<TM>*> (&mat))
+          throw Exception ("SaveBinary: unsupported sparse matrix type");
+        header.symmetric = dynamic_cast<const SparseMatrixSymmetric<TM>*> (&mat) != nullptr;
+      });
+
+    size_t scalsize = mat.IsComplex() ? sizeof(Complex) : sizeof(double);
+    size_t bytes_firsti = (header.height+1) * sizeof(size_t);
+    size_t bytes_colnr = header.nze * sizeof(int);
+    size_t bytes_values = header.nze * eh * ew * scalsize;
+    header.offset_firsti = AlignUp (sizeof(BinaryHeader));
+    header.offset_colnr = header.offset_firsti + AlignUp (bytes_firsti);
+    header.offset_values = header.offset_colnr + AlignUp (bytes_colnr);
+    header.filesize = header.offset_values + AlignUp (bytes_values);
+
+    ofstream out(filename, ios::binary);
+    if (!out)
+      throw Exception ("SaveBinary: cannot open file " + filename);
+    WritePadded (out, &header, sizeof(header));
+    WritePadded (out, mat.GetFirstArray().Data(), bytes_firsti);
+    WritePadded (out, mat.GetColIndices().Data(), bytes_colnr);
+    WritePadded (out, mat.AsVector().Memory(), bytes_values);
+    if (!out)
+      throw Exception ("SaveBinary: writing file " + filename + " failed");
+  }
+
+  
+  void SaveBinary (const BaseVector & vec, const string & filename)
+  {
+    static Timer t("SaveBinary - vector");
+    RegionTimer reg(t);
+
+    auto header = NewHeader (BINARY_VECTOR);
+    header.is_complex = vec.IsComplex();
+    header.entry_height = vec.IsComplex() ? vec.EntrySize()/2 : vec.EntrySize();
+    header.entry_width = 1;
+    header.height = vec.Size();
+
+    size_t bytes_values = vec.Size() * vec.EntrySize() * sizeof(double);
+    header.offset_values = AlignUp (sizeof(BinaryHeader));
+    header.filesize = header.offset_values + AlignUp (bytes_values);
+
+    ofstream out(filename, ios::binary);
+    if (!out)
+      throw Exception ("SaveBinary: cannot open file " + filename);
+    WritePadded (out, &header, sizeof(header));
+    WritePadded (out, vec.Memory(), bytes_values);
+    if (!out)
+      throw Exception ("SaveBinary: writing file " + filename + " failed");
+  }
+
+  
+  shared_ptr<BaseSparseMatrix> LoadBinaryMatrix (const string & filename, bool copy)
+  {
+    static Timer t("LoadBinary - matrix");
+    RegionTimer reg(t);
+
+    auto file = make_shared<MappedFile> (filename);
+    auto & header = CheckHeader (*file, BINARY_SPARSEMATRIX);
+    char * base = static_cast<char*> (file->Data());
+    
+    FlatArray<size_t> firsti (header.height+1, reinterpret_cast<size_t*> (base+header.offset_firsti));
+    FlatArray<int> colnr (header.nze, reinterpret_cast<int*> (base+header.offset_colnr));
+    CheckGraph (firsti, colnr, header.width);
+
+    shared_ptr<BaseSparseMatrix> res;
+    DispatchEntryType (header.is_complex, header.entry_height, header.entry_width, [&] (auto tm)
+      {
+        typedef decltype(tm) TM;
+        FlatArray<TM> values (header.nze, reinterpret_cast<TM*> (base+header.offset_values));
+
+        MatrixGraph graph (header.width, firsti, colnr, file);
+        shared_ptr<SparseMatrixTM<TM>> smat;
+        if (header.symmetric)
+          smat = make_shared<SparseMatrixSymmetric<TM>> (graph, !copy);
+        else
+          smat = make_shared<SparseMatrix<TM>> (graph, !copy);
+
+        if (copy)
+          ParallelForRange (values.Size(), [&] (IntRange r)
+                            {
+                              for (auto i : r)
+                                (*smat)[i] = values[i];
+                            });
+        else
+          smat->AssignMemory (values, file);
+        res = smat;
+      });
+    return res;
+  }
+
+  
+  shared_ptr<BaseVector> LoadBinaryVector (const string & filename, bool copy)
+  {
+    static Timer t("LoadBinary - vector");
+    RegionTimer reg(t);
+
+    auto file = make_shared<MappedFile> (filename);
+    auto & header = CheckHeader (*file, BINARY_VECTOR);
+    char * base = static_cast<char*> (file->Data());
+    size_t size = header.height;
+    int es = header.entry_height;
+
+    auto load = [&] (auto scal) -> shared_ptr<BaseVector>
+      {
+        typedef decltype(scal) TSCAL;
+        TSCAL * data = reinterpret_cast<TSCAL*> (base+header.offset_values);
+        if (!copy)
+          return make_shared<MappedVector<TSCAL>> (size, es, data, file);
+
+        auto vec = make_shared<S_BaseVectorPtr<TSCAL>> (size, es);
+        vec->template FV<TSCAL>() = FlatVector<TSCAL> (size*es, data);
+        return vec;
+      };
+    
+    if (header.is_complex)
+      return load (Complex(0));
+    return load (double(0));
+  }
+}
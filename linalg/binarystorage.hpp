@@ -0,0 +1,46 @@
+#ifndef FILE_NGS_BINARYSTORAGE
+#define FILE_NGS_BINARYSTORAGE
+
+/*
+  Flat binary images of sparse matrices and vectors.
+
+  The file holds a fixed header followed by the raw arrays
+  (firsti, colnr, values), each aligned to 64 bytes.
+  Loading maps the file into memory and uses the mapped pages
+  as storage of the matrix (vector), nothing is copied or converted.
+  The mapping is private, modifications of the loaded object
+  are not written back to the file.
+*/
+
+namespace ngla
+{
+
+  /// a file mapped into memory (read into memory if mmap is not available)
+  class NGS_DLL_HEADER MappedFile
+  {
+    void * ptr = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+  public:
+    MappedFile (const string & filename);
+    ~MappedFile ();
+    MappedFile (const MappedFile &) = delete;
+    MappedFile & operator= (const MappedFile &) = delete;
+
+    void * Data() const { return ptr; }
+    size_t Size() const { return size; }
+  };
+
+
+  /// writes the sparse matrix as flat binary image
+  NGS_DLL_HEADER void SaveBinary (const BaseSparseMatrix & mat, const string & filename);
+  /// writes the vector as flat binary image
+  NGS_DLL_HEADER void SaveBinary (const BaseVector & vec, const string & filename);
+
+  /// sparse matrix using the memory-mapped file as storage, a copy if copy == true
+  NGS_DLL_HEADER shared_ptr<BaseSparseMatrix> LoadBinaryMatrix (const string & filename, bool copy = false);
+  /// vector using the memory-mapped file as storage, a copy if copy == true
+  NGS_DLL_HEADER shared_ptr<BaseVector> LoadBinaryVector (const string & filename, bool copy = false);
+}
+
+#endif
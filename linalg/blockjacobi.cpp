@@ -558,6 +558,8 @@ namespace ngla
 
     cout << IM(4) << " using " << maxcolor+1 << " colors" << endl;
 
+    SetupSIMDBlocks();
+    
     // calc balancing:
 
     color_balance.SetSize (block_coloring.Size());
@@ -578,9 +580,206 @@ namespace ngla
       }
 
     GetMemoryTracer().Track(bigmem, "InvDiag");
+    GetMemoryTracer().Track(simd_invdiag, "SIMDInvDiag");
     cout << IM(3) << "\rBlockJacobi Preconditioner built" << endl;
   }
 
+
+  
+  /*
+    Batched block inverse application: lane l of the SIMD<double> entries
+    belongs to block l of the group, the block matrices are stored row-major.
+    Small block sizes get fully unrolled kernels.
+  */
+  template <int BS>
+  INLINE void BatchedBlockMultKernel (const SIMD<double> * pinv,
+                                      const SIMD<double> * hx, SIMD<double> * hy)
+  {
+    Iterate<BS> ([&] (auto i)
+      {
+        SIMD<double> sum(0.0);
+        Iterate<BS> ([&] (auto j) { sum += pinv[i*BS+j] * hx[j]; });
+        hy[i] = sum;
+      });
+  }
+
+  template <int BS>
+  INLINE void BatchedBlockMultTransKernel (const SIMD<double> * pinv,
+                                           const SIMD<double> * hx, SIMD<double> * hy)
+  {
+    Iterate<BS> ([&] (auto j)
+      {
+        SIMD<double> sum(0.0);
+        Iterate<BS> ([&] (auto i) { sum += pinv[i*BS+j] * hx[i]; });
+        hy[j] = sum;
+      });
+  }
+
+  static void BatchedBlockMult (size_t bs, bool trans, const SIMD<double> * pinv,
+                                const SIMD<double> * hx, SIMD<double> * hy)
+  {
+    if (bs <= 12)
+      {
+        Switch<13> (bs, [&] (auto BS)
+                    {
+                      if (trans)
+                        BatchedBlockMultTransKernel<BS.value> (pinv, hx, hy);
+                      else
+                        BatchedBlockMultKernel<BS.value> (pinv, hx, hy);
+                    });
+        return;
+      }
+
+    if (trans)
+      {
+        for (size_t j = 0; j < bs; j++)
+          hy[j] = SIMD<double>(0.0);
+        for (size_t i = 0; i < bs; i++)
+          for (size_t j = 0; j < bs; j++)
+            hy[j] += pinv[i*bs+j] * hx[i];
+      }
+    else
+      for (size_t i = 0; i < bs; i++)
+        {
+          SIMD<double> sum(0.0);
+          for (size_t j = 0; j < bs; j++)
+            sum += pinv[i*bs+j] * hx[j];
+          hy[i] = sum;
+        }
+  }
+
+
+  template <class TM, class TV_ROW, class TV_COL>
+  void BlockJacobiPrecond<TM, TV_ROW, TV_COL> ::
+  SetupSIMDBlocks ()
+  {
+    if constexpr (SIMD_BLOCKS)
+      {
+        constexpr size_t SW = SIMD<double>::Size();
+        if (SW == 1) return;
+
+        static Timer t("BlockJacobiPrecond::SetupSIMDBlocks"); RegionTimer reg(t);
+        
+        // within each color, cut runs of equally sized blocks into groups of SW
+        Array<bool> ingroup(blocktable->Size());
+        ingroup = false;
+        Array<int> groupblocks, groupcolor;
+        
+        for (auto c : Range(block_coloring))
+          {
+            Array<int> sorted(block_coloring[c].Size());
+            for (auto k : Range(sorted))
+              sorted[k] = block_coloring[c][k];
+            QuickSort (sorted, [&] (int a, int b)
+                       { return (*blocktable)[a].Size() < (*blocktable)[b].Size(); });
+
+            for (size_t first = 0; first < sorted.Size(); )
+              {
+                size_t bs = (*blocktable)[sorted[first]].Size();
+                size_t next = first;
+                while (next < sorted.Size() && (*blocktable)[sorted[next]].Size() == bs)
+                  next++;
+
+                if (bs > 0)
+                  for (size_t k = first; k+SW <= next; k += SW)
+                    {
+                      groupcolor.Append (c);
+                      for (size_t l = 0; l < SW; l++)
+                        {
+                          groupblocks.Append (sorted[k+l]);
+                          ingroup[sorted[k+l]] = true;
+                        }
+                    }
+                first = next;
+              }
+          }
+
+        size_t ngroups = groupcolor.Size();
+        if (ngroups == 0) return;
+
+        TableCreator<int> creator(ngroups);
+        for ( ; !creator.Done(); creator++)
+          for (size_t g = 0; g < ngroups; g++)
+            for (size_t l = 0; l < SW; l++)
+              creator.Add (g, groupblocks[g*SW+l]);
+        simd_groups = creator.MoveTable();
+
+        TableCreator<int> ccreator(block_coloring.Size());
+        for ( ; !ccreator.Done(); ccreator++)
+          for (size_t g = 0; g < ngroups; g++)
+            ccreator.Add (groupcolor[g], g);
+        simd_group_coloring = ccreator.MoveTable();
+
+        simd_group_offset.SetSize (ngroups+1);
+        simd_group_offset[0] = 0;
+        for (size_t g = 0; g < ngroups; g++)
+          simd_group_offset[g+1] = simd_group_offset[g] + sqr ((*blocktable)[simd_groups[g][0]].Size());
+        simd_invdiag.SetSize (simd_group_offset[ngroups]);
+
+        ParallelFor (Range(ngroups), [&] (size_t g)
+                     {
+                       auto group = simd_groups[g];
+                       size_t bs = (*blocktable)[group[0]].Size();
+                       double * pinv = reinterpret_cast<double*> (&simd_invdiag[simd_group_offset[g]]);
+                       for (size_t l = 0; l < SW; l++)
+                         {
+                           FlatMatrix<TM> inv = invdiag[group[l]];
+                           for (size_t j = 0; j < bs; j++)
+                             for (size_t k = 0; k < bs; k++)
+                               pinv[(j*bs+k)*SW+l] = inv(j,k);
+                         }
+                     });
+
+        // the remaining blocks keep their own inverse, compact them
+        TableCreator<int> rcreator(block_coloring.Size());
+        for ( ; !rcreator.Done(); rcreator++)
+          for (auto c : Range(block_coloring))
+            for (auto i : block_coloring[c])
+              if (!ingroup[i])
+                rcreator.Add (c, i);
+        block_coloring = rcreator.MoveTable();
+
+        size_t remmem = 0;
+        for (auto i : Range(*blocktable))
+          if (!ingroup[i])
+            remmem += sqr ((*blocktable)[i].Size());
+
+        Array<TM> newmem(remmem);
+        remmem = 0;
+        for (auto i : Range(*blocktable))
+          {
+            size_t bs = ingroup[i] ? 0 : (*blocktable)[i].Size();
+            FlatMatrix<TM> newinv(bs, bs, newmem.Addr(remmem));
+            if (bs) newinv = invdiag[i];
+            new ( & invdiag[i] ) FlatMatrix<TM> (newinv);
+            remmem += sqr (bs);
+          }
+        bigmem = move(newmem);
+
+        cout << IM(4) << ngroups << " SIMD block groups" << endl;
+      }
+  }
+
+  
+  template <class TM, class TV_ROW, class TV_COL> template <typename FX, typename FY>
+  INLINE void BlockJacobiPrecond<TM, TV_ROW, TV_COL> ::
+  ApplySIMDGroup (size_t g, bool trans, FX getx, FY addy) const
+  {
+    constexpr size_t SW = SIMD<double>::Size();
+    auto group = simd_groups[g];
+    size_t bs = (*blocktable)[group[0]].Size();
+
+    ArrayMem<SIMD<double>,100> hx(bs), hy(bs);
+    for (size_t j = 0; j < bs; j++)
+      hx[j] = SIMD<double> ([&] (int l) -> double { return getx (group[l], j); });
+
+    BatchedBlockMult (bs, trans, &simd_invdiag[simd_group_offset[g]], &hx[0], &hy[0]);
+
+    for (size_t j = 0; j < bs; j++)
+      for (size_t l = 0; l < SW; l++)
+        addy (group[l], j, hy[j][l]);
+  }
+
   ///
   template <class TM, class TV_ROW, class TV_COL>
   BlockJacobiPrecond<TM, TV_ROW, TV_COL> ::
@@ -630,6 +829,16 @@ namespace ngla
                    fy((*blocktable)[i][j]) += s * hy(j);
                }
            });
+
+        if constexpr (SIMD_BLOCKS)
+          if (c < simd_group_coloring.Size())
+            ParallelFor
+              (simd_group_coloring[c].Range(), [&] (size_t gi)
+               {
+                 ApplySIMDGroup (simd_group_coloring[c][gi], false,
+                                 [&] (int i, size_t j) { return fx((*blocktable)[i][j]); },
+                                 [&] (int i, size_t j, double val) { fy((*blocktable)[i][j]) += s * val; });
+               });
       }
   }
 
@@ -675,6 +884,16 @@ namespace ngla
                    fy(block[j]) += s * hy(j);
                }
            });
+
+        if constexpr (SIMD_BLOCKS)
+          if (c < simd_group_coloring.Size())
+            ParallelFor
+              (simd_group_coloring[c].Range(), [&] (size_t gi)
+               {
+                 ApplySIMDGroup (simd_group_coloring[c][gi], true,
+                                 [&] (int i, size_t j) { return fx((*blocktable)[i][j]); },
+                                 [&] (int i, size_t j, double val) { fy((*blocktable)[i][j]) += s * val; });
+               });
       }
   }
 
@@ -759,11 +978,14 @@ namespace ngla
 #endif
 
     Array<SharedLoop2> loops(block_coloring.Size());
+    Array<SharedLoop2> simd_loops(simd_group_coloring.Size());
     
     for (int k = 0; k < steps; k++)
       {
         for (int c : Range(block_coloring))
           loops[c].Reset (block_coloring[c].Range());
+        for (int c : Range(simd_group_coloring))
+          simd_loops[c].Reset (simd_group_coloring[c].Range());
 
         task_manager -> CreateJob
           ( [&] (const TaskInfo & ti) 
@@ -795,6 +1017,18 @@ namespace ngla
                       hy = (invdiag[i]) * hx;
                       fx(block) += hy;
                     }
+
+                  if constexpr (SIMD_BLOCKS)
+                    if (c < simd_loops.Size())
+                      for (auto mynr : simd_loops[c])
+                        ApplySIMDGroup (simd_group_coloring[c][mynr], false,
+                                        [&] (int i, size_t j)
+                                        {
+                                          auto jj = (*blocktable)[i][j];
+                                          return fb(jj) - mat.RowTimesVector (jj, fx);
+                                        },
+                                        [&] (int i, size_t j, double val)
+                                        { fx((*blocktable)[i][j]) += val; });
                 }
             });
       }
@@ -843,6 +1077,21 @@ namespace ngla
                    fx(block) += hy;
                  }
              });
+
+          if constexpr (SIMD_BLOCKS)
+            if (c < simd_group_coloring.Size())
+              ParallelFor
+                (simd_group_coloring[c].Range(), [&] (size_t gi)
+                 {
+                   ApplySIMDGroup (simd_group_coloring[c][gi], false,
+                                   [&] (int i, size_t j)
+                                   {
+                                     auto jj = (*blocktable)[i][j];
+                                     return fb(jj) - mat.RowTimesVector (jj, fx);
+                                   },
+                                   [&] (int i, size_t j, double val)
+                                   { fx((*blocktable)[i][j]) += val; });
+                 });
         }
    }
 
@@ -120,6 +120,19 @@ namespace ngla
     /// the data for the inverses
     Array<TM> bigmem;
 
+    /// scalar real blocks of equal size are applied SIMD-batched
+    static constexpr bool SIMD_BLOCKS =
+      is_same<TM,double>::value && is_same<TV_ROW,double>::value;
+
+    /// inverses of equally sized blocks, interleaved over SIMD lanes
+    Array<SIMD<double>> simd_invdiag;
+    /// groups of SIMD<double>::Size() blocks of the same size and color
+    Table<int> simd_groups;
+    /// offset of the interleaved group inverse in simd_invdiag
+    Array<size_t> simd_group_offset;
+    /// the simd groups of each color
+    Table<int> simd_group_coloring;
+
   public:
     // typedef typename mat_traits<TM>::TV_ROW TVX;
     typedef TV_ROW TVX;
@@ -138,7 +151,16 @@ namespace ngla
 
     AutoVector CreateRowVector() const override { return mat.CreateColVector(); }
     AutoVector CreateColVector() const override { return mat.CreateRowVector(); }
+
+  protected:
+    /// moves equally sized block inverses of one color into simd_invdiag
+    void SetupSIMDBlocks ();
+
+    /// applies the inverses of simd-group g, x and y are gathered/scattered via lambdas
+    template <typename FX, typename FY>
+    void ApplySIMDGroup (size_t g, bool trans, FX getx, FY addy) const;
     
+  public:
     ///
     void MultAdd (TSCAL s, const BaseVector & x, BaseVector & y) const override;
 
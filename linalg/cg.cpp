@@ -605,19 +605,21 @@ namespace ngla
 	    if (kss == 0.0) break;
 	    
 	    al = wd / kss;
-	    u += al * s;
-	    d -= al * as;
-            
+
 	    if (c)
-	      w = (*c) * d;
+	      {
+		u.AddPair (al, *s, *d, -al, *as);
+		w = (*c) * d;
+		wdn = S_InnerProduct<IPTYPE> (d, w);
+	      }
 	    else
-	      w = d;
-	    wdn = S_InnerProduct<IPTYPE> (d, w);
+	      {
+		u.Add (al, *s);
+		wdn = S_AddInnerProduct<IPTYPE> (*d, -al, *as, *d);
+	      }
 
 	    be = wdn / wd;
-	    
-	    s *= be;
-	    s += w;
+	    (*s).ScaleAdd (be, c ? *w : *d);
 
 	    if (printrates ) cout << IM(1) << n << " " << sqrt (Abs (wdn)) << endl;
 	    if ( sh )
@@ -933,10 +935,12 @@ namespace ngla
               h2(i,j) = h(i,j) = S_InnerProduct<IPTYPE> (*vi[i], av);
 
             w = av;
-            for (int i = 0; i <= j; i++)
+            for (int i = 0; i < j; i++)
               w -= h(i,j) * (*vi[i]);
+            // last update fused with the norm
+            SCAL ww = S_AddInnerProduct<IPTYPE> (*w, -h(j,j), *vi[j], *w);
 
-            v = (1.0 / sqrt (S_InnerProduct<IPTYPE> (w, w))) * w;
+            v = (1.0 / sqrt (ww)) * w;
             h2(j+1,j) = h(j+1,j) = S_InnerProduct<IPTYPE> (v, av);
 
             for (int i = 0; i < j; i++)
@@ -1315,6 +1319,566 @@ void QMRSolver<SCAL> :: Mult (const BaseVector & b, BaseVector & x) const
   
  
   
+  // matrix  v_i^H w_j
+  template <typename SCAL>
+  static Matrix<SCAL> GramMatrix (const MultiVector & v, const MultiVector & w)
+  {
+    if constexpr (is_same<SCAL,double>::value)
+      return v.InnerProductD (w);
+    else
+      {
+        Matrix<Complex> g = v.InnerProductC (w, true);
+        for (size_t i = 0; i < g.Height(); i++)
+          for (size_t j = 0; j < g.Width(); j++)
+            g(i,j) = conj(g(i,j));
+        return g;
+      }
+  }
+
+  // vector  v_i^H w
+  template <typename SCAL>
+  static Vector<SCAL> GramVector (const MultiVector & v, const BaseVector & w)
+  {
+    if constexpr (is_same<SCAL,double>::value)
+      return v.InnerProductD (w);
+    else
+      {
+        Vector<Complex> g = v.InnerProductC (w, true);
+        for (size_t i = 0; i < g.Size(); i++)
+          g(i) = conj(g(i));
+        return g;
+      }
+  }
+
+  // v^H w
+  template <typename SCAL>
+  static SCAL HermitianInnerProduct (const BaseVector & v, const BaseVector & w)
+  {
+    if constexpr (is_same<SCAL,double>::value)
+      return v.InnerProductD (w);
+    else
+      return w.InnerProductC (v, true);
+  }
+
+  // mv becomes mv * q
+  template <typename SCAL>
+  static void TransformMultiVector (shared_ptr<MultiVector> & mv, FlatMatrix<SCAL> q)
+  {
+    shared_ptr<MultiVector> res = mv->RefVec()->CreateMultiVector (q.Width());
+    *res = 0.0;
+    res->Add (*mv, q);
+    mv = res;
+  }
+
+  // y minimizing |rhs - g y|, by Gram-Schmidt QR of g
+  template <typename SCAL>
+  static Vector<SCAL> SmallLeastSquares (FlatMatrix<SCAL> g, FlatVector<SCAL> rhs)
+  {
+    size_t n = g.Width();
+    Matrix<SCAL> q = g;
+    Matrix<SCAL> rm(n);
+    rm = SCAL(0.0);
+    for (size_t i = 0; i < n; i++)
+      {
+        for (int pass = 0; pass < 2; pass++)
+          for (size_t l = 0; l < i; l++)
+            {
+              SCAL sum = 0.0;
+              for (size_t k = 0; k < q.Height(); k++)
+                sum += Conj(q(k,l)) * q(k,i);
+              rm(l,i) += sum;
+              q.Col(i) -= sum * q.Col(l);
+            }
+        rm(i,i) = L2Norm (q.Col(i));
+        if (rm(i,i) != SCAL(0.0))
+          q.Col(i) /= rm(i,i);
+      }
+
+    Vector<SCAL> y(n);
+    for (int i = n-1; i >= 0; i--)
+      {
+        SCAL sum = 0.0;
+        for (size_t k = 0; k < q.Height(); k++)
+          sum += Conj(q(k,i)) * rhs(k);
+        for (size_t l = i+1; l < n; l++)
+          sum -= rm(i,l) * y(l);
+        y(i) = (rm(i,i) != SCAL(0.0)) ? sum / rm(i,i) : SCAL(0.0);
+      }
+    return y;
+  }
+
+  // eigenvalues and eigenvectors (columns) of a small non-hermitian matrix
+  template <typename SCAL>
+  static void GeneralEigenSystem (FlatMatrix<SCAL> t, FlatVector<Complex> lami, FlatMatrix<Complex> evecs)
+  {
+#ifdef LAPACK
+    size_t n = t.Height();
+    Matrix<Complex> tt(n), hevecs(n);
+    for (size_t i = 0; i < n; i++)
+      for (size_t j = 0; j < n; j++)
+        tt(i,j) = t(j,i);   // transposed for Lapack
+    LapackEigenValues (tt, lami, hevecs);
+    evecs = Trans (hevecs);
+#else
+    throw Exception ("GCRODRSolver needs LAPACK");
+#endif
+  }
+
+
+
+  template <class SCAL>
+  void DeflatedCGSolver<SCAL> :: Mult (const BaseVector & f, BaseVector & u) const
+  {
+    static Timer timer ("DeflatedCG solver");
+    static Timer tdefl ("DeflatedCG solver - deflation");
+    static Timer tharvest ("DeflatedCG solver - eigenvectors");
+    RegionTimer reg (timer);
+
+    try
+      {
+        auto r = f.CreateVector();
+        auto z = f.CreateVector();
+        auto p = u.CreateVector();
+        auto ap = f.CreateVector();
+        auto apold = f.CreateVector();
+
+        // A W and E^{-1} = (W^H A W)^{-1}
+        size_t k = w ? w->Size() : 0;
+        shared_ptr<MultiVector> aw;
+        Matrix<SCAL> einv(k);
+        if (k)
+          {
+            RegionTimer reg(tdefl);
+            aw = f.CreateMultiVector (k);
+            *aw = 0.0;
+            Vector<double> ones(k);
+            ones = 1.0;
+            a->MultAdd (ones, *w, *aw);
+            einv = GramMatrix<SCAL> (*w, *aw);
+            CalcInverse (einv);
+          }
+
+	if (initialize)
+	  {
+	    u = 0.0;
+	    r = f;
+	  }
+	else
+	  r = f - (*a) * u;
+
+        Vector<SCAL> mu(k);
+        if (k)
+          {
+            // initial guess with W^H r = 0
+            mu = einv * GramVector<SCAL> (*w, *r);
+            w->AddTo (mu, u);
+            mu *= -1;
+            aw->AddTo (mu, *r);
+          }
+
+        if (c)
+          z = (*c) * r;
+        else
+          z = r;
+
+        // p = z - W mu,  mu = E^{-1} (AW)^H z
+        auto deflate = [&] ()
+          {
+            if (!k) return;
+            RegionTimer reg(tdefl);
+            mu = einv * GramVector<SCAL> (*aw, *z);
+            Vector<SCAL> hmu = -mu;
+            w->AddTo (hmu, *p);
+          };
+        p = z;
+        deflate();
+
+        // z_j, r_j = c^{-1} z_j and A z_j of the first iterations
+        int nh = (ndefl > 0) ? min2 (nharvest, maxsteps) : 0;
+        shared_ptr<MultiVector> zh = f.CreateMultiVector (nh);
+        shared_ptr<MultiVector> rh = f.CreateMultiVector (nh);
+        shared_ptr<MultiVector> azh = f.CreateMultiVector (nh);
+        int nz = 0;
+
+	SCAL al, be = 0.0, kss;
+	SCAL wdn = HermitianInnerProduct<SCAL> (*r, *z);
+        double err;
+
+	if (printrates) cout << IM(1) << "0 " << sqrt(Abs(wdn)) << endl;
+	if (wdn == 0.0) wdn = 1;
+
+	if (stop_absolute)
+	  err = prec * prec;
+	else
+	  err = prec * prec * Abs (wdn);
+
+        int n = 0;
+	while (n++ < maxsteps && Abs(wdn) > err && !(sh && sh->ShouldTerminate()))
+	  {
+	    ap = (*a) * p;
+
+            if (nz < nh)
+              {
+                // p = z + be p_old - W mu  gives  A z = A p - be A p_old + AW mu
+                *(*zh)[nz] = *z;
+                *(*rh)[nz] = *r;
+                BaseVector & az = *(*azh)[nz];
+                az = *ap;
+                if (nz > 0)
+                  az -= be * *apold;
+                if (k)
+                  aw->AddTo (mu, az);
+                nz++;
+                apold = *ap;
+              }
+
+	    kss = HermitianInnerProduct<SCAL> (*p, *ap);
+	    if (kss == 0.0) break;
+
+	    al = wdn / kss;
+	    u.AddPair (al, *p, *r, -al, *ap);
+
+	    if (c)
+	      z = (*c) * r;
+	    else
+	      z = r;
+
+            SCAL wd = wdn;
+	    wdn = HermitianInnerProduct<SCAL> (*r, *z);
+	    be = wdn / wd;
+
+	    (*p).ScaleAdd (be, *z);
+            deflate();
+
+	    if (printrates) cout << IM(1) << n << " " << sqrt (Abs (wdn)) << endl;
+	  }
+	const_cast<int&> (steps) = n;
+
+        if (nz == 0) return;
+
+        // Rayleigh-Ritz for A z = theta c^{-1} z on span [W, z_j]
+        RegionTimer regh(tharvest);
+        auto zr = zh->Range(IntRange(0, nz));
+        auto rr = rh->Range(IntRange(0, nz));
+        auto azr = azh->Range(IntRange(0, nz));
+
+        auto blockgram = [&] (shared_ptr<MultiVector> v1, const MultiVector & v2,
+                              shared_ptr<MultiVector> w1, const MultiVector & w2)
+          {
+            Matrix<SCAL> g(k+nz);
+            if (k)
+              {
+                g.Rows(0,k).Cols(0,k) = GramMatrix<SCAL> (*v1, *w1);
+                g.Rows(0,k).Cols(k,k+nz) = GramMatrix<SCAL> (*v1, w2);
+                g.Rows(k,k+nz).Cols(0,k) = GramMatrix<SCAL> (v2, *w1);
+              }
+            g.Rows(k,k+nz).Cols(k,k+nz) = GramMatrix<SCAL> (v2, w2);
+            return g;
+          };
+
+        Matrix<SCAL> fm = blockgram (w, *zr, aw, *azr);
+        Matrix<SCAL> gm = blockgram (w, *zr, cinvw, *rr);
+        for (size_t i = 0; i < k+nz; i++)
+          for (size_t j = 0; j <= i; j++)
+            {
+              SCAL hij = 0.5 * (gm(i,j) + Conj(gm(j,i)));
+              gm(i,j) = hij;
+              gm(j,i) = Conj(hij);
+            }
+
+        Matrix<SCAL> q = CholeskyQRFactor<SCAL> (gm, 1e-10);
+        Matrix<SCAL> qh(q.Width(), q.Height());
+        for (size_t i = 0; i < q.Height(); i++)
+          for (size_t j = 0; j < q.Width(); j++)
+            qh(j,i) = Conj(q(i,j));
+        Matrix<SCAL> fq = fm * q;
+        Matrix<SCAL> t = qh * fq;
+
+        Vector<double> lami(t.Height());
+        Matrix<SCAL> evecs(t.Height());
+        HermitianEigenSystem<SCAL> (t, lami, evecs);
+
+        size_t knew = min2 (size_t(ndefl), t.Height());
+        Matrix<SCAL> y = q * evecs.Cols(0, knew);
+
+        shared_ptr<MultiVector> wnew = u.CreateMultiVector (knew);
+        shared_ptr<MultiVector> cinvwnew = u.CreateMultiVector (knew);
+        *wnew = 0.0;
+        *cinvwnew = 0.0;
+        if (k)
+          {
+            wnew->Add (*w, y.Rows(0,k));
+            cinvwnew->Add (*cinvw, y.Rows(0,k));
+          }
+        wnew->Add (*zr, y.Rows(k,k+nz));
+        cinvwnew->Add (*rr, y.Rows(k,k+nz));
+        w = wnew;
+        cinvw = cinvwnew;
+      }
+
+    catch (Exception & e)
+      {
+	e.Append ("in caught in DeflatedCGSolver::Mult\n");
+	throw;
+      }
+    catch (exception & e)
+      {
+	throw Exception(e.what() +
+			string ("\ncaught in DeflatedCGSolver::Mult\n"));
+      }
+  }
+
+
+
+
+  template <class SCAL>
+  void GCRODRSolver<SCAL> :: Mult (const BaseVector & f, BaseVector & x) const
+  {
+    static Timer timer ("GCRODR solver");
+    static Timer tortho ("GCRODR solver - orthogonalize");
+    static Timer trecycle ("GCRODR solver - recycle");
+    RegionTimer reg (timer);
+
+    try
+      {
+        auto r = f.CreateVector();
+        auto hv = f.CreateVector();
+
+        // left-preconditioned operator
+        auto op = [&] (const BaseVector & v, BaseVector & res)
+          {
+            if (c)
+              {
+                a->Mult (v, *hv);
+                c->Mult (*hv, res);
+              }
+            else
+              a->Mult (v, res);
+          };
+
+        // C and U with C = op U,  C^H C = I
+        auto orthonormalize = [&] (shared_ptr<MultiVector> & cm)
+          {
+            for (int pass = 0; pass < 2; pass++)
+              {
+                Matrix<SCAL> q = CholeskyQRFactor<SCAL> (GramMatrix<SCAL> (*cm, *cm), 1e-10);
+                TransformMultiVector<SCAL> (cm, q);
+                TransformMultiVector<SCAL> (u, q);
+              }
+          };
+
+	if (initialize)
+	  {
+	    x = 0.0;
+	    hv = f;
+	  }
+	else
+	  hv = f - (*a) * x;
+
+	if (c)
+          r = (*c) * hv;
+        else
+          r = hv;
+
+        double norm = L2Norm (*r);
+	if (printrates) cout << IM(1) << "0 " << norm << endl;
+
+	double err = stop_absolute ? prec : prec * norm;
+
+        size_t k = 0;
+        shared_ptr<MultiVector> cm;
+        if (u && u->Size() && norm > err)
+          {
+            cm = f.CreateMultiVector (u->Size());
+            for (size_t i = 0; i < u->Size(); i++)
+              op (*(*u)[i], *(*cm)[i]);
+            orthonormalize (cm);
+            k = cm->Size();
+
+            Vector<SCAL> h = GramVector<SCAL> (*cm, *r);
+            u->AddTo (h, x);
+            h *= -1;
+            cm->AddTo (h, *r);
+            norm = L2Norm (*r);
+          }
+
+        shared_ptr<MultiVector> v = f.CreateMultiVector (restart+1);
+        int it = 0;
+
+        while (norm > err && it < maxsteps && !(sh && sh->ShouldTerminate()))
+          {
+            int m = min2 (max2 (restart - int(k), 1), maxsteps - it);
+            Matrix<SCAL> h(m+1, m), b(k, m);
+            h = SCAL(0.0);
+            b = SCAL(0.0);
+
+            *(*v)[0] = *r;
+            *(*v)[0] /= norm;
+
+            // Arnoldi for (I - C C^H) op
+            int mdone = 0;
+            for (int j = 0; j < m; j++)
+              {
+                BaseVector & wj = *(*v)[j+1];
+                op (*(*v)[j], wj);
+
+                RegionTimer reg(tortho);
+                auto vj = v->Range(IntRange(0, j+1));
+                for (int pass = 0; pass < 2; pass++)
+                  {
+                    if (k)
+                      {
+                        Vector<SCAL> bj = GramVector<SCAL> (*cm, wj);
+                        b.Col(j) += bj;
+                        bj *= -1;
+                        cm->AddTo (bj, wj);
+                      }
+                    Vector<SCAL> hj = GramVector<SCAL> (*vj, wj);
+                    h.Col(j).Range(0, j+1) += hj;
+                    hj *= -1;
+                    vj->AddTo (hj, wj);
+                  }
+                double hn = L2Norm (wj);
+                h(j+1, j) = hn;
+                mdone++;
+                it++;
+                if (hn <= 1e-14 * norm) break;
+                wj /= hn;
+              }
+
+            // op [U V_m] = [C V_m+1] G
+            size_t nn = k + mdone;
+            Matrix<SCAL> g(nn+1, nn);
+            g = SCAL(0.0);
+            for (size_t i = 0; i < k; i++)
+              g(i,i) = 1.0;
+            if (k)
+              g.Rows(0, k).Cols(k, nn) = b.Cols(0, mdone);
+            g.Rows(k, nn+1).Cols(k, nn) = h.Rows(0, mdone+1).Cols(0, mdone);
+
+            Vector<SCAL> rhs(nn+1);
+            rhs = SCAL(0.0);
+            rhs(k) = norm;
+            Vector<SCAL> y = SmallLeastSquares<SCAL> (g, rhs);
+
+            if (k)
+              u->AddTo (y.Range(0, k), x);
+            v->Range(IntRange(0, mdone))->AddTo (y.Range(k, nn), x);
+
+            Vector<SCAL> gy = g * y;
+            gy *= -1;
+            if (k)
+              cm->AddTo (gy.Range(0, k), *r);
+            v->Range(IntRange(0, mdone+1))->AddTo (gy.Range(k, nn+1), *r);
+            norm = L2Norm (*r);
+
+            if (printrates) cout << IM(1) << it << " " << norm << endl;
+
+            if (nrecycle <= 0) continue;
+
+            // harmonic Ritz vectors:  G^H G z = theta G^H [C V]^H [U V] z
+            RegionTimer regr(trecycle);
+            Matrix<SCAL> wy(nn+1, nn);
+            wy = SCAL(0.0);
+            if (k)
+              {
+                wy.Rows(0, k).Cols(0, k) = GramMatrix<SCAL> (*cm, *u);
+                wy.Rows(k, nn+1).Cols(0, k) = GramMatrix<SCAL> (*v->Range(IntRange(0, mdone+1)), *u);
+              }
+            for (int i = 0; i < mdone; i++)
+              wy(k+i, k+i) = 1.0;
+
+            Matrix<SCAL> gh(nn, nn+1);
+            for (size_t i = 0; i < nn+1; i++)
+              for (size_t j = 0; j < nn; j++)
+                gh(j,i) = Conj(g(i,j));
+            Matrix<SCAL> ghg = gh * g;
+            Matrix<SCAL> ghw = gh * wy;
+
+            // with q^H G^H G q = I the eigenvalues of q^H G^H W^H Y q are 1/theta
+            Matrix<SCAL> q = CholeskyQRFactor<SCAL> (ghg, 1e-14);
+            size_t nq = q.Width();
+            Matrix<SCAL> qh(nq, nn);
+            for (size_t i = 0; i < nn; i++)
+              for (size_t j = 0; j < nq; j++)
+                qh(j,i) = Conj(q(i,j));
+            Matrix<SCAL> ghwq = ghw * q;
+            Matrix<SCAL> t = qh * ghwq;
+
+            Vector<Complex> lami(nq);
+            Matrix<Complex> evecs(nq);
+            GeneralEigenSystem<SCAL> (t, lami, evecs);
+
+            Array<double> abslami(nq);
+            Array<int> index(nq);
+            for (size_t i = 0; i < nq; i++)
+              {
+                abslami[i] = abs(lami(i));
+                index[i] = i;
+              }
+            QuickSortI (abslami, index, [] (double a, double b) { return a > b; });
+
+            // smallest harmonic Ritz values, real bases of complex pairs for real problems
+            size_t kk = min2 (size_t(nrecycle), nq);
+            Matrix<SCAL> pm(nn, kk);
+            size_t cnt = 0;
+            for (size_t ii = 0; ii < nq && cnt < kk; ii++)
+              {
+                int i = index[ii];
+                if constexpr (is_same<SCAL,Complex>::value)
+                  pm.Col(cnt++) = q * evecs.Col(i);
+                else
+                  {
+                    if (lami(i).imag() < -1e-12 * abs(lami(i))) continue;
+                    Vector<double> zre(nq), zim(nq);
+                    for (size_t l = 0; l < nq; l++)
+                      {
+                        zre(l) = evecs(l,i).real();
+                        zim(l) = evecs(l,i).imag();
+                      }
+                    pm.Col(cnt++) = q * zre;
+                    if (cnt < kk && lami(i).imag() > 1e-12 * abs(lami(i)))
+                      pm.Col(cnt++) = q * zim;
+                  }
+              }
+
+            Matrix<SCAL> p = pm.Cols(0, cnt);
+            Matrix<SCAL> gp = g * p;
+
+            shared_ptr<MultiVector> unew = x.CreateMultiVector (cnt);
+            shared_ptr<MultiVector> cnew = f.CreateMultiVector (cnt);
+            *unew = 0.0;
+            *cnew = 0.0;
+            if (k)
+              {
+                unew->Add (*u, p.Rows(0, k));
+                cnew->Add (*cm, gp.Rows(0, k));
+              }
+            unew->Add (*v->Range(IntRange(0, mdone)), p.Rows(k, nn));
+            cnew->Add (*v->Range(IntRange(0, mdone+1)), gp.Rows(k, nn+1));
+            u = unew;
+            cm = cnew;
+            orthonormalize (cm);
+            k = cm->Size();
+          }
+
+	const_cast<int&> (steps) = it;
+      }
+
+    catch (Exception & e)
+      {
+	e.Append ("in caught in GCRODRSolver::Mult\n");
+	throw;
+      }
+    catch (exception & e)
+      {
+	throw Exception(e.what() +
+			string ("\ncaught in GCRODRSolver::Mult\n"));
+      }
+  }
+
+
+
   template class CGSolver<double>;
   template class CGSolver<Complex>;
   template class CGSolver<ComplexConjugate>;
@@ -1335,6 +1899,10 @@ void QMRSolver<SCAL> :: Mult (const BaseVector & b, BaseVector & x) const
   template class GMRESSolver<Complex>;
   template class GMRESSolver<ComplexConjugate>;
   template class GMRESSolver<ComplexConjugate2>;
+  template class DeflatedCGSolver<double>;
+  template class DeflatedCGSolver<Complex>;
+  template class GCRODRSolver<double>;
+  template class GCRODRSolver<Complex>;
 
 
 }
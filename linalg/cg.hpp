@@ -199,7 +199,73 @@ namespace ngla
     ///
     virtual void Mult (const BaseVector & v, BaseVector & prod) const;
   };
-  
+
+
+
+  /**
+     Deflated preconditioned CG with subspace recycling.
+     Approximate eigenvectors of c*a to the smallest eigenvalues are computed
+     from the first search directions of every solve, and deflated in the
+     following solves. a must be hermitian, c hermitian positive definite.
+     The deflation space survives Update(), a*W is recomputed in every solve.
+  */
+  template <class SCAL>
+  class NGS_DLL_HEADER DeflatedCGSolver : public KrylovSpaceSolver
+  {
+    /// dimension of the deflation space
+    int ndefl;
+    /// number of CG directions used for the eigenvector approximation
+    int nharvest;
+    /// deflation space W, and c^{-1} W
+    mutable shared_ptr<MultiVector> w, cinvw;
+  public:
+    ///
+    DeflatedCGSolver (shared_ptr<BaseMatrix> aa, shared_ptr<BaseMatrix> ac, int andefl = 10)
+      : KrylovSpaceSolver (aa, ac), ndefl(andefl), nharvest(max2(2*andefl, 10)) { ; }
+
+    ///
+    shared_ptr<MultiVector> GetDeflationSpace () const { return w; }
+    ///
+    void ResetDeflationSpace () { w = nullptr; cinvw = nullptr; }
+    /// the deflation space is kept
+    void Update () override { ; }
+
+    ///
+    virtual void Mult (const BaseVector & v, BaseVector & prod) const override;
+  };
+
+
+  /**
+     GCRO-DR: restarted GMRES with deflated restarting and subspace recycling.
+     The harmonic Ritz vectors of the left-preconditioned operator from the last
+     cycle span the recycle space U, which is kept between cycles and solves.
+     The recycle space survives Update(), C = c*a*U is recomputed in every solve.
+  */
+  template <class SCAL>
+  class NGS_DLL_HEADER GCRODRSolver : public KrylovSpaceSolver
+  {
+    /// Krylov space dimension of one cycle, including the recycle space
+    int restart;
+    /// dimension of the recycle space
+    int nrecycle;
+    /// recycle space U
+    mutable shared_ptr<MultiVector> u;
+  public:
+    ///
+    GCRODRSolver (shared_ptr<BaseMatrix> aa, shared_ptr<BaseMatrix> ac,
+                  int arestart = 30, int anrecycle = 10)
+      : KrylovSpaceSolver (aa, ac), restart(arestart), nrecycle(anrecycle) { ; }
+
+    ///
+    shared_ptr<MultiVector> GetRecycleSpace () const { return u; }
+    ///
+    void ResetRecycleSpace () { u = nullptr; }
+    /// the recycle space is kept
+    void Update () override { ; }
+
+    ///
+    virtual void Mult (const BaseVector & v, BaseVector & prod) const override;
+  };
 
 
 
@@ -198,7 +198,8 @@ namespace ngla
     */
     if (it >= maxsteps)
       {
-	cout << IM(1) << "maxsteps " << maxsteps << " exceeded !!" << endl;
+        if (printwarning)
+          cout << IM(1) << "maxsteps " << maxsteps << " exceeded !!" << endl;
 	retval = 2;
       }
 
@@ -292,4 +293,259 @@ namespace ngla
       ost << "lam(" << i << ") = " << EigenValue(i) << endl;
   }
 
+  template <typename SCAL>
+  void HermitianEigenSystem (FlatMatrix<SCAL> h, FlatVector<double> lami, FlatMatrix<SCAL> evecs)
+  {
+#ifdef LAPACK
+    size_t n = h.Height();
+    if constexpr (is_same<SCAL,double>::value)
+      {
+        Matrix<double> hsym = 0.5 * (h + Trans(h));
+        Matrix<double> hevecs(n);
+        LapackEigenValuesSymmetric (hsym, lami, hevecs);
+        evecs = Trans (hevecs);
+      }
+    else
+      {
+        Matrix<Complex> hsym(n);
+        for (size_t i = 0; i < n; i++)
+          for (size_t j = 0; j < n; j++)
+            hsym(i,j) = 0.5 * (h(j,i) + conj(h(i,j)));    // transposed for Lapack
+        Vector<Complex> hlami(n);
+        Matrix<Complex> hevecs(n);
+        LapackEigenValues (hsym, hlami, hevecs);
+
+        Array<double> reallami(n);
+        Array<int> index(n);
+        for (size_t i = 0; i < n; i++)
+          {
+            reallami[i] = hlami(i).real();
+            index[i] = i;
+          }
+        QuickSortI (reallami, index);
+        for (size_t i = 0; i < n; i++)
+          {
+            lami(i) = reallami[index[i]];
+            evecs.Col(i) = hevecs.Row(index[i]);
+          }
+      }
+#else
+    throw Exception ("HermitianEigenSystem needs LAPACK");
+#endif
+  }
+
+  template <typename SCAL>
+  Matrix<SCAL> CholeskyQRFactor (FlatMatrix<SCAL> g, double eps)
+  {
+    size_t ns = g.Height();
+    Array<int> keep;
+    Matrix<SCAL> l(ns);    // Cholesky factor of g restricted to the kept columns
+    l = SCAL(0.0);
+    for (size_t i = 0; i < ns; i++)
+      {
+        size_t nk = keep.Size();
+        for (size_t j = 0; j < nk; j++)
+          {
+            SCAL sum = g(i, keep[j]);
+            for (size_t k = 0; k < j; k++)
+              sum -= l(nk,k) * Conj(l(j,k));
+            l(nk,j) = sum / l(j,j);
+          }
+        double gii = std::abs(g(i,i));
+        double d = gii;
+        for (size_t k = 0; k < nk; k++)
+          d -= sqr (std::abs (l(nk,k)));
+        if (d > eps * gii)
+          {
+            l(nk,nk) = sqrt(d);
+            keep.Append (i);
+          }
+      }
+
+    size_t nk = keep.Size();
+    Matrix<SCAL> linv(nk);
+    linv = SCAL(0.0);
+    for (size_t j = 0; j < nk; j++)
+      {
+        linv(j,j) = 1.0 / l(j,j);
+        for (size_t i = j+1; i < nk; i++)
+          {
+            SCAL sum = 0.0;
+            for (size_t k = j; k < i; k++)
+              sum += l(i,k) * linv(k,j);
+            linv(i,j) = -sum / l(i,i);
+          }
+      }
+
+    Matrix<SCAL> r(ns, nk);
+    r = SCAL(0.0);
+    for (size_t i = 0; i < nk; i++)
+      for (size_t j = i; j < nk; j++)
+        r(keep[i], j) = Conj(linv(j,i));
+    return r;
+  }
+
+  template NGS_DLL_HEADER void HermitianEigenSystem (FlatMatrix<double> h, FlatVector<double> lami, FlatMatrix<double> evecs);
+  template NGS_DLL_HEADER void HermitianEigenSystem (FlatMatrix<Complex> h, FlatVector<double> lami, FlatMatrix<Complex> evecs);
+  template NGS_DLL_HEADER Matrix<double> CholeskyQRFactor (FlatMatrix<double> g, double eps);
+  template NGS_DLL_HEADER Matrix<Complex> CholeskyQRFactor (FlatMatrix<Complex> g, double eps);
+
+
+  Vector<double> LOBPCG (const BaseMatrix & a, const BaseMatrix * m,
+                         const BaseMatrix * pre, MultiVector & x,
+                         double tol, int maxit, bool printrates,
+                         const BitArray * freedofs)
+  {
+    static Timer t("LOBPCG");
+    static Timer tmat("LOBPCG - apply matrices");
+    static Timer tpre("LOBPCG - preconditioner");
+    static Timer tortho("LOBPCG - orthogonalize");
+    static Timer trr("LOBPCG - Rayleigh-Ritz");
+    RegionTimer reg(t);
+
+    if (x.IsComplex())
+      throw Exception ("LOBPCG: only real symmetric problems supported");
+
+    size_t n = x.Size();
+    auto refvec = x.RefVec();
+
+    // basis [X | P | W] and its images under A and M
+    shared_ptr<MultiVector> s = refvec->CreateMultiVector (3*n);
+    shared_ptr<MultiVector> as = refvec->CreateMultiVector (3*n);
+    shared_ptr<MultiVector> ms = refvec->CreateMultiVector (3*n);
+    shared_ptr<MultiVector> tmp = refvec->CreateMultiVector (3*n);
+    auto hv = refvec->CreateVector();
+
+    // sets the entries of the not free dofs to zero
+    auto project = [&] (BaseVector & v)
+      {
+        if (!freedofs) return;
+        FlatVector<double> fv = v.FVDouble();
+        size_t es = fv.Size() / v.Size();
+        for (size_t i = 0; i < v.Size(); i++)
+          if (!freedofs->Test(i))
+            fv.Range(i*es, (i+1)*es) = 0.0;
+      };
+
+    auto applyam = [&] (IntRange r)
+      {
+        RegionTimer reg(tmat);
+        Vector<double> ones(r.Size());
+        ones = 1.0;
+        auto sr = s->Range(r);
+        auto asr = as->Range(r);
+        auto msr = ms->Range(r);
+        *asr = 0.0;
+        a.MultAdd (ones, *sr, *asr);
+        if (m)
+          {
+            *msr = 0.0;
+            m->MultAdd (ones, *sr, *msr);
+          }
+        else
+          *msr = *sr;
+      };
+
+    // first r.Width() vectors of mv become (first ns vectors of mv) * r
+    auto transform = [&] (MultiVector & mv, size_t ns, FlatMatrix<double> r)
+      {
+        auto tr = tmp->Range(IntRange(0, r.Width()));
+        *tr = 0.0;
+        tr->Add (*mv.Range(IntRange(0, ns)), r);
+        *mv.Range(IntRange(0, r.Width())) = *tr;
+      };
+
+    Vector<double> lam(n);
+    Array<int> active;
+    size_t np = 0, ns = n;
+
+    *s->Range(IntRange(0, n)) = x;
+    for (size_t i = 0; i < n; i++)
+      project (*(*s)[i]);
+    applyam (IntRange(0, n));
+
+    for (int it = 0; ; it++)
+      {
+        // M-orthonormalize [X | P | W] by Cholesky-QR2
+        size_t nk = ns;
+        {
+          RegionTimer reg(tortho);
+          for (int pass = 0; pass < 2; pass++)
+            {
+              Matrix<double> g = s->Range(IntRange(0, nk))->InnerProductD (*ms->Range(IntRange(0, nk)));
+              Matrix<double> r = CholeskyQRFactor<double> (g);
+              transform (*s, nk, r);
+              transform (*as, nk, r);
+              transform (*ms, nk, r);
+              nk = r.Width();
+            }
+        }
+        if (nk < n)
+          throw Exception ("LOBPCG: initial vectors are linearly dependent");
+
+        // Rayleigh-Ritz, new X, and new P from the P and W components
+        {
+          RegionTimer reg(trr);
+          Matrix<double> h = s->Range(IntRange(0, nk))->InnerProductD (*as->Range(IntRange(0, nk)));
+          Vector<double> evals(nk);
+          Matrix<double> evecs(nk);
+          HermitianEigenSystem<double> (h, evals, evecs);
+          lam = evals.Range(0, n);
+
+          np = (nk > n) ? active.Size() : 0;
+          Matrix<double> c(nk, n+np);
+          for (size_t i = 0; i < n; i++)
+            c.Col(i) = evecs.Col(i);
+          for (size_t j = 0; j < np; j++)
+            {
+              c.Col(n+j) = evecs.Col(active[j]);
+              c.Col(n+j).Range(0, n) = 0.0;
+            }
+          transform (*s, nk, c);
+          transform (*as, nk, c);
+          transform (*ms, nk, c);
+        }
+
+        // residuals, and preconditioned residuals of the not converged pairs as W
+        active.SetSize0();
+        ns = n + np;
+        double maxres = 0;
+        for (size_t i = 0; i < n; i++)
+          {
+            *hv = *(*as)[i] - lam(i) * *(*ms)[i];
+            project (*hv);
+            double res = L2Norm(*hv) / (L2Norm(*(*as)[i]) + fabs(lam(i)) * L2Norm(*(*ms)[i]));
+            maxres = max2 (maxres, res);
+            if (res > tol)
+              {
+                RegionTimer reg(tpre);
+                active.Append (i);
+                if (pre)
+                  pre->Mult (*hv, *(*s)[ns]);
+                else
+                  *(*s)[ns] = *hv;
+                project (*(*s)[ns]);
+                ns++;
+              }
+          }
+
+        if (printrates)
+          cout << IM(1) << "LOBPCG it = " << it << ", converged " << n-active.Size() << "/" << n
+               << ", max residual = " << maxres << endl;
+
+        if (active.Size() == 0 || it >= maxit)
+          break;
+
+        IntRange rw(n+np, ns);
+        auto w = s->Range(rw);
+        Matrix<double> hx = ms->Range(IntRange(0, n))->InnerProductD (*w);
+        hx *= -1;
+        w->Add (*s->Range(IntRange(0, n)), hx);
+        applyam (rw);
+      }
+
+    x = *s->Range(IntRange(0, n));
+    return lam;
+  }
+
 }
@@ -24,6 +24,8 @@ namespace ngla
     double prec;
     ///
     int maxsteps;
+    /// warn if maxsteps is reached
+    bool printwarning = true;
   
   public:
     ///
@@ -38,6 +40,8 @@ namespace ngla
     void SetMaxSteps (int amaxsteps);
     ///
     void SetPrecision (double aprec);
+    /// no warning if maxsteps is reached, e.g. for fixed step estimates
+    void SetPrintWarning (bool aprintwarning) { printwarning = aprintwarning; }
 
     ///
     int Calc();
@@ -52,6 +56,39 @@ namespace ngla
     void PrintEigenValues (ostream & ost) const;
   };
 
+
+
+  /// ascending eigenvalues and eigenvectors (columns) of a small hermitian matrix
+  template <typename SCAL>
+  NGS_DLL_HEADER void HermitianEigenSystem (FlatMatrix<SCAL> h, FlatVector<double> lami,
+                                            FlatMatrix<SCAL> evecs);
+
+  /**
+     Cholesky-QR for the Gram matrix g = S^H M S:
+     returns r such that the columns of S r are M-orthonormal.
+     Columns numerically linear dependent on the previous ones are dropped.
+  */
+  template <typename SCAL>
+  NGS_DLL_HEADER Matrix<SCAL> CholeskyQRFactor (FlatMatrix<SCAL> g, double eps = 1e-12);
+
+
+  /**
+     Locally optimal block preconditioned conjugate gradient method (LOBPCG)
+     for the smallest eigenvalues of the symmetric evp  A x = lam M x.
+
+     x contains the initial vectors, and the M-orthonormal eigenvectors on return.
+     M = nullptr is the identity, pre = nullptr is no preconditioner.
+     Converged eigenpairs are soft-locked: they stay in the Rayleigh-Ritz
+     space, but the preconditioned residual and search direction are no more computed.
+     The bases are M-orthonormalized by Cholesky-QR2.
+     If freedofs is given, initial vectors, residuals and preconditioned
+     residuals are projected to the free dofs.
+  */
+  NGS_DLL_HEADER Vector<double> LOBPCG (const BaseMatrix & a, const BaseMatrix * m,
+                                        const BaseMatrix * pre, MultiVector & x,
+                                        double tol = 1e-8, int maxit = 100,
+                                        bool printrates = false,
+                                        const BitArray * freedofs = nullptr);
 }
 
 #endif
@@ -166,7 +166,7 @@ namespace ngla
     for (int i = 0; i < ne; i++)
       if (!clone.Test(i))
 	{
-	  delete [] &(elmats[i](0,0));
+	  delete [] elmats[i].Data();
 	  if (rowdnums[i].Size() > 0)
 	    delete [] &(rowdnums[i])[0];
 	  if (coldnums[i].Size() > 0)
@@ -239,12 +239,244 @@ namespace ngla
 
 
 
+  // greedy coloring of blocks, blocks of the same color have disjoint dofs
+  template <typename TFUNC>
+  static Table<int> EBEColoring (size_t nblocks, size_t ndof, TFUNC getdofs)
+  {
+    Array<int> col(nblocks);
+    col = -1;
+    Array<unsigned int> mask(ndof);
+    Array<int> dofs;
+
+    int maxcolor = -1;
+    int basecol = 0;
+    size_t found = 0;
+    while (found < nblocks)
+      {
+        mask = 0;
+        for (size_t nr = 0; nr < nblocks; nr++)
+          {
+            if (col[nr] >= 0) continue;
+            getdofs (nr, dofs);
+
+            unsigned check = 0;
+            for (auto d : dofs)
+              check |= mask[d];
+            if (check == UINT_MAX) continue;
+
+            unsigned checkbit = 1;
+            int color = basecol;
+            while (check & checkbit)
+              {
+                color++;
+                checkbit *= 2;
+              }
+            col[nr] = color;
+            maxcolor = max2(maxcolor, color);
+            for (auto d : dofs)
+              mask[d] |= checkbit;
+            found++;
+          }
+        basecol += 8*sizeof(unsigned int);
+      }
+
+    Array<int> cntcol(maxcolor+1);
+    cntcol = 0;
+    for (auto nr : Range(nblocks))
+      cntcol[col[nr]]++;
+    Table<int> coloring(cntcol);
+    cntcol = 0;
+    for (auto nr : Range(nblocks))
+      coloring[col[nr]][cntcol[col[nr]]++] = nr;
+    return coloring;
+  }
+
+
+  template <class SCAL>
+  void ElementByElementMatrix<SCAL> :: Finalize ()
+  {
+    if constexpr (!is_same<SCAL,double>::value)
+      return;
+    else
+      {
+        // reassembly wrote into the existing layout
+        if (values_released) return;
+
+        static Timer t("EBE-matrix::Finalize");
+        RegionTimer reg (t);
+        constexpr size_t SW = SIMD<double>::Size();
+
+        Array<int> els;
+        for (int i = 0; i < rowdnums.Size(); i++)
+          {
+            FlatArray<int> rdi = rowdnums[i];
+            FlatArray<int> cdi = coldnums[i];
+            if (!rdi.Size() || !cdi.Size()) continue;
+            if (rdi[0] == -1 || cdi[0] == -1) continue;  // reserved but not used
+            els.Append (i);
+          }
+
+        // sort by matrix shape
+        QuickSort (els, [&] (int a, int b)
+                   {
+                     size_t ha = rowdnums[a].Size(), hb = rowdnums[b].Size();
+                     if (ha != hb) return ha < hb;
+                     size_t wa = coldnums[a].Size(), wb = coldnums[b].Size();
+                     if (wa != wb) return wa < wb;
+                     return a < b;
+                   });
+
+        // chunks of up to SW elements of equal shape
+        simd_elements.SetSize0();
+        simd_height.SetSize0();
+        simd_width.SetSize0();
+        simd_offset.SetSize0();
+        size_t nval = 0;
+        for (size_t first = 0; first < els.Size(); )
+          {
+            size_t h = rowdnums[els[first]].Size();
+            size_t w = coldnums[els[first]].Size();
+            size_t next = first;
+            while (next < els.Size() && next < first+SW &&
+                   rowdnums[els[next]].Size() == h && coldnums[els[next]].Size() == w)
+              next++;
+
+            for (size_t l = 0; l < SW; l++)
+              simd_elements.Append ( (first+l < next) ? els[first+l] : -1);
+            simd_height.Append (h);
+            simd_width.Append (w);
+            simd_offset.Append (nval);
+            max_row_size = max2(max_row_size, int(h));
+            max_col_size = max2(max_col_size, int(w));
+            nval += h*w;
+            first = next;
+          }
+        simd_offset.Append (nval);
+        size_t nchunks = simd_height.Size();
+
+        simd_values.SetSize (nval);
+        ParallelFor (nchunks, [&] (size_t c)
+                     {
+                       size_t h = simd_height[c], w = simd_width[c];
+                       FlatArray<int> chunk_els (SW, simd_elements.Addr(SW*c));
+                       SIMD<double> * pmat = simd_values.Addr(simd_offset[c]);
+                       for (size_t i = 0; i < h; i++)
+                         for (size_t j = 0; j < w; j++)
+                           pmat[i*w+j] = SIMD<double> ([&] (int l)
+                                                       {
+                                                         int el = chunk_els[l];
+                                                         return (el >= 0) ? elmats[el](i,j) : 0.0;
+                                                       });
+                     });
+
+        auto chunk_dofs = [&] (size_t c, Array<int> & dofs, FlatArray<FlatArray<int>> dnums)
+          {
+            dofs.SetSize0();
+            for (size_t l = 0; l < SW; l++)
+              if (int el = simd_elements[SW*c+l]; el >= 0)
+                for (auto d : dnums[el])
+                  dofs.Append (d);
+          };
+        simd_row_coloring = EBEColoring (nchunks, height, [&] (size_t c, Array<int> & dofs)
+                                         { chunk_dofs (c, dofs, rowdnums); });
+        simd_col_coloring = EBEColoring (nchunks, width, [&] (size_t c, Array<int> & dofs)
+                                         { chunk_dofs (c, dofs, coldnums); });
+        finalized = true;
+
+        simd_position.SetSize (ne);
+        simd_position = -1;
+        for (size_t k = 0; k < simd_elements.Size(); k++)
+          if (simd_elements[k] >= 0)
+            simd_position[simd_elements[k]] = k;
+
+        // release the element matrices, clones share their values
+        if (clone.NumSet() == 0)
+          {
+            if (allvalues.Size())
+              allvalues = Array<SCAL>(1);
+            else
+              for (int i = 0; i < ne; i++)
+                delete [] elmats[i].Data();
+            for (int i = 0; i < ne; i++)
+              elmats[i].AssignMemory (elmats[i].Height(), elmats[i].Width(), nullptr);
+            values_released = true;
+          }
+      }
+  }
+
+
+  template <class SCAL>
+  void ElementByElementMatrix<SCAL> :: MultAddChunk (size_t chunk, bool trans, double s,
+                                                      FlatVector<double> vx, FlatVector<double> vy,
+                                                      FlatArray<SIMD<double>> hx, FlatArray<SIMD<double>> hy) const
+  {
+    constexpr size_t SW = SIMD<double>::Size();
+    FlatArray<int> els (SW, simd_elements.Addr(SW*chunk));
+    size_t h = simd_height[chunk], w = simd_width[chunk];
+    const SIMD<double> * pmat = simd_values.Addr(simd_offset[chunk]);
+
+    // y(rows) += s * A x(cols), or y(cols) += s * A^T x(rows)
+    const Array<FlatArray<int>> & xdnums = trans ? rowdnums : coldnums;
+    const Array<FlatArray<int>> & ydnums = trans ? coldnums : rowdnums;
+    size_t nx = trans ? h : w;
+    size_t ny = trans ? w : h;
+
+    for (size_t j = 0; j < nx; j++)
+      hx[j] = SIMD<double> ([&] (int l)
+                            {
+                              int el = els[l];
+                              return (el >= 0) ? vx(xdnums[el][j]) : 0.0;
+                            });
+
+    if (!trans)
+      for (size_t i = 0; i < h; i++)
+        {
+          SIMD<double> sum(0.0);
+          for (size_t j = 0; j < w; j++)
+            sum += pmat[i*w+j] * hx[j];
+          hy[i] = sum;
+        }
+    else
+      {
+        for (size_t j = 0; j < w; j++)
+          hy[j] = SIMD<double>(0.0);
+        for (size_t i = 0; i < h; i++)
+          for (size_t j = 0; j < w; j++)
+            hy[j] += pmat[i*w+j] * hx[i];
+      }
+
+    for (size_t l = 0; l < SW; l++)
+      if (int el = els[l]; el >= 0)
+        {
+          FlatArray<int> ydi = ydnums[el];
+          for (size_t i = 0; i < ny; i++)
+            vy(ydi[i]) += s * hy[i][l];
+        }
+  }
+
+
   template <>
   void ElementByElementMatrix<double> :: MultAdd (double s, const BaseVector & x, BaseVector & y) const
   {
     static Timer timer("EBE-matrix::MultAdd");
     RegionTimer reg (timer);
 
+    if (finalized)
+      {
+        FlatVector<> vx = x.FV<double> (); 
+        FlatVector<> vy = y.FV<double> (); 
+
+        for (auto col : simd_row_coloring)
+          ParallelForRange (col.Size(), [&] (IntRange r)
+                            {
+                              Array<SIMD<double>> hx(max_col_size), hy(max_row_size);
+                              for (auto c : r)
+                                MultAddChunk (col[c], false, s, vx, vy, hx, hy);
+                            });
+        timer.AddFlops (simd_values.Size()*SIMD<double>::Size());
+        return;
+      }
+
     size_t maxs = 0;
     for (size_t i = 0; i < coldnums.Size(); i++)
       maxs = max2 (maxs, coldnums[i].Size());
@@ -390,6 +622,23 @@ namespace ngla
   {
     static Timer timer("EBE-matrix<double>::MultTransAdd");
     RegionTimer reg (timer);
+
+    if (finalized)
+      {
+        FlatVector<> vx = x.FV<double> (); 
+        FlatVector<> vy = y.FV<double> (); 
+
+        for (auto col : simd_col_coloring)
+          ParallelForRange (col.Size(), [&] (IntRange r)
+                            {
+                              Array<SIMD<double>> hx(max_row_size), hy(max_col_size);
+                              for (auto c : r)
+                                MultAddChunk (col[c], true, s, vx, vy, hx, hy);
+                            });
+        timer.AddFlops (simd_values.Size()*SIMD<double>::Size());
+        return;
+      }
+
     size_t maxs = 0;
     for (size_t i = 0; i < rowdnums.Size(); i++)
       maxs = max2 (maxs, rowdnums[i].Size());
@@ -547,6 +796,30 @@ namespace ngla
       if (coldnums_in[i] >= 0) usedcols.Append(i);
     int sc = usedcols.Size();
 
+    if constexpr (is_same<SCAL,double>::value)
+      if (values_released)
+        {
+          // write into the SIMD layout, the dofs (and the coloring) must not change
+          constexpr size_t SW = SIMD<double>::Size();
+          int pos = simd_position[elnr];
+          if (pos < 0 && (sr == 0 || sc == 0)) return;
+          bool fits = pos >= 0 && rowdnums[elnr].Size() == sr && coldnums[elnr].Size() == sc;
+          for (int i = 0; fits && i < sr; i++)
+            fits = rowdnums[elnr][i] == rowdnums_in[usedrows[i]];
+          for (int j = 0; fits && j < sc; j++)
+            fits = coldnums[elnr][j] == coldnums_in[usedcols[j]];
+          if (!fits)
+            throw Exception ("EBEMatrix::AddElementMatrix, element does not fit the SIMD layout");
+
+          size_t chunk = pos / SW, lane = pos % SW;
+          double * pmat = reinterpret_cast<double*> (simd_values.Addr(simd_offset[chunk]));
+          for (int i = 0; i < sr; i++)
+            for (int j = 0; j < sc; j++)
+              pmat[(i*sc+j)*SW+lane] = elmat(usedrows[i], usedcols[j]);
+          return;
+        }
+    finalized = false;
+
     if (allvalues.Size())
       {
         FlatMatrix<SCAL> mat(elmats[elnr]);
@@ -602,6 +875,9 @@ namespace ngla
                                                          const FlatArray<int> & coldnums_in,
                                                          int refelnr)
   {
+    finalized = false;
+    if (values_released)
+      throw Exception ("AddClone for EBE matrix in SIMD layout");
     if (allvalues.Size())
       throw Exception ("AddClone + allvalues not ready");
 
@@ -651,7 +927,7 @@ namespace ngla
     GetMemoryTracer().Track(allrow, "allrow", allcol, "allcol",
                             allvalues, "allvalues", elmats, "elmats",
                             rowdnums, "rowdnums", coldnums, "coldnums",
-                            clone, "clone");
+                            clone, "clone", simd_values, "simd_values");
   }
 
   template <class SCAL>
@@ -673,7 +949,8 @@ namespace ngla
 	  ost << "block " << i << endl;
 	  ost << "rows = " << rowdnums[i] << endl;
 	  ost << "cols = " << coldnums[i] << endl;
-	  ost << "matrix = " << elmats[i] << endl;
+	  if (!values_released)
+	    ost << "matrix = " << elmats[i] << endl;
 	}
       return ost;
     }
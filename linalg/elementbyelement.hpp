@@ -33,6 +33,16 @@ namespace ngla
 
     Array<int> allrow, allcol;
     Array<SCAL> allvalues;
+
+    // finalized mode: chunks of SIMD-width elements of equal matrix shape
+    bool finalized = false;
+    Array<int> simd_elements;          // SW elements per chunk, -1 for padding
+    Array<int> simd_height, simd_width;
+    Array<size_t> simd_offset;         // first chunk entry in simd_values
+    Array<SIMD<double>> simd_values;   // row-major, interleaved over the elements
+    Table<int> simd_row_coloring, simd_col_coloring;
+    Array<int> simd_position;          // SW*chunk+lane of every element, -1 if not in a chunk
+    bool values_released = false;      // element values are kept in simd_values only
   public:
     ElementByElementMatrix (int h, int ane, bool isymmetric=false);
     ElementByElementMatrix (int h, int w, int ane, bool isymmetric=false);
@@ -63,6 +73,12 @@ namespace ngla
                            FlatArray<int> dnums1,
                            FlatArray<int> dnums2,
                            BareSliceMatrix<SCAL> elmat);
+
+    /// regroup the element matrices for the batched SIMD application (real matrices only).
+    /// The element matrices are released, later AddElementMatrix calls with the
+    /// same dofs write into the batched layout.
+    void Finalize();
+    bool IsFinalized() const { return finalized; }
 			   
     void AddCloneElementMatrix(int elnr,
                            const FlatArray<int> & dnums1,
@@ -77,6 +93,8 @@ namespace ngla
 
     const FlatMatrix<SCAL> GetElementMatrix( int elnum ) const
     {
+      if (values_released)
+        throw Exception ("EBE matrix: element matrices are in the SIMD layout");
       return elmats[elnum];
     }
 
@@ -119,6 +137,9 @@ namespace ngla
 
   private:
     void InitMemoryTracing() const;
+    void MultAddChunk (size_t chunk, bool trans, double s,
+                       FlatVector<double> vx, FlatVector<double> vy,
+                       FlatArray<SIMD<double>> hx, FlatArray<SIMD<double>> hy) const;
   };  
 
 
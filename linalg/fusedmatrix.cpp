@@ -0,0 +1,703 @@
+/*********************************************************************/
+/* File:   fusedmatrix.cpp                                           */
+/*********************************************************************/
+
+/*
+   Operator fusion for sums of sparse matrix products
+*/
+
+#include <la.hpp>
+#include <../parallel/parallel_matrices.hpp>
+
+namespace ngla
+{
+
+  // a factor of a product chain, either a general matrix (possibly transposed),
+  // or an index operator  y(i) = x(pull[i]),  pull[i] = -1 for y(i) = 0
+  struct FusionFactor
+  {
+    const BaseMatrix * mat = nullptr;
+    bool trans = false;
+    size_t height = 0, width = 0;
+    /// empty for the identity
+    Array<int> pull;
+  };
+
+
+  // the transpose of a gather is a scatter, which is again
+  // an index operator if the gather is injective
+  static bool InvertIndexMap (FusionFactor & f)
+  {
+    Array<int> inv(f.width);
+    inv = -1;
+    for (size_t i = 0; i < f.pull.Size(); i++)
+      if (f.pull[i] >= 0)
+        {
+          if (inv[f.pull[i]] >= 0) return false;
+          inv[f.pull[i]] = i;
+        }
+    f.pull = move(inv);
+    swap (f.height, f.width);
+    return true;
+  }
+
+  static bool GetIndexOperator (const BaseMatrix & m, bool trans, FusionFactor & f)
+  {
+    if (auto proj = dynamic_cast<const Projector*> (&m))
+      {
+        const BitArray & bits = *proj->GetMask();
+        bool keep = proj->KeepValues();
+        f.height = f.width = bits.Size();
+        f.pull.SetSize (bits.Size());
+        for (size_t i = 0; i < bits.Size(); i++)
+          f.pull[i] = (bits.Test(i) == keep) ? int(i) : -1;
+        return true;
+      }
+
+    if (auto emb = dynamic_cast<const Embedding*> (&m))
+      {
+        IntRange r = emb->GetRange();
+        f.height = emb->VHeight();
+        f.width = r.Size();
+        f.pull.SetSize (f.height);
+        f.pull = -1;
+        for (size_t i : r)
+          f.pull[i] = i - r.First();
+      }
+    else if (auto embt = dynamic_cast<const EmbeddingTranspose*> (&m))
+      {
+        IntRange r = embt->GetRange();
+        f.height = r.Size();
+        f.width = embt->VWidth();
+        f.pull.SetSize (f.height);
+        for (size_t i = 0; i < r.Size(); i++)
+          f.pull[i] = r.First() + i;
+      }
+    else if (auto perm = dynamic_cast<const PermutationMatrix*> (&m))
+      {
+        auto ind = perm->GetIndices();
+        f.height = ind.Size();
+        f.width = perm->VWidth();
+        f.pull.SetSize (ind.Size());
+        for (size_t i = 0; i < ind.Size(); i++)
+          f.pull[i] = ind[i];
+      }
+    else
+      return false;
+
+    return trans ? InvertIndexMap (f) : true;
+  }
+
+
+  // factors of the product chain m (or m^T), scalar factors are multiplied to scale
+  static void CollectFactors (const BaseMatrix & m, bool trans, double & scale,
+                              Array<FusionFactor> & factors)
+  {
+    if (auto prod = dynamic_cast<const ProductMatrix*> (&m))
+      {
+        if (!trans)
+          {
+            CollectFactors (prod->GetMatrixA(), false, scale, factors);
+            CollectFactors (prod->GetMatrixB(), false, scale, factors);
+          }
+        else
+          {
+            CollectFactors (prod->GetMatrixB(), true, scale, factors);
+            CollectFactors (prod->GetMatrixA(), true, scale, factors);
+          }
+        return;
+      }
+
+    if (auto tm = dynamic_cast<const Transpose*> (&m))
+      {
+        CollectFactors (tm->GetMatrix(), !trans, scale, factors);
+        return;
+      }
+
+    if (auto sm = dynamic_cast<const VScaleMatrix<double>*> (&m))
+      {
+        scale *= sm->GetScale();
+        CollectFactors (sm->GetMatrix(), trans, scale, factors);
+        return;
+      }
+
+    if (auto em = dynamic_cast<const EmbeddedMatrix*> (&m))
+      {
+        // E * mat
+        Embedding emb (em->VHeight(), em->GetRange());
+        FusionFactor f;
+        GetIndexOperator (emb, trans, f);
+        if (!trans)
+          {
+            factors.Append (move(f));
+            CollectFactors (*em->GetMatrix(), false, scale, factors);
+          }
+        else
+          {
+            CollectFactors (*em->GetMatrix(), true, scale, factors);
+            factors.Append (move(f));
+          }
+        return;
+      }
+
+    if (auto em = dynamic_cast<const EmbeddedTransposeMatrix*> (&m))
+      {
+        // mat * E^T
+        EmbeddingTranspose embt (em->VWidth(), em->GetRange());
+        FusionFactor f;
+        GetIndexOperator (embt, trans, f);
+        if (!trans)
+          {
+            CollectFactors (*em->GetMatrix(), false, scale, factors);
+            factors.Append (move(f));
+          }
+        else
+          {
+            factors.Append (move(f));
+            CollectFactors (*em->GetMatrix(), true, scale, factors);
+          }
+        return;
+      }
+
+    if (auto mm = dynamic_cast<const MaskedMatrix*> (&m))
+      {
+        // Prow * mat * Pcol, or Pcol * mat^T * Prow
+        auto left = trans ? mm->GetColMask() : mm->GetRowMask();
+        auto right = trans ? mm->GetRowMask() : mm->GetColMask();
+        bool leftkeep = trans ? mm->ColKeep() : mm->RowKeep();
+        bool rightkeep = trans ? mm->RowKeep() : mm->ColKeep();
+        if (left)
+          {
+            FusionFactor f;
+            GetIndexOperator (Projector(left, leftkeep), false, f);
+            factors.Append (move(f));
+          }
+        CollectFactors (*mm->GetMatrix(), trans, scale, factors);
+        if (right)
+          {
+            FusionFactor f;
+            GetIndexOperator (Projector(right, rightkeep), false, f);
+            factors.Append (move(f));
+          }
+        return;
+      }
+
+    if (auto id = dynamic_cast<const IdentityMatrix*> (&m))
+      {
+        try
+          {
+            FusionFactor f;
+            f.height = f.width = id->VHeight();
+            factors.Append (move(f));
+          }
+        catch (Exception &)
+          { ; }  // identity without format is neutral
+        return;
+      }
+
+    FusionFactor f;
+    if (!GetIndexOperator (m, trans, f))
+      {
+        f.mat = &m;
+        f.trans = trans;
+      }
+    factors.Append (move(f));
+  }
+
+
+  // composes the index operators left of the operator A (of size nrows x ncols)
+  // to the row map, and the index operators right of it to the column map
+  static bool ComposeIndexMaps (FlatArray<FusionFactor> left, FlatArray<FusionFactor> right,
+                                FusedMatrix::Term & term)
+  {
+    size_t nrows = term.nrows, ncols = term.ncols;
+
+    for (int i = left.Size()-1; i >= 0; i--)
+      {
+        auto & f = left[i];
+        if (f.width != nrows) return false;
+        if (f.pull.Size())
+          {
+            Array<int> rowmap(f.height);
+            for (size_t r = 0; r < f.height; r++)
+              {
+                int k = f.pull[r];
+                rowmap[r] = (k < 0 || term.rowmap.Size() == 0) ? k : term.rowmap[k];
+              }
+            term.rowmap = move(rowmap);
+          }
+        nrows = f.height;
+      }
+
+    for (auto & f : right)
+      {
+        if (f.height != ncols) return false;
+        if (f.pull.Size())
+          {
+            if (term.colmap.Size() == 0)
+              {
+                term.colmap.SetSize (f.height);
+                for (size_t j = 0; j < f.height; j++)
+                  term.colmap[j] = f.pull[j];
+              }
+            else
+              for (auto & c : term.colmap)
+                if (c >= 0) c = f.pull[c];
+          }
+        ncols = f.width;
+      }
+
+    term.height = nrows;
+    term.width = ncols;
+    return true;
+  }
+
+  // the maps select a contiguous block of rows and columns
+  static bool ContiguousMaps (FusedMatrix::Term & term)
+  {
+    size_t first = 0;
+    if (term.rowmap.Size())
+      {
+        size_t i = 0;
+        while (i < term.rowmap.Size() && term.rowmap[i] < 0) i++;
+        first = i;
+        for ( ; i < term.rowmap.Size(); i++)
+          if (term.rowmap[i] != (i < first+term.nrows ? int(i-first) : -1))
+            return false;
+        if (first+term.nrows > term.rowmap.Size()) return false;
+      }
+    term.rowrange = IntRange(first, first+term.nrows);
+
+    first = 0;
+    if (term.colmap.Size())
+      {
+        if (term.colmap[0] < 0) return false;
+        first = term.colmap[0];
+        for (size_t j = 0; j < term.colmap.Size(); j++)
+          if (term.colmap[j] != int(first+j))
+            return false;
+      }
+    term.colrange = IntRange(first, first+term.ncols);
+    return true;
+  }
+
+
+  struct FusionResult
+  {
+    Array<FusedMatrix::Term> terms, others;
+
+    void Append (FusionResult && r2)
+    {
+      for (auto & t : r2.terms) terms.Append (move(t));
+      for (auto & t : r2.others) others.Append (move(t));
+    }
+  };
+
+  // the chain  left * m * right  as fused term, or as other term
+  static bool MakeTerm (const BaseMatrix & m, bool trans, double scale,
+                        FlatArray<FusionFactor> left, FlatArray<FusionFactor> right,
+                        FusionResult & res)
+  {
+    Array<FusionFactor> factors;
+    double fscale = 1;
+    CollectFactors (m, trans, fscale, factors);
+
+    int core = -1, ngeneral = 0;
+    for (int i = 0; i < factors.Size(); i++)
+      if (factors[i].mat)
+        {
+          core = i;
+          ngeneral++;
+        }
+
+    const SparseMatrix<double> * spmat = nullptr;
+    if (ngeneral == 1 && !factors[core].trans &&
+        !dynamic_cast<const SparseMatrixSymmetric<double>*> (factors[core].mat))
+      spmat = dynamic_cast<const SparseMatrix<double>*> (factors[core].mat);
+
+    if (factors.Size() && (ngeneral == 0 || spmat))
+      {
+        FusedMatrix::Term term;
+        term.scale = scale * fscale;
+        term.mat = spmat;
+        Array<FusionFactor> hleft, hright;
+        for (auto & f : left) hleft.Append (f);
+        if (spmat)
+          {
+            for (int i = 0; i < core; i++) hleft.Append (move(factors[i]));
+            for (int i = core+1; i < factors.Size(); i++) hright.Append (move(factors[i]));
+            for (auto & f : right) hright.Append (f);
+            term.nrows = spmat->Height();
+            term.ncols = spmat->Width();
+          }
+        else
+          {
+            // pure index operator, the row map points into the input vector
+            for (auto & f : factors) hleft.Append (move(f));
+            for (auto & f : right) hleft.Append (f);
+            term.nrows = term.ncols = hleft.Last().width;
+          }
+
+        if (!ComposeIndexMaps (hleft, hright, term)) return false;
+        res.terms.Append (move(term));
+        return true;
+      }
+
+    FusedMatrix::Term term;
+    term.scale = scale;
+    term.other = &m;
+    term.trans = trans;
+    if (left.Size() || right.Size())
+      {
+        try
+          {
+            term.nrows = trans ? m.Width() : m.Height();
+            term.ncols = trans ? m.Height() : m.Width();
+          }
+        catch (Exception &)
+          {
+            return false;
+          }
+        if (!ComposeIndexMaps (left, right, term)) return false;
+        term.ranges = ContiguousMaps (term);
+      }
+    else
+      term.ranges = true;
+    res.others.Append (move(term));
+    return true;
+  }
+
+
+  // splits sums into product chains, the index operators of the context
+  // left * m * right are distributed over the sums
+  static bool FlattenSum (const BaseMatrix & m, bool trans, double scale,
+                          FlatArray<FusionFactor> left, FlatArray<FusionFactor> right,
+                          FusionResult & res)
+  {
+    if (auto sum = dynamic_cast<const SumMatrix*> (&m))
+      return FlattenSum (sum->GetMatrixA(), trans, scale*sum->GetScaleA(), left, right, res) &&
+        FlattenSum (sum->GetMatrixB(), trans, scale*sum->GetScaleB(), left, right, res);
+
+    if (auto sm = dynamic_cast<const VScaleMatrix<double>*> (&m))
+      return FlattenSum (sm->GetMatrix(), trans, scale*sm->GetScale(), left, right, res);
+
+    if (auto tm = dynamic_cast<const Transpose*> (&m))
+      return FlattenSum (tm->GetMatrix(), !trans, scale, left, right, res);
+
+    // split off the index operators of products and embeddings,
+    // and try to distribute them over the inner operator
+    const BaseMatrix * inner = nullptr;
+    Array<FusionFactor> hleft, hright;
+    double hscale = scale;
+
+    auto all_index = [] (FlatArray<FusionFactor> factors)
+      {
+        for (auto & f : factors)
+          if (f.mat) return false;
+        return true;
+      };
+
+    if (auto prod = dynamic_cast<const ProductMatrix*> (&m))
+      {
+        // factors in the orientation of the result
+        const BaseMatrix & first = trans ? prod->GetMatrixB() : prod->GetMatrixA();
+        const BaseMatrix & second = trans ? prod->GetMatrixA() : prod->GetMatrixB();
+        Array<FusionFactor> fac;
+        CollectFactors (second, trans, hscale, fac);
+        if (all_index (fac))
+          {
+            inner = &first;
+            hright = move(fac);
+          }
+        else
+          {
+            fac.SetSize0();
+            hscale = scale;
+            CollectFactors (first, trans, hscale, fac);
+            if (all_index (fac))
+              {
+                inner = &second;
+                hleft = move(fac);
+              }
+          }
+      }
+    else if (auto em = dynamic_cast<const EmbeddedMatrix*> (&m))
+      {
+        Embedding emb (em->VHeight(), em->GetRange());
+        FusionFactor f;
+        GetIndexOperator (emb, trans, f);
+        inner = em->GetMatrix().get();
+        if (!trans)
+          hleft.Append (move(f));
+        else
+          hright.Append (move(f));
+      }
+    else if (auto em = dynamic_cast<const EmbeddedTransposeMatrix*> (&m))
+      {
+        EmbeddingTranspose embt (em->VWidth(), em->GetRange());
+        FusionFactor f;
+        GetIndexOperator (embt, trans, f);
+        inner = em->GetMatrix().get();
+        if (!trans)
+          hright.Append (move(f));
+        else
+          hleft.Append (move(f));
+      }
+
+    if (inner)
+      {
+        Array<FusionFactor> newleft, newright;
+        for (auto & f : left) newleft.Append (f);
+        for (auto & f : hleft) newleft.Append (move(f));
+        for (auto & f : hright) newright.Append (move(f));
+        for (auto & f : right) newright.Append (f);
+
+        FusionResult hres;
+        if (FlattenSum (*inner, trans, hscale, newleft, newright, hres))
+          {
+            res.Append (move(hres));
+            return true;
+          }
+      }
+
+    return MakeTerm (m, trans, scale, left, right, res);
+  }
+
+
+  shared_ptr<BaseMatrix> FuseOperator (shared_ptr<BaseMatrix> mat)
+  {
+    static Timer t("FuseOperator"); RegionTimer reg(t);
+
+    if (auto parmat = dynamic_pointer_cast<ParallelMatrix> (mat))
+      {
+        auto local = FuseOperator (parmat->GetMatrix());
+        if (local == parmat->GetMatrix()) return mat;
+        return make_shared<ParallelMatrix> (local,
+                                            parmat->GetRowParallelDofs(),
+                                            parmat->GetColParallelDofs(),
+                                            parmat->GetOpType());
+      }
+
+    if (dynamic_pointer_cast<FusedMatrix> (mat))
+      return mat;
+
+    FusionResult res;
+    if (!FlattenSum (*mat, false, 1, Array<FusionFactor>(), Array<FusionFactor>(), res))
+      return mat;
+
+    auto & terms = res.terms;
+    if (terms.Size() == 0)
+      return mat;
+
+    // a plain sparse matrix, nothing to fuse
+    if (terms.Size() == 1 && res.others.Size() == 0 && terms[0].mat && terms[0].scale == 1 &&
+        terms[0].rowmap.Size() == 0 && terms[0].colmap.Size() == 0)
+      return mat;
+
+    // leave dimension errors to the original operator
+    size_t h = terms[0].height, w = terms[0].width;
+    for (auto & term : terms)
+      if (term.height != h || term.width != w)
+        return mat;
+    for (auto & term : res.others)
+      if (term.height && (term.height != h || term.width != w))
+        return mat;
+
+    return make_shared<FusedMatrix> (mat, move(terms), move(res.others), h, w);
+  }
+
+
+
+  FusedMatrix :: FusedMatrix (shared_ptr<BaseMatrix> amat,
+                              Array<Term> && aterms, Array<Term> && aothers,
+                              size_t aheight, size_t awidth)
+    : mat(amat), terms(move(aterms)), others(move(aothers)),
+      height(aheight), width(awidth)
+  {
+    balance.Calc (height, [&] (int i)
+                  {
+                    size_t cost = 1;
+                    for (auto & term : terms)
+                      {
+                        int row = term.rowmap.Size() ? term.rowmap[i] : i;
+                        if (row >= 0 && term.mat)
+                          cost += term.mat->GetRowIndices(row).Size();
+                      }
+                    return cost;
+                  });
+  }
+
+  BaseMatrix::OperatorInfo FusedMatrix :: GetOperatorInfo () const
+  {
+    OperatorInfo info;
+    info.name = "FusedMatrix, " + ToString(terms.Size()) + " fused terms, "
+      + ToString(others.Size()) + " other terms";
+    info.height = Height();
+    info.width = Width();
+    info.childs += mat.get();
+    return info;
+  }
+
+  AutoVector FusedMatrix :: CreateRowVector () const
+  {
+    try
+      {
+        return mat->CreateRowVector();
+      }
+    catch (Exception &)
+      {
+        return CreateBaseVector(width, false, 1);
+      }
+  }
+
+  AutoVector FusedMatrix :: CreateColVector () const
+  {
+    try
+      {
+        return mat->CreateColVector();
+      }
+    catch (Exception &)
+      {
+        return CreateBaseVector(height, false, 1);
+      }
+  }
+
+
+  void FusedMatrix :: Apply (double s, const BaseVector & x, BaseVector & y, bool add) const
+  {
+    static Timer t("FusedMatrix::MultAdd"); RegionTimer reg(t);
+
+    FlatVector<double> fx = x.FV<double>();
+    FlatVector<double> fy = y.FV<double>();
+
+    ParallelForRange
+      (balance, [&] (IntRange myrange)
+       {
+         for (size_t i : myrange)
+           {
+             double sum = 0;
+             for (auto & term : terms)
+               {
+                 int row = term.rowmap.Size() ? term.rowmap[i] : int(i);
+                 if (row < 0) continue;
+                 if (!term.mat)
+                   {
+                     sum += term.scale * fx(row);
+                     continue;
+                   }
+
+                 auto cols = term.mat->GetRowIndices(row);
+                 auto vals = term.mat->GetRowValues(row);
+                 double rowsum = 0;
+                 if (term.colmap.Size() == 0)
+                   for (size_t j = 0; j < cols.Size(); j++)
+                     rowsum += vals(j) * fx(cols[j]);
+                 else
+                   for (size_t j = 0; j < cols.Size(); j++)
+                     {
+                       int c = term.colmap[cols[j]];
+                       if (c >= 0) rowsum += vals(j) * fx(c);
+                     }
+                 sum += term.scale * rowsum;
+               }
+             if (add)
+               fy(i) += s * sum;
+             else
+               fy(i) = s * sum;
+           }
+       });
+
+    for (auto & other : others)
+      {
+        double so = s * other.scale;
+        auto multadd = [&] (const BaseVector & hx, BaseVector & hy)
+          {
+            if (other.trans)
+              other.other->MultTransAdd (so, hx, hy);
+            else
+              other.other->MultAdd (so, hx, hy);
+          };
+
+        if (other.rowmap.Size() == 0 && other.colmap.Size() == 0)
+          multadd (x, y);
+        else if (other.ranges)
+          {
+            auto rx = x.Range(other.colrange);
+            auto ry = y.Range(other.rowrange);
+            multadd (rx, ry);
+          }
+        else
+          {
+            auto htx = CreateBaseVector(other.ncols, false, 1);
+            auto hty = CreateBaseVector(other.nrows, false, 1);
+            BaseVector & tx = *htx;
+            BaseVector & ty = *hty;
+            FlatVector<double> ftx = tx.FV<double>();
+            FlatVector<double> fty = ty.FV<double>();
+            for (size_t j = 0; j < ftx.Size(); j++)
+              {
+                int c = other.colmap.Size() ? other.colmap[j] : int(j);
+                ftx(j) = (c >= 0) ? fx(c) : 0.0;
+              }
+            ty = 0.0;
+            multadd (tx, ty);
+            for (size_t i = 0; i < fy.Size(); i++)
+              {
+                int r = other.rowmap.Size() ? other.rowmap[i] : int(i);
+                if (r >= 0) fy(i) += fty(r);
+              }
+          }
+      }
+  }
+
+  // the fused sweep works on real vectors with scalar entries
+  static bool FusableVectors (const BaseVector & x, const BaseVector & y, size_t h, size_t w)
+  {
+    return !x.IsComplex() && !y.IsComplex() &&
+      x.EntrySize() == 1 && y.EntrySize() == 1 &&
+      x.Size() == w && y.Size() == h;
+  }
+
+  void FusedMatrix :: Mult (const BaseVector & x, BaseVector & y) const
+  {
+    if (FusableVectors (x, y, height, width))
+      Apply (1, x, y, false);
+    else
+      mat->Mult (x, y);
+  }
+
+  void FusedMatrix :: MultAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    if (FusableVectors (x, y, height, width))
+      Apply (s, x, y, true);
+    else
+      mat->MultAdd (s, x, y);
+  }
+
+  void FusedMatrix :: MultAdd (Complex s, const BaseVector & x, BaseVector & y) const
+  {
+    mat->MultAdd (s, x, y);
+  }
+
+  void FusedMatrix :: MultTrans (const BaseVector & x, BaseVector & y) const
+  {
+    mat->MultTrans (x, y);
+  }
+
+  void FusedMatrix :: MultTransAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    mat->MultTransAdd (s, x, y);
+  }
+
+  void FusedMatrix :: MultTransAdd (Complex s, const BaseVector & x, BaseVector & y) const
+  {
+    mat->MultTransAdd (s, x, y);
+  }
+
+  ostream & FusedMatrix :: Print (ostream & ost) const
+  {
+    ost << "FusedMatrix, " << terms.Size() << " fused terms, "
+        << others.Size() << " other terms, of" << endl;
+    return mat->Print (ost);
+  }
+}
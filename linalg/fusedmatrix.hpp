@@ -0,0 +1,102 @@
+#ifndef FILE_NGS_FUSEDMATRIX
+#define FILE_NGS_FUSEDMATRIX
+
+/*
+  Operator fusion for expression trees of BaseMatrices.
+
+  Sums, scalings, transposes and products of real SparseMatrices with
+  index operators (Projector, Embedding, EmbeddingTranspose,
+  PermutationMatrix, IdentityMatrix) are flattened into terms
+
+     s_k * R_k * A_k * C_k
+
+  where the row and column operators R_k and C_k are stored as index maps.
+  All terms are evaluated in one row-parallel sweep over the output vector,
+  no temporary vectors are used. Index operators are distributed over sums.
+  Sub-trees which do not fit into this pattern (e.g. inverses of diagonal
+  blocks) are applied by their own MultAdd after the sweep, on sub-vectors
+  if their index maps are contiguous.
+
+  The index maps are computed once, the matrix values are read
+  in every application (reassembly on the same graph is fine).
+*/
+
+namespace ngla
+{
+
+  class NGS_DLL_HEADER FusedMatrix : public BaseMatrix
+  {
+  public:
+    /**
+       scale * R * A * C, the row operator R and the column operator C are index maps.
+       A is a SparseMatrix (fused), nullptr (pure index operator),
+       or any other operator (applied by its own MultAdd).
+    */
+    struct Term
+    {
+      double scale = 1;
+      /// fused sparse matrix
+      const SparseMatrix<double> * mat = nullptr;
+      /// non-fused operator, and its transpose flag
+      const BaseMatrix * other = nullptr;
+      bool trans = false;
+      /// row of A (input index without A) for every output row, -1 for a zero row. empty for identity
+      Array<int> rowmap;
+      /// input index for every column of A, -1 for a dropped column. empty for identity
+      Array<int> colmap;
+      /// the index maps of a non-fused term are contiguous, it is applied to sub-vectors
+      bool ranges = false;
+      IntRange rowrange, colrange;
+      /// dimensions of A
+      size_t nrows = 0, ncols = 0;
+      /// dimensions of the term, 0 if unknown
+      size_t height = 0, width = 0;
+    };
+
+  private:
+    /// the original operator, keeps the sub-trees alive
+    shared_ptr<BaseMatrix> mat;
+    /// terms of the fused sweep, and the other terms
+    Array<Term> terms, others;
+    size_t height, width;
+    Partitioning balance;
+
+    void Apply (double s, const BaseVector & x, BaseVector & y, bool add) const;
+  public:
+    FusedMatrix (shared_ptr<BaseMatrix> amat, Array<Term> && aterms, Array<Term> && aothers,
+                 size_t aheight, size_t awidth);
+
+    size_t GetNFusedTerms () const { return terms.Size(); }
+    size_t GetNOtherTerms () const { return others.Size(); }
+    shared_ptr<BaseMatrix> GetOriginal () const { return mat; }
+
+    virtual bool IsComplex() const override { return mat->IsComplex(); }
+    virtual BaseMatrix::OperatorInfo GetOperatorInfo () const override;
+
+    virtual int VHeight() const override { return height; }
+    virtual int VWidth() const override { return width; }
+
+    virtual AutoVector CreateRowVector () const override;
+    virtual AutoVector CreateColVector () const override;
+
+    virtual void Mult (const BaseVector & x, BaseVector & y) const override;
+    virtual void MultAdd (double s, const BaseVector & x, BaseVector & y) const override;
+    virtual void MultAdd (Complex s, const BaseVector & x, BaseVector & y) const override;
+    virtual void MultTrans (const BaseVector & x, BaseVector & y) const override;
+    virtual void MultTransAdd (double s, const BaseVector & x, BaseVector & y) const override;
+    virtual void MultTransAdd (Complex s, const BaseVector & x, BaseVector & y) const override;
+
+    virtual ostream & Print (ostream & ost) const override;
+  };
+
+
+  /**
+     Analyses the operator tree, and returns a FusedMatrix if some
+     sparse-matrix or index-operator terms could be fused.
+     Otherwise, the operator itself is returned.
+     ParallelMatrices are fused locally.
+  */
+  NGS_DLL_HEADER shared_ptr<BaseMatrix> FuseOperator (shared_ptr<BaseMatrix> mat);
+}
+
+#endif
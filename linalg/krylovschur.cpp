@@ -0,0 +1,287 @@
+/**************************************************************************/
+/* File:   krylovschur.cpp                                                */
+/**************************************************************************/
+
+/*
+
+Krylov-Schur Eigenvalue Solver with thick restart
+
+*/
+
+#include <la.hpp>
+
+namespace ngla
+{
+
+  // h(i) = v_i^H w, the reductions are done by the vector inner products
+  template <typename SCAL>
+  static Vector<SCAL> InnerProducts (const MultiVector & v, const BaseVector & w)
+  {
+    if constexpr (is_same<SCAL,double>::value)
+      return v.InnerProductD (w);
+    else
+      {
+        Vector<Complex> h = v.InnerProductC (w, true);
+        for (size_t i = 0; i < h.Size(); i++)
+          h(i) = conj(h(i));
+        return h;
+      }
+  }
+
+  // w^H mw
+  template <typename SCAL>
+  static double InnerProductReal (const BaseVector & w, const BaseVector & mw)
+  {
+    if constexpr (is_same<SCAL,double>::value)
+      return w.InnerProductD (mw);
+    else
+      return w.InnerProductC (mw, true).real();
+  }
+
+
+  // eigen-decomposition of the projected matrix, eigenvectors are the columns of evecs
+  static void ProjectedEVP (FlatMatrix<double> s, FlatVector<double> lami, FlatMatrix<double> evecs)
+  {
+#ifdef LAPACK
+    Matrix<double> hs = 0.5 * (s + Trans(s));
+    Matrix<double> hevecs(s.Height());
+    LapackEigenValuesSymmetric (hs, lami, hevecs);
+    evecs = Trans (hevecs);
+#else
+    throw Exception ("KrylovSchur needs LAPACK");
+#endif
+  }
+
+  static void ProjectedEVP (FlatMatrix<Complex> s, FlatVector<Complex> lami, FlatMatrix<Complex> evecs)
+  {
+#ifdef LAPACK
+    Matrix<Complex> hs = Trans (s);
+    Matrix<Complex> hevecs(s.Height());
+    LapackEigenValues (hs, lami, hevecs);
+    evecs = Trans (hevecs);
+#else
+    throw Exception ("KrylovSchur needs LAPACK");
+#endif
+  }
+
+  // Gram-Schmidt (twice) for the columns of q
+  template <typename SCAL>
+  static void OrthonormalizeColumns (FlatMatrix<SCAL> q)
+  {
+    for (size_t i = 0; i < q.Width(); i++)
+      {
+        for (int pass = 0; pass < 2; pass++)
+          for (size_t l = 0; l < i; l++)
+            {
+              SCAL c = 0.0;
+              for (size_t r = 0; r < q.Height(); r++)
+                c += Conj(q(r,l)) * q(r,i);
+              q.Col(i) -= c * q.Col(l);
+            }
+        q.Col(i) /= L2Norm (q.Col(i));
+      }
+  }
+
+
+  template <typename SCAL>
+  shared_ptr<MultiVector> KrylovSchur<SCAL> :: Calc (int nev, Array<SCAL> & lam)
+  {
+    static Timer t("KrylovSchur");
+    static Timer tortho("KrylovSchur - orthogonalize");
+    static Timer tinv("KrylovSchur - inverse");
+    static Timer trestart("KrylovSchur - restart");
+    RegionTimer reg(t);
+
+    shared_ptr<BaseMatrix> inv = inverse;
+    if (!inv)
+      {
+        if (m)
+          {
+            auto mat_shift = a->CreateMatrix();
+            mat_shift->AsVector() = a->AsVector() - shift*m->AsVector();
+            inv = mat_shift->InverseMatrix (freedofs);
+          }
+        else if (shift == SCAL(0.0))
+          inv = a->InverseMatrix (freedofs);
+        else
+          throw Exception ("KrylovSchur: shift without M needs an inverse");
+      }
+
+    auto hw = a->CreateColVector();
+    auto hmw = a->CreateColVector();
+    BaseVector & w = *hw;
+    BaseVector & mw = *hmw;
+
+    int mdim = (maxdim > 0) ? maxdim : 2*nev+10;
+    mdim = min2 (size_t(mdim), w.Size());
+    if (nev > mdim)
+      throw Exception ("KrylovSchur: number of eigenvalues " + ToString(nev)
+                       + " is greater than Krylov space dimension " + ToString(mdim));
+
+    shared_ptr<MultiVector> basis = w.CreateMultiVector (mdim+1);
+
+    auto applym = [&] (const BaseVector & x, BaseVector & y)
+      {
+        if (m)
+          m->Mult (x, y);
+        else
+          y = x;
+      };
+
+    auto randomize = [&] (BaseVector & v)
+      {
+        v.SetRandom();
+        v.SetParallelStatus (CUMULATED);
+        if (freedofs)
+          {
+            FlatVector<SCAL> fv = v.FV<SCAL>();
+            size_t es = fv.Size() / v.Size();
+            for (size_t i = 0; i < v.Size(); i++)
+              if (!freedofs->Test(i))
+                fv.Range(i*es, (i+1)*es) = SCAL(0.0);
+          }
+      };
+
+    // classical Gram-Schmidt in the M-inner product, two passes
+    // h = V^H M x for the first j basis vectors, returns |x|_M
+    auto orthogonalize = [&] (BaseVector & x, int j, FlatVector<SCAL> h)
+      {
+        RegionTimer reg(tortho);
+        h = SCAL(0.0);
+        if (j > 0)
+          {
+            auto vj = basis->Range(IntRange(0, j));
+            for (int pass = 0; pass < 2; pass++)
+              {
+                applym (x, mw);
+                Vector<SCAL> hi = InnerProducts<SCAL> (*vj, mw);
+                h += hi;
+                hi *= -1;
+                vj->AddTo (hi, x);
+              }
+          }
+        applym (x, mw);
+        return sqrt (fabs (InnerProductReal<SCAL> (x, mw)));
+      };
+
+
+    // Krylov-Schur decomposition  Op V_k = V_k S_k + v_k b^H
+    // with b^H stored in row k of s
+    Matrix<SCAL> s(mdim+1, mdim);
+    Matrix<SCAL> sm(mdim), y(mdim);
+    Vector<SCAL> theta(mdim), h(mdim+1);
+    Array<int> order(mdim);
+    int k = 0, nconv = 0;
+
+    s = SCAL(0.0);
+    randomize (w);
+    w /= orthogonalize (w, 0, h.Range(0,0));
+    *(*basis)[0] = w;
+
+    for (iterations = 1; ; iterations++)
+      {
+        for (int j = k; j < mdim; j++)
+          {
+            applym (*(*basis)[j], mw);
+            tinv.Start();
+            inv->Mult (mw, w);
+            tinv.Stop();
+
+            FlatVector<SCAL> hj = h.Range(0, j+1);
+            double beta = orthogonalize (w, j+1, hj);
+            s.Col(j).Range(0, j+1) = hj;
+
+            if (beta <= 1e-12 * L2Norm(hj))
+              {
+                // invariant subspace found, continue with a random vector
+                randomize (w);
+                Vector<SCAL> hdummy(j+1);
+                beta = orthogonalize (w, j+1, hdummy);
+                s(j+1, j) = 0.0;
+              }
+            else
+              s(j+1, j) = beta;
+
+            if (beta > 0) w /= beta;
+            *(*basis)[j+1] = w;
+          }
+
+        sm = s.Rows(0, mdim);
+        ProjectedEVP (sm, theta, y);
+
+        // largest Ritz values of the shifted inverse are closest to the shift
+        Array<double> abstheta(mdim);
+        for (int i = 0; i < mdim; i++)
+          {
+            order[i] = i;
+            abstheta[i] = abs(theta(i));
+          }
+        QuickSortI (abstheta, order, [] (double a, double b) { return a > b; });
+
+        // residual of the Ritz pair is |b^H y|
+        nconv = 0;
+        for (int i = 0; i < nev; i++)
+          {
+            SCAL res = 0.0;
+            for (int r = 0; r < mdim; r++)
+              res += s(mdim, r) * y(r, order[i]);
+            if (abs(res) > tol * abs(theta(order[i]))) break;
+            nconv++;
+          }
+
+        if (printrates)
+          cout << IM(1) << "KrylovSchur restart " << iterations
+               << ", converged " << nconv << "/" << nev << endl;
+
+        if (nconv >= nev || iterations >= maxiter)
+          break;
+
+        // thick restart: keep the wanted Ritz vectors
+        RegionTimer regr(trestart);
+        int kk = min2 (max2 (nev, (nev+mdim)/2), mdim-1);
+
+        Matrix<SCAL> q(mdim, kk);
+        for (int i = 0; i < kk; i++)
+          q.Col(i) = y.Col(order[i]);
+        OrthonormalizeColumns<SCAL> (q);
+
+        auto vk = w.CreateMultiVector (kk);
+        *vk = SCAL(0.0);
+        vk->Add (*basis->Range(IntRange(0, mdim)), q);
+        *basis->Range(IntRange(0, kk)) = *vk;
+        *(*basis)[kk] = *(*basis)[mdim];
+
+        Matrix<SCAL> qh(kk, mdim);
+        for (int i = 0; i < kk; i++)
+          for (int r = 0; r < mdim; r++)
+            qh(i,r) = Conj(q(r,i));
+        Matrix<SCAL> sq = sm * q;
+        Vector<SCAL> bnew = Trans(q) * s.Row(mdim);
+
+        s = SCAL(0.0);
+        s.Rows(0, kk).Cols(0, kk) = qh * sq;
+        s.Row(kk).Range(0, kk) = bnew;
+        k = kk;
+      }
+
+    if (nconv < nev)
+      cout << IM(1) << "KrylovSchur: only " << nconv << " of " << nev
+           << " eigenvalues converged" << endl;
+
+    Matrix<SCAL> q(mdim, nev);
+    for (int i = 0; i < nev; i++)
+      q.Col(i) = y.Col(order[i]);
+
+    shared_ptr<MultiVector> evecs = w.CreateMultiVector (nev);
+    *evecs = SCAL(0.0);
+    evecs->Add (*basis->Range(IntRange(0, mdim)), q);
+
+    lam.SetSize (nev);
+    for (int i = 0; i < nev; i++)
+      lam[i] = shift + SCAL(1.0) / theta(order[i]);
+    return evecs;
+  }
+
+  template class KrylovSchur<double>;
+  template class KrylovSchur<Complex>;
+}
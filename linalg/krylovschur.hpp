@@ -0,0 +1,66 @@
+#ifndef FILE_KRYLOVSCHUR
+#define FILE_KRYLOVSCHUR
+
+/**************************************************************************/
+/* File:   krylovschur.hpp                                                */
+/**************************************************************************/
+
+namespace ngla
+{
+  /**
+     Krylov-Schur Eigenvalue Solver.
+
+     Solve the generalized evp
+
+     A x = lam M x
+
+     for the eigenvalues closest to the shift. It iterates with
+     (A - shift M)^{-1} M in the M-inner product, the Krylov basis is
+     stored in a MultiVector. At every restart the Krylov-Schur
+     decomposition is compressed to the wanted Ritz vectors (thick restart),
+     such that at most maxdim+1 large vectors are needed.
+
+     For SCAL = double, A and M must be symmetric.
+     M must be (in theory) positive definite, M = nullptr is the identity.
+     The shifted inverse is InverseMatrix(freedofs) of A - shift M,
+     or any BaseMatrix set by SetInverse (e.g. a Krylov-space solver).
+   */
+
+  template <typename SCAL>
+  class NGS_DLL_HEADER KrylovSchur
+  {
+    shared_ptr<BaseMatrix> a;
+    shared_ptr<BaseMatrix> m;
+    shared_ptr<BitArray> freedofs;
+    shared_ptr<BaseMatrix> inverse;
+    SCAL shift = 0.0;
+    int maxdim = 0;
+    int maxiter = 100;
+    double tol = 1e-10;
+    bool printrates = false;
+    int iterations = 0;
+
+  public:
+    KrylovSchur (shared_ptr<BaseMatrix> aa, shared_ptr<BaseMatrix> am,
+                 shared_ptr<BitArray> afreedofs = nullptr)
+      : a(aa), m(am), freedofs(afreedofs) { ; }
+
+    void SetShift (SCAL ashift) { shift = ashift; }
+    /// (approximate) inverse of A - shift M
+    void SetInverse (shared_ptr<BaseMatrix> ainverse) { inverse = ainverse; }
+    /// dimension of the Krylov space, default is 2*nev+10
+    void SetMaxDim (int amaxdim) { maxdim = amaxdim; }
+    /// maximal number of restarts
+    void SetMaxIterations (int amaxiter) { maxiter = amaxiter; }
+    /// relative residual of the Ritz pairs
+    void SetTolerance (double atol) { tol = atol; }
+    void SetPrintRates (bool aprintrates) { printrates = aprintrates; }
+    /// number of restarts needed in the last Calc
+    int GetIterations () const { return iterations; }
+
+    /// nev eigenvalues closest to the shift, and the M-normalized eigenvectors
+    shared_ptr<MultiVector> Calc (int nev, Array<SCAL> & lam);
+  };
+}
+
+#endif
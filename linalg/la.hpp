@@ -26,6 +26,7 @@ namespace ngla
 
 #include "paralleldofs.hpp"
 #include "basevector.hpp"
+#include "vectorpool.hpp"
 #include "vvector.hpp"
 #include "multivector.hpp"
 #include "basematrix.hpp"
@@ -42,11 +43,15 @@ namespace ngla
 #include "blockjacobi.hpp"
 #include "commutingAMG.hpp"
 #include "special_matrix.hpp"
+#include "fusedmatrix.hpp"
 #include "elementbyelement.hpp"
 #include "cg.hpp"
 #include "chebyshev.hpp"
 #include "eigen.hpp"
 #include "arnoldi.hpp"
+#include "krylovschur.hpp"
+#include "multishift.hpp"
+#include "binarystorage.hpp"
 
 #include "cuda_linalg.hpp"
 #endif
@@ -0,0 +1,280 @@
+/**************************************************************************/
+/* File:   multishift.cpp                                                 */
+/**************************************************************************/
+
+/*
+
+Multi-shift GMRES for frequency sweeps
+
+*/
+
+#include <la.hpp>
+
+namespace ngla
+{
+
+  // h(i) = v_i^H w
+  template <typename SCAL>
+  static Vector<SCAL> InnerProducts (const MultiVector & v, const BaseVector & w)
+  {
+    if constexpr (is_same<SCAL,double>::value)
+      return v.InnerProductD (w);
+    else
+      {
+        Vector<Complex> h = v.InnerProductC (w, true);
+        for (size_t i = 0; i < h.Size(); i++)
+          h(i) = conj(h(i));
+        return h;
+      }
+  }
+
+  // rotation G = [ conj(c) conj(s) ; -s c ] with G (a,b)^T = (r,0)^T
+  template <typename SCAL>
+  static void CalcGivens (SCAL a, SCAL b, SCAL & c, SCAL & s)
+  {
+    double r = sqrt (abs(a)*abs(a) + abs(b)*abs(b));
+    if (r == 0)
+      {
+        c = 1.0;
+        s = 0.0;
+        return;
+      }
+    c = a / r;
+    s = b / r;
+  }
+
+  template <typename SCAL>
+  static void ApplyGivens (SCAL c, SCAL s, SCAL & x, SCAL & y)
+  {
+    SCAL hx = Conj(c)*x + Conj(s)*y;
+    y = -s*x + c*y;
+    x = hx;
+  }
+
+  // column j of  [I;0] - delta H
+  template <typename SCAL>
+  static void ShiftedColumn (FlatMatrix<SCAL> h, int j, SCAL delta, FlatVector<SCAL> col)
+  {
+    for (int i = 0; i <= j+1; i++)
+      col(i) = -delta * h(i,j);
+    col(j) += 1.0;
+  }
+
+
+  template <typename SCAL>
+  shared_ptr<BaseMatrix> MultiShiftSolver<SCAL> :: GetInverse (SCAL tau)
+  {
+    for (size_t i = 0; i < factored.Size(); i++)
+      if (factored[i] == tau)
+        return inverses[i];
+
+    static Timer t("MultiShiftSolver - factor");
+    RegionTimer reg(t);
+
+    auto mat_shift = k->CreateMatrix();
+    mat_shift->AsVector() = k->AsVector() - tau*m->AsVector();
+    factored.Append (tau);
+    shifted.Append (mat_shift);
+    inverses.Append (mat_shift->InverseMatrix (freedofs));
+    return inverses.Last();
+  }
+
+
+  template <typename SCAL>
+  shared_ptr<MultiVector> MultiShiftSolver<SCAL> :: Solve (FlatArray<SCAL> shifts, const BaseVector & f)
+  {
+    static Timer t("MultiShiftSolver");
+    static Timer tinv("MultiShiftSolver - inverse");
+    static Timer tortho("MultiShiftSolver - orthogonalize");
+    static Timer tshift("MultiShiftSolver - shifted systems");
+    RegionTimer reg(t);
+
+    if (!m)
+      throw Exception ("MultiShiftSolver: needs the matrix M");
+
+    size_t ns = shifts.Size();
+    shared_ptr<MultiVector> sols = f.CreateMultiVector (ns);
+    *sols = SCAL(0.0);
+    steps.SetSize (ns);
+    steps = 0;
+    if (ns == 0) return sols;
+
+    // given anchors, or anchors evenly distributed among the sorted shifts
+    Array<SCAL> anch (anchors);
+    if (anch.Size() == 0)
+      {
+        Array<double> re(ns);
+        Array<int> order(ns);
+        for (size_t i = 0; i < ns; i++)
+          {
+            re[i] = std::real (shifts[i]);
+            order[i] = i;
+          }
+        QuickSortI (re, order);
+        size_t na = min2 (size_t(max2 (nanchors, 1)), ns);
+        for (size_t i = 0; i < na; i++)
+          anch.Append (shifts[order[(2*i+1)*ns/(2*na)]]);
+      }
+
+    // every shift is solved with the closest anchor
+    Array<int> anchornr(ns);
+    for (size_t i = 0; i < ns; i++)
+      {
+        int best = 0;
+        for (int a = 1; a < anch.Size(); a++)
+          if (abs(shifts[i]-anch[a]) < abs(shifts[i]-anch[best]))
+            best = a;
+        anchornr[i] = best;
+      }
+
+    auto hw = k->CreateColVector();
+    auto hmw = k->CreateColVector();
+    BaseVector & w = *hw;
+    BaseVector & mw = *hmw;
+
+    // GMRES state of a shifted system
+    struct ShiftState
+    {
+      int nr;
+      SCAL delta;
+      Array<SCAL> c, s;
+      SCAL g;
+      int dim = 0;
+      bool converged = false;
+    };
+
+    for (int a = 0; a < anch.Size(); a++)
+      {
+        Array<ShiftState> states;
+        for (size_t i = 0; i < ns; i++)
+          if (anchornr[i] == a)
+            {
+              ShiftState st;
+              st.nr = i;
+              st.delta = shifts[i]-anch[a];
+              states.Append (st);
+            }
+        if (states.Size() == 0) continue;
+
+        auto inv = GetInverse (anch[a]);
+
+        tinv.Start();
+        inv->Mult (f, w);
+        tinv.Stop();
+        double beta = w.L2Norm();
+        if (beta == 0) continue;
+        for (auto & st : states)
+          st.g = beta;
+
+        int maxdim = min2 (size_t(maxsteps), w.Size());
+        shared_ptr<MultiVector> basis = w.CreateMultiVector (1);
+        w /= beta;
+        *(*basis)[0] = w;
+
+        // Arnoldi:  P M V_j = V_{j+1} H
+        Matrix<SCAL> h(maxdim+1, maxdim);
+        h = SCAL(0.0);
+        Vector<SCAL> col(maxdim+1);
+        size_t nconv = 0;
+
+        for (int j = 0; j < maxdim && nconv < states.Size(); j++)
+          {
+            m->Mult (*(*basis)[j], mw);
+            tinv.Start();
+            inv->Mult (mw, w);
+            tinv.Stop();
+
+            // classical Gram-Schmidt, two passes
+            tortho.Start();
+            double wnorm = w.L2Norm();
+            auto vj = basis->Range(IntRange(0, j+1));
+            for (int pass = 0; pass < 2; pass++)
+              {
+                Vector<SCAL> hi = InnerProducts<SCAL> (*vj, w);
+                h.Col(j).Range(0, j+1) += hi;
+                hi *= -1;
+                vj->AddTo (hi, w);
+              }
+            double hnext = w.L2Norm();
+            h(j+1, j) = hnext;
+            tortho.Stop();
+
+            // residuals of the shifted least squares problems
+            // min | beta e_0 - ([I;0] - delta H) y |
+            // breakdown if the new direction is in the span of the basis, 
+            // relative to P M v_j, since the basis is normalized but the rhs is not
+            bool breakdown = hnext <= 1e-14 * wnorm;
+            tshift.Start();
+            for (auto & st : states)
+              {
+                if (st.converged) continue;
+                FlatVector<SCAL> colj = col.Range(0, j+2);
+                ShiftedColumn<SCAL> (h, j, st.delta, colj);
+                for (int l = 0; l < j; l++)
+                  ApplyGivens (st.c[l], st.s[l], colj(l), colj(l+1));
+                SCAL c, s;
+                CalcGivens (colj(j), colj(j+1), c, s);
+                st.c.Append (c);
+                st.s.Append (s);
+                st.g = -s * st.g;
+                st.dim = j+1;
+                if (abs(st.g) < tol * beta || breakdown)
+                  {
+                    st.converged = true;
+                    nconv++;
+                  }
+              }
+            tshift.Stop();
+
+            if (printrates)
+              cout << IM(1) << "MultiShift anchor " << anch[a] << ", step " << j+1
+                   << ", converged " << nconv << "/" << states.Size() << endl;
+
+            if (breakdown) break;
+            if (nconv < states.Size())
+              {
+                w /= hnext;
+                basis->Extend();
+                *(*basis)[j+1] = w;
+              }
+          }
+
+        if (nconv < states.Size())
+          cout << IM(1) << "MultiShiftSolver: only " << nconv << " of " << states.Size()
+               << " shifts converged at anchor " << anch[a] << endl;
+
+        // u = V y,  with the least squares solution y
+        RegionTimer regs(tshift);
+        for (auto & st : states)
+          {
+            int n = st.dim;
+            Matrix<SCAL> r(n+1, n);
+            Vector<SCAL> g(n+1), y(n);
+            g = SCAL(0.0);
+            g(0) = beta;
+            for (int j = 0; j < n; j++)
+              {
+                ShiftedColumn<SCAL> (h, j, st.delta, col.Range(0, j+2));
+                r.Col(j).Range(0, j+2) = col.Range(0, j+2);
+                for (int l = 0; l < j; l++)
+                  ApplyGivens (st.c[l], st.s[l], r(l,j), r(l+1,j));
+                ApplyGivens (st.c[j], st.s[j], r(j,j), r(j+1,j));
+                ApplyGivens (st.c[j], st.s[j], g(j), g(j+1));
+              }
+            for (int j = n-1; j >= 0; j--)
+              {
+                SCAL sum = g(j);
+                for (int l = j+1; l < n; l++)
+                  sum -= r(j,l) * y(l);
+                y(j) = sum / r(j,j);
+              }
+            basis->Range(IntRange(0, n))->AddTo (y, *(*sols)[st.nr]);
+            steps[st.nr] = n;
+          }
+      }
+    return sols;
+  }
+
+  template class MultiShiftSolver<double>;
+  template class MultiShiftSolver<Complex>;
+}
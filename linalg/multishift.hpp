@@ -0,0 +1,75 @@
+#ifndef FILE_MULTISHIFT
+#define FILE_MULTISHIFT
+
+/**************************************************************************/
+/* File:   multishift.hpp                                                 */
+/**************************************************************************/
+
+namespace ngla
+{
+  /**
+     Multi-shift Krylov solver for frequency sweeps.
+
+     Solves the shifted systems
+
+     (K - shift_i M) u_i = f
+
+     for many shifts with a few factorizations. Every shift is assigned
+     to the closest anchor tau, with P = (K - tau M)^{-1} the systems read
+
+     (I - (shift_i-tau) P M) u_i = P f,
+
+     the Krylov space of P M is shared by all shifts of an anchor.
+     One Arnoldi basis is built per anchor, and every shift solves its
+     own small GMRES least squares problem (Givens rotations).
+
+     The factorizations are InverseMatrix(freedofs) of K - tau M, they
+     are kept for following solves with the same anchors.
+     K and M must have the same sparsity pattern.
+   */
+
+  template <typename SCAL>
+  class NGS_DLL_HEADER MultiShiftSolver
+  {
+    shared_ptr<BaseMatrix> k;
+    shared_ptr<BaseMatrix> m;
+    shared_ptr<BitArray> freedofs;
+    Array<SCAL> anchors;
+    int nanchors = 1;
+    int maxsteps = 200;
+    double tol = 1e-8;
+    bool printrates = false;
+    /// Krylov space dimension per shift of the last Solve
+    Array<int> steps;
+
+    /// factorized anchors, the shifted matrices and their inverses
+    Array<SCAL> factored;
+    Array<shared_ptr<BaseMatrix>> shifted, inverses;
+
+    shared_ptr<BaseMatrix> GetInverse (SCAL tau);
+  public:
+    MultiShiftSolver (shared_ptr<BaseMatrix> ak, shared_ptr<BaseMatrix> am,
+                      shared_ptr<BitArray> afreedofs = nullptr)
+      : k(ak), m(am), freedofs(afreedofs) { ; }
+
+    /// shifts where K - shift M is factorized
+    void SetAnchors (FlatArray<SCAL> aanchors)
+    {
+      anchors.SetSize0();
+      for (auto a : aanchors) anchors.Append (a);
+    }
+    /// number of anchors chosen from the shifts, if no anchors are given
+    void SetNumAnchors (int anumanchors) { nanchors = anumanchors; }
+    /// maximal Krylov space dimension per anchor
+    void SetMaxSteps (int amaxsteps) { maxsteps = amaxsteps; }
+    /// relative residual of the preconditioned systems
+    void SetTolerance (double atol) { tol = atol; }
+    void SetPrintRates (bool aprintrates) { printrates = aprintrates; }
+    FlatArray<int> GetSteps () const { return steps; }
+
+    /// solutions for all shifts
+    shared_ptr<MultiVector> Solve (FlatArray<SCAL> shifts, const BaseVector & f);
+  };
+}
+
+#endif
@@ -70,8 +70,9 @@ namespace ngla {
       throw Exception("MultiVector assignment sizes mismatch, my size = "
                       + ToString(Size()) + " other size = " + ToString(v2.Size()));
     
-    for (auto i : ngstd::Range(vecs))
-      *vecs[i] = *v2.vecs[i];
+    Vector<double> ones(Size());
+    ones = 1;
+    v2.AssignTo (ones, *this);
     return *this;
   }
   
@@ -292,8 +293,7 @@ namespace ngla {
 
   void MultiVector :: AppendOrthogonalize (shared_ptr<BaseVector> v, BaseMatrix * ipmat)
   {
-    vecs.Append (v->CreateVector());
-    *vecs.Last() = *v;
+    Append (v);
 
     if (IsComplex())    
       this->T_Orthogonalize<Complex> (ipmat);
@@ -63,11 +63,11 @@ namespace ngla {
     virtual unique_ptr<MultiVector> VectorRange(IntRange r) const; // range of each component vector
     virtual unique_ptr<MultiVector> SubSet(const Array<int> & indices) const;
     
-    void Extend (size_t nr = 1) {
+    virtual void Extend (size_t nr = 1) {
       for ([[maybe_unused]] auto i : ngstd::Range(nr))
         vecs.Append (refvec->CreateVector());
     }
-    void Append (shared_ptr<BaseVector> v)
+    virtual void Append (shared_ptr<BaseVector> v)
     {
       vecs.Append (v->CreateVector());
       *vecs.Last() = *v;
@@ -168,6 +168,10 @@ void ExportSparseMatrix(py::module m)
     .def("CreateTranspose", [] (const SparseMatrix<T> & sp)
          { return sp.CreateTranspose (); }, "Return transposed matrix")
 
+    .def("Restrict", [] (const SparseMatrix<T> & sp, const SparseMatrix<double> & prol)
+         { return sp.Restrict (prol); }, py::arg("prol"),
+         "Return Galerkin product Trans(prol) * self * prol")
+
     .def("__matmul__", [] (const SparseMatrix<double> & a, const SparseMatrix<double> & b)
          { return MatMult(a,b); }, py::arg("mat"))
     .def("__matmul__", [](shared_ptr<SparseMatrix<T>> a, shared_ptr<BaseMatrix> mb)
@@ -239,6 +243,20 @@ void NGS_DLL_HEADER ExportNgla(py::module &m) {
           { return CreateBaseVector(s,is_complex, es); },
           "size"_a, "complex"_a=false, "entrysize"_a=1);
 
+    m.def("VectorPoolMemoryUsage", [] ()
+          {
+            std::vector<tuple<string,size_t,size_t>> ret;
+            for (auto mui : VectorPool::Get().GetMemoryUsage())
+              ret.push_back (make_tuple(mui.Name(), mui.NBytes(), mui.NBlocks()));
+            return ret;
+          }, "cached, used and reused memory of the vector pool as (name, bytes, blocks)");
+
+    m.def("SetVectorPoolSize", [] (size_t nbytes) { VectorPool::Get().SetMaxCached(nbytes); },
+          "nbytes"_a, "maximal memory kept by the vector pool, 0 disables the pool");
+
+    m.def("ClearVectorPool", [] () { VectorPool::Get().Clear(); },
+          "releases the memory cached by the vector pool");
+
     m.def("CreateParallelVector",
           [] (shared_ptr<ParallelDofs> pardofs, PARALLEL_STATUS status) -> shared_ptr<BaseVector>
           {
@@ -297,16 +315,18 @@ void NGS_DLL_HEADER ExportNgla(py::module &m) {
                       shared_ptr<BaseVector> bv;
                       if (state[1].cast<bool>())
                         {
-                          // create basevector with owning pointer and afterwards assign it to mem
-                          auto bptr = make_shared<S_BaseVectorPtr<Complex>>(0, state[2].cast<size_t>());
-                          bptr->AssignMemory(state[0].cast<size_t>(), mv.Ptr());
+                          // owning vector, the unpickled buffer is copied and released
+                          auto bptr = make_shared<S_BaseVectorPtr<Complex>>(state[0].cast<size_t>(), state[2].cast<size_t>()/2);
+                          memcpy (bptr->Memory(), mv.Ptr(), mv.Size());
+                          delete [] static_cast<char*> (mv.Ptr());
                           return bptr;
                         }
                       else
                         {
-                          // create basevector with owning pointer and afterwards assign it to mem
-                          auto bptr = make_shared<S_BaseVectorPtr<double>>(0, state[2].cast<size_t>());
-                          bptr->AssignMemory(state[0].cast<size_t>(), mv.Ptr());
+                          // owning vector, the unpickled buffer is copied and released
+                          auto bptr = make_shared<S_BaseVectorPtr<double>>(state[0].cast<size_t>(), state[2].cast<size_t>());
+                          memcpy (bptr->Memory(), mv.Ptr(), mv.Size());
+                          delete [] static_cast<char*> (mv.Ptr());
                           return bptr;
                         }
                     }
@@ -1014,6 +1034,11 @@ freedofs : BitArray
 inverse : string
   Solver to use, allowed values are:
     sparsecholesky - internal solver of NGSolve for symmetric matrices
+    sparsecholesky_mixed - sparse Cholesky factor stored in single precision, with iterative refinement
+                     in double precision (real symmetric positive definite matrices).
+                     The factorization runs in double precision, then the factor is rounded:
+                     this halves the memory of the stored factor, but raises the peak memory
+                     of the factorization to 1.5 times the one of sparsecholesky.
     umfpack        - solver by Suitesparse/UMFPACK (if NGSolve was configured with USE_UMFPACK=ON)
     pardiso        - PARDISO, either provided by libpardiso (USE_PARDISO=ON) or Intel MKL (USE_MKL=ON).
                      If neither Pardiso nor Intel MKL was linked at compile-time, NGSolve will look
@@ -1287,10 +1312,16 @@ inverse : string
 
   py::class_<SparseMatrixDynamic<double>, shared_ptr<SparseMatrixDynamic<double>>, BaseMatrix>
     (m, "SparseMatrixDynamic")
-    .def(py::init([] (const BaseMatrix & mat) -> shared_ptr<SparseMatrixDynamic<double>>
+    .def(py::init([] (const BaseMatrix & mat, size_t blocksize) -> shared_ptr<SparseMatrixDynamic<double>>
                   {
                     if (auto ptr = dynamic_cast<const SparseMatrixTM<double>*> (&mat); ptr)
-                      return make_shared<SparseMatrixDynamic<double>> (*ptr);
+                      {
+                        if (blocksize == 0)
+                          blocksize = SparseMatrixDynamic<double>::FindBlockSize (*ptr);
+                        if (blocksize > 1)
+                          return make_shared<SparseMatrixDynamic<double>> (*ptr, blocksize);
+                        return make_shared<SparseMatrixDynamic<double>> (*ptr);
+                      }
                     if (auto ptr = dynamic_cast<const SparseMatrixTM<Mat<2,2>>*> (&mat); ptr)
                       return make_shared<SparseMatrixDynamic<double>> (*ptr);
                     if (auto ptr = dynamic_cast<const SparseMatrixTM<Mat<3,3>>*> (&mat); ptr)
@@ -1308,9 +1339,11 @@ inverse : string
                       return make_shared<SparseMatrixDynamic<double>> (*ptr);
 #endif                    
                     return nullptr;
-                  })
-         )
-         ;
+                  }), py::arg("mat"), py::arg("blocksize")=1,
+         "blocksize: for scalar matrices, use blocks of this size. 0 detects the node-block structure")
+    .def_property_readonly("entrysizes", [](shared_ptr<SparseMatrixDynamic<double>> self)
+                           { return self->EntrySizes(); })
+    ;
 
 
   py::class_<SparseMatrixVariableBlocks<double>, shared_ptr<SparseMatrixVariableBlocks<double>>, BaseMatrix>
@@ -1358,6 +1391,17 @@ inverse : string
 
   py::class_<SparseCholesky<double>, shared_ptr<SparseCholesky<double>>, SparseFactorization> (m, "SparseCholesky_d");
   py::class_<SparseCholesky<Complex>, shared_ptr<SparseCholesky<Complex>>, SparseFactorization> (m, "SparseCholesky_c");
+  py::class_<SparseCholeskyFloat, shared_ptr<SparseCholeskyFloat>, SparseCholesky<double>> (m, "SparseCholesky_f");
+
+  py::class_<MixedPrecisionInverse, shared_ptr<MixedPrecisionInverse>, BaseMatrix>
+    (m, "MixedPrecisionInverse",
+     "Inverse by iterative refinement, with a low precision inverse as preconditioner")
+    .def(py::init<shared_ptr<BaseMatrix>, shared_ptr<BaseMatrix>, double, int>(),
+         py::arg("mat"), py::arg("inverse"), py::arg("tol")=1e-12, py::arg("maxsteps")=20)
+    .def_property_readonly("steps", &MixedPrecisionInverse::GetSteps,
+                           "refinement steps of the last solve")
+    .def_property_readonly("inverse", &MixedPrecisionInverse::GetLowPrecisionInverse)
+    ;
   
   py::class_<Projector, shared_ptr<Projector>, BaseMatrix> (m, "Projector")
     .def(py::init<shared_ptr<BitArray>,bool>(),
@@ -1365,6 +1409,26 @@ inverse : string
          "Linear operator projecting to true/false bits of BitArray mask, depending on argument range")
     .def("Project", &Projector::Project, "project vector inline")
     ;
+
+  py::class_<MaskedMatrix, shared_ptr<MaskedMatrix>, BaseMatrix> (m, "MaskedMatrix",
+                                                                  "Projected sparse matrix, Projector @ mat @ Projector creates it")
+    .def(py::init<shared_ptr<BaseSparseMatrix>,shared_ptr<BitArray>,bool,shared_ptr<BitArray>,bool>(),
+         py::arg("mat"), py::arg("rowmask")=nullptr, py::arg("rowrange")=true,
+         py::arg("colmask")=nullptr, py::arg("colrange")=true,
+         "rows and columns are kept where the mask equals range, no mask keeps all")
+    .def_property_readonly("mat", &MaskedMatrix::GetMatrix)
+    .def_property_readonly("rowmask", &MaskedMatrix::GetRowMask)
+    .def_property_readonly("colmask", &MaskedMatrix::GetColMask)
+    ;
+
+  py::class_<PairedSparseMatrix, shared_ptr<PairedSparseMatrix>, BaseMatrix> (m, "PairedSparseMatrix",
+                                                                              "K + z M for real sparse matrices on the same graph, applied to complex vectors in one sweep")
+    .def(py::init<shared_ptr<SparseMatrix<double>>,shared_ptr<SparseMatrix<double>>,Complex>(),
+         py::arg("k"), py::arg("m"), py::arg("z"))
+    .def_property("z", &PairedSparseMatrix::GetFactor, &PairedSparseMatrix::SetFactor,
+                  "factor of the second matrix, e.g. i omega")
+    .def_property_readonly("samegraph", &PairedSparseMatrix::SameGraph)
+    ;
   
   py::class_<ngla::IdentityMatrix, shared_ptr<ngla::IdentityMatrix>, BaseMatrix> (m, "IdentityMatrix")
     .def(py::init<>())
@@ -1414,6 +1478,21 @@ inverse : string
          { return ComposeOperators(mb, ma); }, py::arg("mat"))
     
     ;
+
+  py::class_<FusedMatrix, shared_ptr<FusedMatrix>, BaseMatrix> (m, "FusedMatrix")
+    .def_property_readonly("nfused", &FusedMatrix::GetNFusedTerms, "number of terms evaluated in the fused sweep")
+    .def_property_readonly("nother", &FusedMatrix::GetNOtherTerms, "number of terms applied by their own MultAdd")
+    .def_property_readonly("original", &FusedMatrix::GetOriginal)
+    ;
+
+  m.def("FuseOperator", &FuseOperator, py::arg("mat"), R"raw_string(
+Analyses the operator tree built from sums, products, transposes and scalings of
+real sparse matrices with Projector, Embedding and PermutationMatrix operators.
+Projectors, embeddings and permutations are folded into index maps, and all
+sparse terms are evaluated in one row-parallel sweep without temporary vectors.
+Terms which cannot be fused are applied as before.
+Returns the operator itself if nothing can be fused.
+)raw_string");
     
   py::class_<KrylovSpaceSolver, shared_ptr<KrylovSpaceSolver>, BaseMatrix> (m, "KrylovSpaceSolver")
     .def("GetSteps", &KrylovSpaceSolver::GetSteps)
@@ -1506,6 +1585,94 @@ precision : float
 maxsteps : int
   input maximal steps. GMRESSolver stops after this steps.
 
+)raw_string"))
+    ;
+
+  m.def("DeflatedCGSolver", [](shared_ptr<BaseMatrix> mat, shared_ptr<BaseMatrix> pre,
+                               int ndefl, bool printrates, double precision, int maxsteps)
+        {
+          shared_ptr<KrylovSpaceSolver> solver;
+          if (!mat->IsComplex())
+            solver = make_shared<DeflatedCGSolver<double>> (mat, pre, ndefl);
+          else
+            solver = make_shared<DeflatedCGSolver<Complex>> (mat, pre, ndefl);
+          solver->SetPrecision(precision);
+          solver->SetMaxSteps(maxsteps);
+          solver->SetPrintRates (printrates);
+          return solver;
+        },
+        py::arg("mat"), py::arg("pre"), py::arg("ndefl")=10, py::arg("printrates")=true,
+        py::arg("precision")=1e-8, py::arg("maxsteps")=200, docu_string(R"raw_string(
+A deflated CG Solver with subspace recycling. Approximate eigenvectors
+to the smallest eigenvalues of pre*mat are computed in every solve and
+deflated in the following solves with the same solver object.
+
+Parameters:
+
+mat : ngsolve.la.BaseMatrix
+  input hermitian matrix 
+
+pre : ngsolve.la.BaseMatrix
+  input hermitian positive definite preconditioner matrix
+
+ndefl : int
+  input dimension of the deflation space
+
+printrates : bool
+  input printrates
+
+precision : float
+  input requested precision. DeflatedCGSolver stops if precision is reached.
+
+maxsteps : int
+  input maximal steps. DeflatedCGSolver stops after this steps.
+
+)raw_string"))
+    ;
+
+  m.def("GCRODRSolver", [](shared_ptr<BaseMatrix> mat, shared_ptr<BaseMatrix> pre,
+                           int restart, int nrecycle, bool printrates, double precision, int maxsteps)
+        {
+          shared_ptr<KrylovSpaceSolver> solver;
+          if (!mat->IsComplex())
+            solver = make_shared<GCRODRSolver<double>> (mat, pre, restart, nrecycle);
+          else
+            solver = make_shared<GCRODRSolver<Complex>> (mat, pre, restart, nrecycle);
+          solver->SetPrecision(precision);
+          solver->SetMaxSteps(maxsteps);
+          solver->SetPrintRates (printrates);
+          return solver;
+        },
+        py::arg("mat"), py::arg("pre"), py::arg("restart")=30, py::arg("nrecycle")=10,
+        py::arg("printrates")=true, py::arg("precision")=1e-8, py::arg("maxsteps")=200,
+        docu_string(R"raw_string(
+Restarted GMRES with deflated restarting and subspace recycling (GCRO-DR).
+The harmonic Ritz vectors of the last cycle are kept between cycles and
+between solves with the same solver object.
+
+Parameters:
+
+mat : ngsolve.la.BaseMatrix
+  input matrix 
+
+pre : ngsolve.la.BaseMatrix
+  input preconditioner matrix, applied from the left
+
+restart : int
+  input dimension of the Krylov space of one cycle, including the recycle space
+
+nrecycle : int
+  input dimension of the recycle space
+
+printrates : bool
+  input printrates
+
+precision : float
+  input requested precision. GCRODRSolver stops if precision is reached.
+
+maxsteps : int
+  input maximal steps. GCRODRSolver stops after this steps.
+
 )raw_string"))
     ;
 
@@ -1523,7 +1690,50 @@ maxsteps : int
     "The typical usecase of this function is to calculate the condition number of a preconditioner."
     "It uses the Lanczos algorithm and bisection for the tridiagonal matrix"
     );
-  
+
+  m.def("LOBPCG", [](shared_ptr<BaseMatrix> mata, shared_ptr<BaseMatrix> matm,
+                     shared_ptr<BaseMatrix> pre, shared_ptr<MultiVector> vecs,
+                     double tol, int maxit, bool printrates, shared_ptr<BitArray> freedofs)
+        {
+          return LOBPCG (*mata, matm.get(), pre.get(), *vecs, tol, maxit, printrates, freedofs.get());
+        },
+        py::arg("mata"), py::arg("matm"), py::arg("pre"), py::arg("vecs"),
+        py::arg("tol")=1e-8, py::arg("maxit")=100, py::arg("printrates")=false,
+        py::arg("freedofs")=nullptr,
+        py::call_guard<py::gil_scoped_release>(),
+        docu_string(R"raw_string(
+Locally optimal block preconditioned conjugate gradient method for the
+smallest eigenvalues of the symmetric EVP A*u = M*lam*u.
+
+Returns the eigenvalues, the eigenvectors are written into vecs.
+
+Parameters:
+
+mata : ngsolve.la.BaseMatrix
+  matrix A
+
+matm : ngsolve.la.BaseMatrix
+  matrix M, None for the identity
+
+pre : ngsolve.la.BaseMatrix
+  preconditioner for A, or None
+
+vecs : ngsolve.la.MultiVector
+  initial vectors, one per eigenvalue
+
+tol : float
+  relative residual of the eigenpairs
+
+maxit : int
+  maximal number of iterations
+
+printrates : bool
+  print number of converged eigenpairs
+
+freedofs : ngsolve.BitArray
+  the iteration is restricted to these dofs, None for all dofs
+)raw_string"));
+
   py::class_<QMRSolver<double>, shared_ptr<QMRSolver<double>>, BaseMatrix> (m, "QMRSolverD")
     ;
   py::class_<QMRSolver<Complex>, shared_ptr<QMRSolver<Complex>>, BaseMatrix> (m, "QMRSolverC")
@@ -1651,8 +1861,218 @@ vecs : list
 shift : object
   complex or real shift
 )raw_string"));
+
+  m.def("KrylovSchurSolver", [](shared_ptr<BaseMatrix> mata, shared_ptr<BaseMatrix> matm,
+                                shared_ptr<BitArray> freedofs, int nev, Complex shift,
+                                shared_ptr<BaseMatrix> inverse, int maxdim, double tol,
+                                int maxiter, bool printrates) -> py::tuple
+        {
+          auto setup = [&] (auto & solver)
+            {
+              solver.SetInverse (inverse);
+              solver.SetMaxDim (maxdim);
+              solver.SetTolerance (tol);
+              solver.SetMaxIterations (maxiter);
+              solver.SetPrintRates (printrates);
+            };
+
+          if (mata->IsComplex())
+            {
+              KrylovSchur<Complex> solver (mata, matm, freedofs);
+              solver.SetShift (shift);
+              setup (solver);
+              Array<Complex> lam;
+              auto evecs = solver.Calc (nev, lam);
+
+              Vector<Complex> vlam(lam.Size());
+              for (int i = 0; i < lam.Size(); i++)
+                vlam(i) = lam[i];
+              py::gil_scoped_acquire acq;
+              return py::make_tuple (vlam, evecs);
+            }
+          else
+            {
+              if (shift.imag())
+                throw Exception("Only real shifts allowed for real KrylovSchur");
+              KrylovSchur<double> solver (mata, matm, freedofs);
+              solver.SetShift (shift.real());
+              setup (solver);
+              Array<double> lam;
+              auto evecs = solver.Calc (nev, lam);
+
+              Vector<double> vlam(lam.Size());
+              for (int i = 0; i < lam.Size(); i++)
+                vlam(i) = lam[i];
+              py::gil_scoped_acquire acq;
+              return py::make_tuple (vlam, evecs);
+            }
+        },
+        py::arg("mata"), py::arg("matm"), py::arg("freedofs"), py::arg("nev"),
+        py::arg("shift")=0.0, py::arg("inverse")=nullptr, py::arg("maxdim")=0,
+        py::arg("tol")=1e-10, py::arg("maxiter")=100, py::arg("printrates")=false,
+        py::call_guard<py::gil_scoped_release>(),
+        docu_string(R"raw_string(
+Krylov-Schur eigenvalue solver with thick restart
+
+Solves the generalized linear EVP A*u = M*lam*u by a restarted Arnoldi (Lanczos
+for real symmetric problems) iteration for (A-shift*M)^(-1)*M in the M-inner product.
+The nev eigenvalues closest to the shift are returned, together with a MultiVector
+of the M-normalized eigenvectors.
+
+Parameters:
+
+mata : ngsolve.la.BaseMatrix
+  matrix A, must be symmetric if real
+
+matm : ngsolve.la.BaseMatrix
+  matrix M, None for the identity
+
+freedofs : nsolve.ngstd.BitArray
+  correct degrees of freedom
+
+nev : int
+  number of eigenvalues
+
+shift : object
+  complex or real shift
+
+inverse : ngsolve.la.BaseMatrix
+  inverse of A-shift*M, computed by a sparse factorization if not given
+
+maxdim : int
+  dimension of the Krylov space before restart, default is 2*nev+10
+
+tol : float
+  relative residual of the eigenpairs
+
+maxiter : int
+  maximal number of restarts
+
+printrates : bool
+  print number of converged eigenpairs after every restart
+)raw_string"));
+
+  m.def("MultiShiftSolver", [](shared_ptr<BaseMatrix> matk, shared_ptr<BaseMatrix> matm,
+                               shared_ptr<BaseVector> rhs, py::list shifts,
+                               shared_ptr<BitArray> freedofs, py::list anchors, int nanchors,
+                               double tol, int maxsteps, bool printrates)
+        {
+          auto cshifts = makeCArray<Complex> (shifts);
+          auto canchors = makeCArray<Complex> (anchors);
+          py::gil_scoped_release release;
+
+          auto setup = [&] (auto & solver)
+            {
+              solver.SetNumAnchors (nanchors);
+              solver.SetTolerance (tol);
+              solver.SetMaxSteps (maxsteps);
+              solver.SetPrintRates (printrates);
+            };
+
+          if (matk->IsComplex())
+            {
+              MultiShiftSolver<Complex> solver (matk, matm, freedofs);
+              solver.SetAnchors (canchors);
+              setup (solver);
+              return solver.Solve (cshifts, *rhs);
+            }
+
+          Array<double> rshifts, ranchors;
+          for (auto s : cshifts)
+            {
+              if (s.imag())
+                throw Exception("Only real shifts allowed for real MultiShiftSolver");
+              rshifts.Append (s.real());
+            }
+          for (auto s : canchors)
+            {
+              if (s.imag())
+                throw Exception("Only real anchors allowed for real MultiShiftSolver");
+              ranchors.Append (s.real());
+            }
+          MultiShiftSolver<double> solver (matk, matm, freedofs);
+          solver.SetAnchors (ranchors);
+          setup (solver);
+          return solver.Solve (rshifts, *rhs);
+        },
+        py::arg("matk"), py::arg("matm"), py::arg("rhs"), py::arg("shifts"),
+        py::arg("freedofs")=nullptr, py::arg("anchors")=py::list(), py::arg("nanchors")=1,
+        py::arg("tol")=1e-8, py::arg("maxsteps")=200, py::arg("printrates")=false,
+        docu_string(R"raw_string(
+Multi-shift Krylov solver for frequency sweeps
+
+Solves (K - shift*M) u = rhs for all shifts. Only the matrices K - tau*M at a few
+anchors tau are factorized, every shift is solved by GMRES for the
+shift-and-invert operator (K-tau*M)^(-1)*M of the closest anchor. The Krylov
+space is shared by all shifts of an anchor. Returns a MultiVector with one
+solution per shift.
+
+Parameters:
+
+matk : ngsolve.la.BaseMatrix
+  matrix K
+
+matm : ngsolve.la.BaseMatrix
+  matrix M, same sparsity pattern as K
+
+rhs : ngsolve.la.BaseVector
+  right hand side
+
+shifts : list
+  list of (complex or real) shifts
+
+freedofs : nsolve.ngstd.BitArray
+  correct degrees of freedom
+
+anchors : list
+  shifts where K - tau*M is factorized, chosen among the shifts if empty
+
+nanchors : int
+  number of anchors chosen among the shifts, if no anchors are given
+
+tol : float
+  relative residual of the preconditioned systems
+
+maxsteps : int
+  maximal Krylov space dimension per anchor
+
+printrates : bool
+  print number of converged shifts after every step
+)raw_string"));
+
   
-  
+
+  m.def("SaveBinary", [](const BaseMatrix & mat, string filename)
+        {
+          auto spmat = dynamic_cast<const BaseSparseMatrix*> (&mat);
+          if (!spmat)
+            throw Exception ("SaveBinary: only sparse matrices supported");
+          SaveBinary (*spmat, filename);
+        }, py::arg("mat"), py::arg("filename"),
+        "write sparse matrix as flat binary file, for LoadBinaryMatrix");
+
+  m.def("SaveBinary", [](const BaseVector & vec, string filename)
+        {
+          SaveBinary (vec, filename);
+        }, py::arg("vec"), py::arg("filename"),
+        "write vector as flat binary file, for LoadBinaryVector");
+
+  m.def("LoadBinaryMatrix", &LoadBinaryMatrix, py::arg("filename"), py::arg("copy")=false,
+        docu_string(R"raw_string(
+Load a sparse matrix written by SaveBinary.
+
+Parameters:
+
+filename : string
+  input file
+
+copy : bool
+  if False, the memory-mapped file is used as storage of the matrix
+  (no copy, modifications are not written back), otherwise the data is copied
+)raw_string"));
+
+  m.def("LoadBinaryVector", &LoadBinaryVector, py::arg("filename"), py::arg("copy")=false,
+        "Load a vector written by SaveBinary, memory-mapped unless copy=True");
 
   m.def("DoArchive" , [](shared_ptr<Archive> & arch, BaseMatrix & mat)
                                          { cout << "output basematrix" << endl;
@@ -1653,9 +1653,9 @@ namespace ngla
 
 
 
-  template <class TM, class TV_ROW, class TV_COL>
+  template <class TM, class TV_ROW, class TV_COL> template <typename TF>
   void SparseCholesky<TM, TV_ROW, TV_COL> :: 
-  SolveReordered (FlatVector<TVX> hy) const
+  SolveReordered (FlatVector<TVX> hy, TF * plfact) const
   {
     static Timer timer1("SparseCholesky<d,d,d>::MultAdd fac1");
     static Timer timer2("SparseCholesky<d,d,d>::MultAdd fac2");
@@ -1754,7 +1754,7 @@ namespace ngla
                                      size_t size = range.end()-i-1;
                                      if (size > 0)
                                        {
-                                         FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                         FlatVector<TF> vlfact(size, plfact+firstinrow[i]);
                                          
                                          auto hyr = hy.Range(i+1, range.end());
                                          for (size_t j = 0; j < size; j++)
@@ -1766,7 +1766,7 @@ namespace ngla
                                          continue;
                                        }
                                      size_t first = firstinrow[i] + range.end()-i-1;
-                                     FlatVector<TM> ext_lfact (extdofs.Size(), &lfact[first]);
+                                     FlatVector<TF> ext_lfact (extdofs.Size(), plfact+first);
                                      for (size_t j = 0; j < temp.Size(); j++)
                                        temp(j) += Trans(ext_lfact(j)) * hyi;
                                    }
@@ -1782,7 +1782,7 @@ namespace ngla
                                    {
                                      size_t size = range.end()-i-1;
                                      if (size == 0) continue;
-                                     FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                     FlatVector<TF> vlfact(size, plfact+firstinrow[i]);
 
                                      TVX hyi = hy(i);
                                      auto hyr = hy.Range(i+1, range.end());
@@ -1808,7 +1808,7 @@ namespace ngla
                                        {
                                          size_t first = firstinrow[i] + range.end()-i-1;
                                          
-                                         FlatVector<TM> ext_lfact (all_extdofs.Size(), &lfact[first]);
+                                         FlatVector<TF> ext_lfact (all_extdofs.Size(), plfact+first);
  
                                          TVX hyi = hy(i);
                                          for (size_t j = 0; j < temp.Size(); j++)
@@ -1864,7 +1864,7 @@ namespace ngla
                                    for (auto i : range)
                                      {
                                        size_t first = firstinrow[i] + range.end()-i-1;
-                                       FlatVector<TM> ext_lfact (extdofs.Size(), &lfact[first]);
+                                       FlatVector<TF> ext_lfact (extdofs.Size(), plfact+first);
                                        
                                        TVX val(0.0);
                                        for (auto j : Range(extdofs))
@@ -1875,7 +1875,7 @@ namespace ngla
                                    {
                                      size_t size = range.end()-i-1;
                                      if (size == 0) continue;
-                                     FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                     FlatVector<TF> vlfact(size, plfact+firstinrow[i]);
                                      auto hyr = hy.Range(i+1, range.end());
 
                                      TVX hyi = hy(i);
@@ -1893,7 +1893,7 @@ namespace ngla
                                    {
                                      size_t size = range.end()-i-1;
                                      if (size == 0) continue;
-                                     FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                     FlatVector<TF> vlfact(size, plfact+firstinrow[i]);
                                      auto hyr = hy.Range(i+1, range.end());
 
                                      TVX hyi = hy(i);
@@ -1920,7 +1920,7 @@ namespace ngla
                                      for (auto i : range)
                                        {
                                          size_t first = firstinrow[i] + range.end()-i-1;
-                                         FlatVector<TM> ext_lfact (all_extdofs.Size(), &lfact[first]);
+                                         FlatVector<TF> ext_lfact (all_extdofs.Size(), plfact+first);
     
                                          TVX val(0.0);
                                          for (auto j : Range(extdofs))
@@ -1942,7 +1942,7 @@ namespace ngla
   {
     static Timer timer("SparseCholesky<d,d,d>::MultAdd");
     RegionTimer reg (timer);
-    timer.AddFlops (2.0*lfact.Size());
+    timer.AddFlops (2.0*nze);
 
     // int n = Height();
     
@@ -2336,6 +2336,113 @@ namespace ngla
 
 
 
+  SparseCholeskyFloat ::
+  SparseCholeskyFloat (const SparseMatrixTM<double> & a, 
+                       shared_ptr<BitArray> ainner,
+                       shared_ptr<const Array<int>> acluster)
+    : SparseCholesky<double> (a, ainner, acluster)
+  {
+    RoundFactor();
+  }
+
+  void SparseCholeskyFloat :: RoundFactor ()
+  {
+    static Timer t("SparseCholeskyFloat - round factor");
+    RegionTimer reg(t);
+
+    auto & lfact = SparseCholeskyTM<double>::lfact;
+    lfact_float.SetSize (lfact.Size());
+    ParallelForRange (lfact.Size(), [&] (IntRange r)
+                      {
+                        for (auto i : r)
+                          lfact_float[i] = lfact[i];
+                      });
+    lfact = NumaInterleavedArray<double> ();
+  }
+
+  void SparseCholeskyFloat :: Update()
+  {
+    SparseCholeskyTM<double>::lfact = NumaInterleavedArray<double> (nze);
+    BASE::Update();
+    RoundFactor();
+  }
+
+  void SparseCholeskyFloat :: SetOrig (int i, int j, const double & val)
+  {
+    if (SparseCholeskyTM<double>::lfact.Size() != nze)
+      throw Exception ("SparseCholeskyFloat::SetOrig: the factor is stored in single precision");
+    BASE::SetOrig (i, j, val);
+  }
+
+  const double & SparseCholeskyFloat :: Get (int i, int j) const
+  {
+    auto & diag = SparseCholeskyTM<double>::diag;
+    auto & firstinrow = SparseCholeskyTM<double>::firstinrow;
+    if (i == j)
+      return diag[i];
+
+    if (i > j) 
+      {
+	swap (i, j);
+	cerr << "SparseCholesky::Get: access to upper side not available" << endl;
+      }
+
+    for (size_t first = firstinrow[i], first_ri = firstinrow_ri[i];
+         first < firstinrow[i+1]; first++, first_ri++)
+      if (rowindex2[first_ri] == j)
+        {
+          get_val = lfact_float[first];
+          return get_val;
+        }
+    cerr << "Position " << i << ", " << j << " not found" << endl;
+    get_val = 0;
+    return get_val;
+  }
+
+  ostream & SparseCholeskyFloat :: Print (ostream & ost) const
+  {
+    auto & diag = SparseCholeskyTM<double>::diag;
+    auto & order = SparseCholeskyTM<double>::order;
+    auto & firstinrow = SparseCholeskyTM<double>::firstinrow;
+    int n = SparseCholeskyTM<double>::height;
+
+    for (int i = 0; i < n; i++)
+      ost << i << ": " << order[i] << " diag = " << diag[i] << endl;
+    ost << endl;
+  
+    size_t j = 1;
+    for (int i = 1; i <= n; i++)
+      {
+	size_t j_ri = firstinrow_ri[i-1];
+	ost << i << ": ";
+	for ( ; j < firstinrow[i]; j++, j_ri++)
+          ost << rowindex2[j_ri] << "(" << lfact_float[j] << ")  ";
+	ost << endl;
+      }
+    return ost;
+  }
+
+
+
+  void MixedPrecisionInverse :: Mult (const BaseVector & x, BaseVector & y) const
+  {
+    static Timer t("MixedPrecisionInverse::Mult");
+    RegionTimer reg(t);
+
+    CGSolver<double> cg(mat, inv);
+    cg.SetPrecision (tol);
+    cg.SetMaxSteps (maxsteps);
+    cg.Mult (x, y);
+    steps = cg.GetSteps();
+  }
+
+  void MixedPrecisionInverse :: MultAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    auto hy = CreateColVector();
+    Mult (x, hy);
+    y += s * hy;
+  }
+
 }
 
 
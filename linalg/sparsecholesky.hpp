@@ -181,9 +181,9 @@ namespace ngla
     ///
     void Set (int i, int j, const TM & val);
     ///
-    const TM & Get (int i, int j) const;
+    virtual const TM & Get (int i, int j) const;
     ///
-    void SetOrig (int i, int j, const TM & val)
+    virtual void SetOrig (int i, int j, const TM & val)
     { Set (order[i], order[j], val); }
 
 
@@ -259,8 +259,91 @@ namespace ngla
 
     void SolveBlock (int i, FlatVector<TV> hy) const;
     void SolveBlockT (int i, FlatVector<TV> hy) const;
-  private:
-    void SolveReordered(FlatVector<TVX> hy) const;
+  protected:
+    virtual void SolveReordered(FlatVector<TVX> hy) const
+    { SolveReordered (hy, lfact.Data()); }
+    /// forward and backward substitution with the L-factor stored in plfact
+    template <typename TF>
+    void SolveReordered(FlatVector<TVX> hy, TF * plfact) const;
+  };
+
+
+
+  /**
+     Sparse Cholesky factorization of a real matrix, the L-factor is stored
+     in single precision. The factorization is computed in double precision, 
+     and then rounded, the substitutions read the float factor.
+     The stored factor and the solves use half the memory and bandwidth,
+     the peak memory of the factorization is 1.5 times the double factor.
+     Use it as preconditioner for the iterative refinement (MixedPrecisionInverse).
+  */
+  class NGS_DLL_HEADER SparseCholeskyFloat : public SparseCholesky<double>
+  {
+    typedef SparseCholesky<double> BASE;
+    /// the L-factor in single precision
+    Array<float> lfact_float;
+    /// the value returned by Get
+    mutable double get_val;
+
+    /// round the L-factor, and release the double precision factor
+    void RoundFactor ();
+  public:
+    SparseCholeskyFloat (const SparseMatrixTM<double> & a, 
+                         shared_ptr<BitArray> ainner = nullptr,
+                         shared_ptr<const Array<int>> acluster = nullptr);
+
+    virtual void Update() override;
+
+    virtual ostream & Print (ostream & ost) const override;
+    /// reads the float factor, the reference is valid until the next call
+    virtual const double & Get (int i, int j) const override;
+    /// only during the factorization, the double factor is released afterwards
+    virtual void SetOrig (int i, int j, const double & val) override;
+
+    virtual Array<MemoryUsage> GetMemoryUsage () const override
+    {
+      return { MemoryUsage ("SparseCholFloat", nze*sizeof(float), 1) };
+    }
+  protected:
+    virtual void SolveReordered(FlatVector<double> hy) const override
+    { BASE::SolveReordered (hy, lfact_float.Data()); }
+  };
+
+
+  /**
+     Mixed precision inverse by iterative refinement.
+     The residuals are computed with the double precision matrix,
+     the corrections by CG preconditioned with a low precision 
+     inverse (e.g. SparseCholeskyFloat).
+  */
+  class NGS_DLL_HEADER MixedPrecisionInverse : public BaseMatrix
+  {
+    shared_ptr<BaseMatrix> mat;
+    shared_ptr<BaseMatrix> inv;
+    double tol;
+    int maxsteps;
+    mutable int steps = 0;
+  public:
+    MixedPrecisionInverse (shared_ptr<BaseMatrix> amat, shared_ptr<BaseMatrix> ainv,
+                           double atol = 1e-12, int amaxsteps = 20)
+      : mat(amat), inv(ainv), tol(atol), maxsteps(amaxsteps) { ; }
+
+    /// refinement steps of the last solve
+    int GetSteps() const { return steps; }
+    shared_ptr<BaseMatrix> GetLowPrecisionInverse() const { return inv; }
+
+    virtual bool IsComplex() const override { return false; }
+    virtual int VHeight() const override { return mat->VWidth(); }
+    virtual int VWidth() const override { return mat->VHeight(); }
+    virtual AutoVector CreateRowVector () const override { return mat->CreateColVector(); }
+    virtual AutoVector CreateColVector () const override { return mat->CreateRowVector(); }
+
+    virtual void Update() override { inv->Update(); }
+
+    virtual void Mult (const BaseVector & x, BaseVector & y) const override;
+    virtual void MultAdd (double s, const BaseVector & x, BaseVector & y) const override;
+    virtual void MultTransAdd (double s, const BaseVector & x, BaseVector & y) const override
+    { MultAdd (s, x, y); }
   };
 
 
@@ -31,14 +31,6 @@ namespace ngla
   }
   
   
-  auto Split (size_t i, int bits)
-  {
-    auto hi = i >> bits;
-    auto lo = i & ((1 << bits) -1);
-    return make_pair(hi,lo);
-  }  
-  
-
   MatrixGraph :: MatrixGraph (const Array<int> & elsperrow, int awidth)
   {
     size = elsperrow.Size();
@@ -107,6 +99,7 @@ namespace ngla
       {
 	firsti.Swap (graph.firsti);
 	colnr.Swap (graph.colnr);
+        memory_holder = graph.memory_holder;
       }
     else
       {
@@ -123,6 +116,22 @@ namespace ngla
     CalcBalancing ();
   }
 
+  MatrixGraph :: MatrixGraph (int awidth, FlatArray<size_t> afirsti, FlatArray<int> acolnr,
+                              shared_ptr<void> amemory_holder)
+  {
+    size = afirsti.Size()-1;
+    width = awidth;
+    nze = afirsti[size];
+    if (acolnr.Size() < nze)
+      throw Exception ("MatrixGraph: colnr array too short");
+    owner = false;
+    memory_holder = amemory_holder;
+
+    firsti = Array<size_t> (afirsti.Size(), afirsti.Data());
+    static_cast<Array<int>&> (colnr) = Array<int> (nze, acolnr.Data());
+    CalcBalancing ();
+  }
+
   MatrixGraph :: MatrixGraph (MatrixGraph && graph)
   {
     if (!graph.owner) {
@@ -134,6 +143,7 @@ namespace ngla
     owner = true;
     firsti.Swap (graph.firsti);
     colnr.Swap (graph.colnr);
+    memory_holder = move(graph.memory_holder);
     CalcBalancing ();
   }
 
@@ -389,524 +399,204 @@ namespace ngla
                               const Table<int> & colelements, 
                               bool symmetric)
   {
-    // make sure that taskmanager is up ...
     /*
-    RunWithTaskManager 
-      ([&]() 
-       {
+      The (row,col) pairs of all elements are sorted by a two-digit
+      radix sort: a scatter into buckets of rows (high digit), and a
+      counting sort by the row within the bucket (low digit). Every task
+      writes into its own slots, no atomics and no locks are needed.
+      Duplicates are removed row by row, and the rows are copied into
+      the CSR arrays. Buckets are processed in waves to limit the
+      memory for the pairs.
     */
-
     static Timer timer("MatrixGraph");
-    static Timer timer_dof2el("MatrixGraph - build dof2el table");
+    static Timer timer_count("MatrixGraph - count");
+    static Timer timer_scatter("MatrixGraph - scatter");
+    static Timer timer_sort("MatrixGraph - sort rows");
     static Timer timer_prefix("MatrixGraph - prefix");    
+    static Timer timer_copy("MatrixGraph - copy");
     RegionTimer reg (timer);
 
-    bool includediag = (&rowelements == &colelements);
-     
-    int ndof = asize;
-    TableCreator<int> creator(ndof);
+    bool includediag = symmetric && (&rowelements == &colelements);
 
+    size = asize;
+    width = awidth;
+    owner = true;
 
     ParallelFor (Range(colelements.Size()), 
                  [&] (int i) { QuickSort (colelements[i]); });
-    
-    timer_dof2el.Start();
-    for ( ; !creator.Done(); creator++)
-      {    
-        ParallelFor (Range(rowelements.Size()),
-                     [&] (int i)
-                     {
-                       for (auto e : rowelements[i])
-                         creator.Add(e, i);
-                     },
-                     TasksPerThread(10));
-      }
-    timer_dof2el.Stop();
-
-    Table<int> dof2element = creator.MoveTable();
 
-    // #define NEWDOF2EL
-#ifdef NEWDOF2EL
-    {
-    static Timer timer_newdof2el("MatrixGraph - new build dof2el table");
-    static Timer timer_newdof2elb("MatrixGraph - new build dof2el table b");
-    static Timer timer_newdof2el_1("MatrixGraph - new build dof2el table 1");
-    static Timer timer_newdof2el_2("MatrixGraph - new build dof2el table 2");
+    size_t nel = rowelements.Size();
+    int nthreads = TaskManager::GetNumThreads();
+    int shift = max2 (0, UsedBits (size) - UsedBits (32*nthreads));
+    size_t nbuckets = (size_t(size) + (size_t(1) << shift) - 1) >> shift;
+    size_t nchunks = min2 (nel, size_t(4*nthreads));
 
-            
-    // atomic-free dof2element via COO format
-    timer_newdof2elb.Start();
-    int rowbits = UsedBits (rowelements.Size());
-    int rowbits_hi = rowbits / 2;
-    int rowbits_lo = rowbits - rowbits_hi;
-    int rows_hi = 1 << rowbits_hi;
-    int rows_lo = 1 << rowbits_lo;
-    int nrows_hi = (rowelements.Size()+rows_lo-1) / rows_lo;
-    
-    int dofbits = UsedBits (ndof);
-    int dofbits_hi = dofbits/2;
-    int dofbits_lo = dofbits - dofbits_hi;
-    int dofs_hi = 1 << dofbits_hi;
-    int dofs_lo = 1 << dofbits_lo;    
-    int ndofs_hi = (ndof+dofs_lo-1)/dofs_lo;
-
-    { // build a global table
-      Array<int> cnt_coo(nrows_hi*ndofs_hi);
-      // ParallelFor (nrows_hi, [&] (int row_hi)
-      ParallelJob ([&] (TaskInfo &ti)
-                   {
-		     int row_hi = ti.task_nr;
-                     auto mycnt = cnt_coo.Range(row_hi*ndofs_hi, (row_hi+1)*ndofs_hi);
-                     mycnt = 0;
-                     for (int row_lo = 0; row_lo < rows_lo; row_lo++)
-                       {
-                         int row = (row_hi << rowbits_lo)+row_lo;
-                         if (row < rowelements.Size())
-                           {
-                             for (auto d : rowelements[row])
-                               {
-                                 int dof_hi, dof_lo;
-                                 tie(dof_hi, dof_lo) = Split (d, dofbits_lo);
-                                 mycnt[dof_hi]++;
-                               }
-                           }
-                       }
-		     // }, TasksPerThread(4));
-		   }, nrows_hi);
-      Table<int> dof2element_coo(cnt_coo);
+    auto bucket_rows = [&] (size_t b)
+      { return IntRange (b << shift, min2 (size_t(size), (b+1) << shift)); };
 
-      /*
-      ParallelJob ([&] (TaskInfo &ti)
-                   {
-		     int row_hi = ti.task_nr;
-		     auto mytable = dof2element_coo.Range(row_hi*ndofs_hi, (row_hi+1)*ndofs_hi);
-		     mytable.AsArray() = 0;
-		     // for (auto i = row_hi*ndofs_hi; i < (row_hi+1)*ndofs_hi; i++)
-		     // dof2element_coo[i] = 0;
-		   }, nrows_hi);
-      */
-      /*
-      ParallelForRange (dof2element_coo.Size(), [&] (IntRange r)
-			{
-			  dof2element_coo.Range(r).AsArray() = 0;
-			}, 1+0.3*TaskManager::GetNumThreads());
-      */
-      // ParallelFor (nrows_hi, [&] (int row_hi)
-      ParallelJob ([&] (TaskInfo &ti)
-                   {
-		     int row_hi = ti.task_nr;
-                     auto mycnt = cnt_coo.Range(row_hi*ndofs_hi, (row_hi+1)*ndofs_hi);
-                     auto mytable = dof2element_coo.Range(row_hi*ndofs_hi, (row_hi+1)*ndofs_hi);
-                     mycnt = 0;
-                     for (int row_lo = 0; row_lo < rows_lo; row_lo++)
-                       {
-                         int row = (row_hi << rowbits_lo)+row_lo;
-                         if (row < rowelements.Size())
-                           {
-                             for (auto d : rowelements[row])
-                               {
-                                 int dof_hi, dof_lo;
-                                 tie(dof_hi, dof_lo) = Split (d, dofbits_lo);
-                                 mytable[dof_hi][mycnt[dof_hi]++] = row_lo*dofs_lo+dof_lo;
-                               }
-                           }
-                       }
-		   }, nrows_hi);
-      // }, TasksPerThread(4));
-
-
-    Array<int> newcnt(ndof);
-    // ParallelFor(ndofs_hi, [&] (int dof_hi)
-    ParallelJob ([&] (TaskInfo &ti)
-		 {
-		   int dof_hi = ti.task_nr;
-                  auto first = dof_hi << dofbits_lo;
-                  if (first >= ndof) return;
-                  auto next = min ( (dof_hi+1) << dofbits_lo, ndof);
-                  newcnt.Range(first, next) = 0;
-                  
-                  // for (int row_hi = 0; row_hi < rows_hi; row_hi++)
-                  for (int row_hi : Range(nrows_hi))
-                    for (auto p : dof2element_coo[dof_hi+row_hi*ndofs_hi])
-                      {
-                        int dof_lo, row_lo;
-                        tie(row_lo, dof_lo) = Split (p, dofbits_lo);
-                        int dof = (dof_hi << dofbits_lo) + dof_lo;
-                        newcnt[dof]++;
-                      }
-		 }, ndofs_hi);
-		  // }, TasksPerThread(4));
-    
-    Table<int> newdof2element(newcnt);
-    // ParallelFor (ndofs_hi, [&] (int dof_hi)
-    ParallelJob ([&] (TaskInfo &ti)
+    // columns of element i in row r
+    auto numcols = [&] (size_t i, int r) -> size_t
+      {
+        auto cols = colelements[i];
+        if (!symmetric) return cols.Size();
+        return upper_bound (cols.Data(), cols.Data()+cols.Size(), r) - cols.Data();
+      };
+
+    // pairs per chunk of elements and bucket
+    timer_count.Start();
+    Array<size_t> pos(nchunks*nbuckets);
+    ParallelFor (Range(nchunks), [&] (size_t c)
                  {
-		   int dof_hi = ti.task_nr;
-                   auto first = dof_hi << dofbits_lo;
-                   if (first >= ndof) return;
-                   auto next = min ( (dof_hi+1) << dofbits_lo, ndof);
-                   newcnt.Range(first, next) = 0;
-                   
-                   // for (int row_hi = 0; row_hi < rows_hi; row_hi++)
-                   for (int row_hi : Range(nrows_hi))
-                     for (auto p : dof2element_coo[dof_hi+row_hi*ndofs_hi])                     
-                       {
-                         int dof_lo, row_lo;
-                         tie(row_lo, dof_lo) = Split (p, dofbits_lo);
-                         int dof = (dof_hi << dofbits_lo) + dof_lo;
-                         newdof2element[dof][newcnt[dof]++] = row_hi*rows_lo+row_lo;
-                       }
-		 }, ndofs_hi);
-    // }, TasksPerThread(4));
-    timer_newdof2elb.Stop();
+                   auto mycnt = pos.Range(c*nbuckets, (c+1)*nbuckets);
+                   mycnt = 0;
+                   for (size_t i : Range(nel).Split(c, nchunks))
+                     for (int r : rowelements[i])
+                       mycnt[r >> shift] += numcols(i, r);
+                 });
 
-    if (dof2element.Size() < 100)
+    // pairs are ordered by bucket, then by chunk
+    Array<size_t> bucketfirst(nbuckets+1);
+    size_t npairs = 0;
+    for (size_t b = 0; b < nbuckets; b++)
       {
-        cout << "dof2el = " << dof2element << endl;
-        cout << "newdof2el = " << newdof2element << endl;
+        bucketfirst[b] = npairs;
+        for (size_t c = 0; c < nchunks; c++)
+          {
+            size_t cnt = pos[c*nbuckets+b];
+            pos[c*nbuckets+b] = npairs;
+            npairs += cnt;
+          }
       }
-    }
-    
-    timer_newdof2el.Start();
-    
-    Array<Table<int>> entries(nrows_hi);
-    ParallelFor (nrows_hi, [&] (int row_hi)
-                 {
-                   Array<int> cnt_entries(ndofs_hi);
-                   {
-                   RegionTracer reg(TaskManager::GetThreadId(), timer_newdof2el_1);
-                   cnt_entries = 0;
-                   
-                   for (int row_lo = 0; row_lo < rows_lo; row_lo++)
-                     {
-                       int row = (row_hi << rowbits_lo)+row_lo;
-                       if (row < rowelements.Size())
-                         {
-                           for (auto d : rowelements[row])
-                             {
-                               int dof_hi, dof_lo;
-                               tie(dof_hi, dof_lo) = Split (d, dofbits_lo);
-                               cnt_entries[dof_hi]++;
-                             }
-                         }
-                     }
-                   }
-                   Table<int> loctable(cnt_entries);
-                   cnt_entries = 0;
+    bucketfirst[nbuckets] = npairs;
+    timer_count.Stop();
 
-                   {
-                   RegionTracer reg(TaskManager::GetThreadId(), timer_newdof2el_2);
-                   for (int row_lo = 0; row_lo < rows_lo; row_lo++)
+    constexpr size_t maxwave = size_t(1) << 26;
+    Array<uint64_t> pairs;
+    Array<Array<int>> bucketcols(nbuckets);
+    Array<int> cnt(size);
+
+    for (size_t b0 = 0, b1; b0 < nbuckets; b0 = b1)
+      {
+        b1 = b0+1;
+        while (b1 < nbuckets && bucketfirst[b1+1]-bucketfirst[b0] <= maxwave)
+          b1++;
+
+        size_t base = bucketfirst[b0];
+        pairs.SetSize0();
+        pairs.SetSize (bucketfirst[b1]-base);
+        int rowfirst = bucket_rows(b0).First();
+        int rownext = bucket_rows(b1-1).Next();
+
+        // radix scatter by the bucket, the low row bits are kept in the key
+        timer_scatter.Start();
+        ParallelFor (Range(nchunks), [&] (size_t c)
                      {
-                       int row = (row_hi << rowbits_lo)+row_lo;
-                       if (row < rowelements.Size())
+                       auto mypos = pos.Range(c*nbuckets, (c+1)*nbuckets);
+                       for (size_t i : Range(nel).Split(c, nchunks))
                          {
-                           for (auto d : rowelements[row])
+                           auto cols = colelements[i];
+                           for (int r : rowelements[i])
                              {
-                               int dof_hi, dof_lo;
-                               tie(dof_hi, dof_lo) = Split (d, dofbits_lo);
-                               loctable[dof_hi][cnt_entries[dof_hi]++] = row_lo*dofs_lo+dof_lo;
+                               if (r < rowfirst || r >= rownext) continue;
+                               size_t & p = mypos[r >> shift];
+                               uint64_t hi = uint64_t(r & ((size_t(1) << shift)-1)) << 32;
+                               for (int col : cols.Range(0, numcols(i, r)))
+                                 pairs[p++ - base] = hi | uint32_t(col);
                              }
                          }
-                     }
-                   }
-                   entries[row_hi] = move(loctable);
-                 },
-                 TasksPerThread(4));
-    
-    
-    Array<int> newcnt(ndof);
-    ParallelFor(ndofs_hi, [&] (int dof_hi)
-                {
-                  auto first = dof_hi << dofbits_lo;
-                  if (first >= ndof) return;
-                  auto next = min ( (dof_hi+1) << dofbits_lo, ndof);
-                  newcnt.Range(first, next) = 0;
-                  
-                  // for (int row_hi = 0; row_hi < rows_hi; row_hi++)
-                  for (int row_hi : Range(entries))
-                    for (auto p : entries[row_hi][dof_hi])
-                      {
-                        int dof_lo, row_lo;
-                        tie(row_lo, dof_lo) = Split (p, dofbits_lo);
-                        int dof = (dof_hi << dofbits_lo) + dof_lo;
-                        newcnt[dof]++;
-                      }
-                }, TasksPerThread(4));
-    
-    Table<int> newdof2element(newcnt);
-    ParallelFor (ndofs_hi, [&] (int dof_hi)
-                 {
-                   auto first = dof_hi << dofbits_lo;
-                   if (first >= ndof) return;
-                   auto next = min ( (dof_hi+1) << dofbits_lo, ndof);
-                   newcnt.Range(first, next) = 0;
-                   
-                   // for (int row_hi = 0; row_hi < rows_hi; row_hi++)
-                   for (int row_hi : Range(entries))                     
-                     for (auto p : entries[row_hi][dof_hi])                         
-                       {
-                         int dof_lo, row_lo;
-                         tie(row_lo, dof_lo) = Split (p, dofbits_lo);
-                         int dof = (dof_hi << dofbits_lo) + dof_lo;
-                         newdof2element[dof][newcnt[dof]++] = row_hi*rows_lo+row_lo;
-                       }
-                 }, TasksPerThread(4));
-    timer_newdof2el.Stop();    
+                     });
+        timer_scatter.Stop();
 
-    if (dof2element.Size() < 100)
-      {
-        cout << "dof2el = " << dof2element << endl;
-        cout << "newdof2el = " << newdof2element << endl;
-      }
-
-    // delete table-memory on same thread as it was created
-    ParallelFor (nrows_hi, [&] (int row_hi)
-                 { 
-                   entries[row_hi] = Table<int>();
-                 });
-    
-
-    // just for testing: with numa local array:
-    ParallelFor (nrows_hi, [&] (int row_hi)
-                 {
-                   Array<int> cnt_entries(ndofs_hi);
-                   cnt_entries = 0;
-                   
-                   for (int row_lo = 0; row_lo < rows_lo; row_lo++)
+        // counting sort by the row, sort and compress every row
+        timer_sort.Start();
+        ParallelFor (Range(b0, b1), [&] (size_t b)
                      {
-                       int row = (row_hi << rowbits_lo)+row_lo;
-                       if (row < rowelements.Size())
+                       IntRange rows = bucket_rows(b);
+                       auto mypairs = pairs.Range(bucketfirst[b]-base, bucketfirst[b+1]-base);
+                       int diag = includediag ? 1 : 0;
+
+                       Array<size_t> first(rows.Size()+1);
+                       first = diag;
+                       first[0] = 0;
+                       for (uint64_t p : mypairs)
+                         first[(p >> 32)+1]++;
+                       for (size_t k = 0; k < rows.Size(); k++)
+                         first[k+1] += first[k];
+
+                       Array<int> tmp(first.Last());
+                       Array<size_t> fill(rows.Size());
+                       for (size_t k = 0; k < rows.Size(); k++)
                          {
-                           for (auto d : rowelements[row])
-                             {
-                               int dof_hi, dof_lo;
-                               tie(dof_hi, dof_lo) = Split (d, dofbits_lo);
-                               cnt_entries[dof_hi]++;
-                             }
+                           fill[k] = first[k];
+                           if (diag) tmp[fill[k]++] = rows.First()+k;
                          }
-                     }
-                 });
+                       for (uint64_t p : mypairs)
+                         tmp[fill[p >> 32]++] = int(uint32_t(p));
 
-    ParallelFor (nrows_hi, [&] (int row_hi)
-                 {
-                   NumaLocalArray<int> cnt_entries(ndofs_hi);
-                   cnt_entries = 0;
-                   
-                   for (int row_lo = 0; row_lo < rows_lo; row_lo++)
-                     {
-                       int row = (row_hi << rowbits_lo)+row_lo;
-                       if (row < rowelements.Size())
+                       size_t w = 0;
+                       for (size_t k = 0; k < rows.Size(); k++)
                          {
-                           for (auto d : rowelements[row])
+                           FlatArray<int> row = tmp.Range(first[k], first[k+1]);
+                           QuickSort (row);
+                           size_t start = w;
+                           for (size_t j = 0; j < row.Size(); j++)
                              {
-                               int dof_hi, dof_lo;
-                               tie(dof_hi, dof_lo) = Split (d, dofbits_lo);
-                               cnt_entries[dof_hi]++;
+                               int col = row[j];
+                               if (w == start || tmp[w-1] != col)
+                                 tmp[w++] = col;
                              }
+                           cnt[rows.First()+k] = w-start;
                          }
-                     }
-                 });
-                 
-    }
-
-    
-#endif
-    
-    Array<int> cnt(ndof);
-    // cnt = 0;
-    ParallelJob ([&] (TaskInfo ti)
-                 {
-                   auto r = Range(ndof).Split(ti.task_nr, ti.ntasks);
-                   cnt[r] = 0;
-                 });
-
-    /*
-    class ProfileData
-    {
-    public:
-      double tstart, tend;
-      int size;
-    };
-    Array<ProfileData> prof(ndof);
-    */
+                       tmp.SetSize(w);
+                       bucketcols[b] = move(tmp);
+                     });
+        timer_sort.Stop();
+      }
+    pairs = Array<uint64_t>();
     
+    timer_prefix.Start();
+    firsti.SetSize (size+1);
+    Array<size_t> partial_sums(TaskManager::GetNumThreads()+1);
+    partial_sums[0] = 0;
+    ParallelJob
+      ([&] (TaskInfo ti)
+       {
+         IntRange r = IntRange(size).Split(ti.task_nr, ti.ntasks);
+         size_t mysum = 0;
+         for (size_t i : r)
+           mysum += cnt[i];
+         partial_sums[ti.task_nr+1] = mysum;
+       });
 
+    for (size_t i = 1; i < partial_sums.Size(); i++)
+      partial_sums[i] += partial_sums[i-1];
 
-    for (int loop = 1; loop <= 2; loop++)
-      {
-        if (!symmetric)
-          {
-            ParallelForRange 
-              (Range(ndof), [&](IntRange myr) 
-               {
-                 ArrayMem<int, 50> sizes;
-                 ArrayMem<int*, 50> ptrs;
-
-                 for (int i : myr)
-                   {
-                     sizes.SetSize(dof2element[i].Size());
-                     ptrs.SetSize(dof2element[i].Size());
-
-                     for (int j : dof2element[i].Range())
-                       {
-                         sizes[j] = colelements[dof2element[i][j]].Size();
-                         ptrs[j] = colelements[dof2element[i][j]].Addr(0);
-                       }
-                     
-                     if (loop == 1)
-                       {
-                         int cnti = 0;
-                         MergeArrays(ptrs, sizes, [&cnti] (int col) { cnti++; } );
-                         cnt[i] = cnti;
-                       }
-                     else
-                       {
-                         auto ptr = colnr.Data()+firsti[i];
-                         MergeArrays(ptrs, sizes, [&ptr] (int col) 
-                                     {
-                                       *ptr = col;
-                                       ptr++;
-                                     } );
-                       }
-                   }
-               },
-               TasksPerThread(20));
-            // 20 * task_manager->GetNumThreads());
-          }
-        else
-          {
-            ParallelForRange 
-              (Range(ndof),[&](IntRange myr)
-               {
-                 Array<int> rowdofs;
-                 Array<int> rowdofs1;
-                 
-                 // for (int i : sl)
-                 for (int i : myr)
-                   {
-                     rowdofs.SetSize0();
-                     if (includediag) rowdofs += i;
-                     
-                     for (auto elnr : dof2element[i])
-                       {
-                         rowdofs.Swap (rowdofs1);
-                         auto row = colelements[elnr];
-                         
-                         rowdofs.SetSize(rowdofs1.Size()+row.Size());
-                         
-                         int i1 = 0, i2 = 0, i3 = 0;
-                         while (i1 < rowdofs1.Size() && i2 < row.Size() && row[i2] <= i)
-                           {
-                             int newel;
-                             if (rowdofs1[i1] == row[i2])
-                               {
-                                 newel = rowdofs1[i1++]; i2++;
-                               }
-                             else if (rowdofs1[i1] < row[i2])
-                               newel = rowdofs1[i1++];
-                             else
-                               newel = row[i2++];
-                             rowdofs[i3++] = newel; 
-                           }
-                         
-                         while (i1 < rowdofs1.Size())
-                           rowdofs[i3++] = rowdofs1[i1++];
-                         while (i2 < row.Size() && row[i2] <= i)
-                           rowdofs[i3++] = row[i2++];
-                         
-                         rowdofs.SetSize(i3);
-                       }
-                  
-                  
-                     if (loop == 1)
-                       cnt[i] = rowdofs.Size();
-                     else
-                       colnr.Range(firsti[i], firsti[i+1]) = rowdofs;
-                   }
-               }, TasksPerThread(5));
-            
-          }
-        
-        
-        if (loop == 1)
-          {
-            size = ndof;
-            width = awidth;
-            owner = true;
-            
-            firsti.SetSize (size+1);
-            /*
-            nze = 0;
-            for (int i = 0; i < size; i++)
-              {
-                firsti[i] = nze;
-                nze += cnt[i];
-              }
-            firsti[size] = nze;
-            */
-            
-            timer_prefix.Start();
-            Array<size_t> partial_sums(TaskManager::GetNumThreads()+1);
-            partial_sums[0] = 0;
-            ParallelJob
-              ([&] (TaskInfo ti)
-               {
-                 IntRange r = IntRange(size).Split(ti.task_nr, ti.ntasks);
-                 size_t mysum = 0;
-                 for (size_t i : r)
-                   mysum += cnt[i];
-                 partial_sums[ti.task_nr+1] = mysum;
-               });
-
-            for (size_t i = 1; i < partial_sums.Size(); i++)
-              partial_sums[i] += partial_sums[i-1];
-
-            ParallelJob
-              ([&] (TaskInfo ti)
-               {
-                 IntRange r = IntRange(size).Split(ti.task_nr, ti.ntasks);
-                 size_t mysum = partial_sums[ti.task_nr];
-                 for (size_t i : r)
-                   {
-                     firsti[i] = mysum;
-                     mysum += cnt[i];
-                   }
-               });
-            nze = partial_sums[partial_sums.Size()-1];
-            firsti[size] = nze;
-            timer_prefix.Stop();
+    ParallelJob
+      ([&] (TaskInfo ti)
+       {
+         IntRange r = IntRange(size).Split(ti.task_nr, ti.ntasks);
+         size_t mysum = partial_sums[ti.task_nr];
+         for (size_t i : r)
+           {
+             firsti[i] = mysum;
+             mysum += cnt[i];
+           }
+       });
+    nze = partial_sums[partial_sums.Size()-1];
+    firsti[size] = nze;
+    timer_prefix.Stop();
             
-            colnr = NumaDistributedArray<int> (nze);  // nze+1
-
-	    CalcBalancing ();
+    colnr = NumaDistributedArray<int> (nze);
+    CalcBalancing ();
 
-            // first touch memory (numa!)
-            ParallelFor (balance, [&](int row) 
-                         {
-                           colnr.Range(firsti[row], firsti[row+1]) = 0;
-                         });
-          }
-        else
-          {
-            ;
-          }
-      }
-    /*
-    ofstream out("creategraph.out");
-    double sumtime = 0;
-    for (int i = 0; i < prof.Size(); i++)
-      {
-        out << i << " " << prof[i].size << " ";
-        double t = (prof[i].tend-prof[i].tstart) * 1e6;
-        if (t > 100) out << "           ";
-        out << t << endl;
-        sumtime += t;
-      }
-    cout << "sum time = " << sumtime << endl;
-    cout << "sum time per thread = " << sumtime/48 << endl;
-    */
-    // });
+    timer_copy.Start();
+    ParallelFor (Range(nbuckets), [&] (size_t b)
+                 {
+                   IntRange rows = bucket_rows(b);
+                   colnr.Range(firsti[rows.First()], firsti[rows.Next()]) = bucketcols[b];
+                   bucketcols[b] = Array<int>();
+                 });
+    timer_copy.Stop();
   }
 
   
@@ -1200,6 +890,7 @@ namespace ngla
     RegionTimer reg (timer);
 
     balance.Calc (size, [&] (int row) { return 1 + GetRowIndices(row).Size(); });
+    vecbalance = make_shared<Partitioning> (balance);
   }
   
   void MatrixGraph :: FindSameNZE()
@@ -1255,6 +946,20 @@ namespace ngla
     ;
   }
 
+  void BaseSparseMatrix ::
+  MultAddMasked (double s, const BaseVector & x, BaseVector & y,
+                 shared_ptr<BitArray> rowmask, bool rowkeep,
+                 shared_ptr<BitArray> colmask, bool colkeep) const
+  {
+    auto hx = CreateRowVector();
+    auto hy = CreateColVector();
+    *hx = x;
+    if (colmask) Projector(colmask, colkeep).Project(*hx);
+    Mult (*hx, *hy);
+    if (rowmask) Projector(rowmask, rowkeep).Project(*hy);
+    y.Add (s, *hy);
+  }
+
   INVERSETYPE BaseSparseMatrix ::
   SetInverseType (string ainversetype) const
   {
@@ -1268,10 +973,11 @@ namespace ngla
     else if (ainversetype == "masterinverse") SetInverseType ( MASTERINVERSE );
     else if (ainversetype == "sparsecholesky") SetInverseType ( SPARSECHOLESKY );
     else if (ainversetype == "umfpack")       SetInverseType ( UMFPACK );
+    else if (ainversetype == "sparsecholesky_mixed") SetInverseType ( SPARSECHOLESKY_MIXED );
     else
       {
         throw Exception (ToString("undefined inverse ")+ainversetype+
-                         "\nallowed is: 'sparsecholesky', 'pardiso', 'pardisospd', 'mumps', 'masterinverse', 'umfpack'");
+                         "\nallowed is: 'sparsecholesky', 'sparsecholesky_mixed', 'pardiso', 'pardisospd', 'mumps', 'masterinverse', 'umfpack'");
       }
     return old_invtype;
   }
@@ -1290,50 +996,6 @@ namespace ngla
   TransposeMatrix (const SparseMatrixTM<double> & mat)
   {
     return dynamic_pointer_cast<SparseMatrixTM<double>> (mat.CreateTranspose());
-    /*
-    static Timer t1("TransposeMatrix 1");
-    static Timer t2("TransposeMatrix 2");
-    t1.Start();
-    Array<int> cnt(mat.Width());
-    cnt = 0;
-    ParallelFor (mat.Height(), [&] (int i)
-                 {
-                   for (int c : mat.GetRowIndices(i))
-                     AsAtomic (cnt[c]) ++;
-                 });
-    t1.Stop();
-    t2.Start();
-
-    shared_ptr<SparseMatrixTM<double>> trans;
-    if (dynamic_cast<const SparseMatrix<double,double,double>*>(&mat))
-      trans = make_shared<SparseMatrix<double>>(cnt, mat.Height());
-    else if (dynamic_cast<const SparseMatrix<double,Complex,Complex>*>(&mat))
-      trans = make_shared<SparseMatrix<double,Complex,Complex>>(cnt, mat.Height());
-    else
-      throw Exception(string("SparseMatrix-Transpose, not available for type")+typeid(mat).name()); 
-
-    cnt = 0;
-    ParallelFor (mat.Height(), [&] (int i)
-                 {
-                   for (int ci : Range(mat.GetRowIndices(i)))
-                     {
-                       int c = mat.GetRowIndices(i)[ci];
-                       int pos = AsAtomic(cnt[c])++;
-                       trans -> GetRowIndices(c)[pos] = i;
-                       trans -> GetRowValues(c)[pos] = mat.GetRowValues(i)[ci];
-                     }
-                 });
-
-    ParallelFor (trans->Height(), [&] (int r)
-                 {
-                   auto rowvals = trans->GetRowValues(r);
-                   BubbleSort (trans->GetRowIndices(r),
-                               FlatArray<double> (rowvals.Size(), rowvals.Data()));
-                 });
-
-    t2.Stop();
-    return trans;
-    */
   }
   // #endif
   
@@ -1558,6 +1220,150 @@ namespace ngla
     return MatMult<double, double, double>(mata, matb);
   }
 
+
+
+  // row of a real matrix times a complex vector, entries of x are (re,im) pairs
+  INLINE SIMD<double,2> RealRowTimesComplex (size_t first, size_t last, const int * cols,
+                                             const double * vals, const double * px)
+  {
+    SIMD<double,2> sum0(0.0), sum1(0.0);
+    size_t j = first;
+    for ( ; j+2 <= last; j += 2)
+      {
+        sum0 += SIMD<double,2>(vals[j]) * SIMD<double,2>(px+2*size_t(cols[j]));
+        sum1 += SIMD<double,2>(vals[j+1]) * SIMD<double,2>(px+2*size_t(cols[j+1]));
+      }
+    if (j < last)
+      sum0 += SIMD<double,2>(vals[j]) * SIMD<double,2>(px+2*size_t(cols[j]));
+    return sum0 + sum1;
+  }
+
+  // the same row of two real matrices on one graph
+  INLINE void PairedRowTimesComplex (size_t first, size_t last, const int * cols,
+                                     const double * kvals, const double * mvals, const double * px,
+                                     SIMD<double,2> & sumk, SIMD<double,2> & summ)
+  {
+    SIMD<double,2> hk(0.0), hm(0.0);
+    for (size_t j = first; j < last; j++)
+      {
+        SIMD<double,2> xj(px+2*size_t(cols[j]));
+        hk += SIMD<double,2>(kvals[j]) * xj;
+        hm += SIMD<double,2>(mvals[j]) * xj;
+      }
+    sumk = hk;
+    summ = hm;
+  }
+
+  template<>
+  void SparseMatrix<double,Complex,Complex> ::
+  MultAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    MultAdd (Complex(s), x, y);
+  }
+
+  template<>
+  void SparseMatrix<double,Complex,Complex> ::
+  MultAdd (Complex s, const BaseVector & x, BaseVector & y) const
+  {
+    static Timer t("SparseMatrix<double,Complex>::MultAdd"); RegionTimer reg(t);
+    t.AddFlops (2*this->NZE());
+
+    FlatVector<Complex> fx = x.FV<Complex>();
+    FlatVector<Complex> fy = y.FV<Complex>();
+    const double * px = reinterpret_cast<const double*> (fx.Data());
+    const int * cols = colnr.Data();
+    const double * vals = data.Data();
+
+    ParallelForRange
+      (balance, [&] (IntRange myrange)
+       {
+         for (auto i : myrange)
+           {
+             SIMD<double,2> sum = RealRowTimesComplex (firsti[i], firsti[i+1], cols, vals, px);
+             fy(i) += s * Complex(sum[0], sum[1]);
+           }
+       });
+  }
+
+
+  PairedSparseMatrix ::
+  PairedSparseMatrix (shared_ptr<SparseMatrix<double>> ak,
+                      shared_ptr<SparseMatrix<double>> am, Complex az)
+    : k(ak), m(am), z(az)
+  {
+    if (k->Height() != m->Height() || k->Width() != m->Width())
+      throw Exception ("PairedSparseMatrix: matrices have different dimensions");
+    if (dynamic_pointer_cast<SparseMatrixSymmetric<double>> (k) ||
+        dynamic_pointer_cast<SparseMatrixSymmetric<double>> (m))
+      throw Exception ("PairedSparseMatrix: needs matrices with non-symmetric storage");
+
+    // shared graphs have the same arrays, otherwise compare once
+    auto firstk = k->GetFirstArray(), firstm = m->GetFirstArray();
+    auto colk = k->GetColIndices(), colm = m->GetColIndices();
+    samegraph = colk.Size() == colm.Size();
+    if (samegraph && (firstk.Data() != firstm.Data() || colk.Data() != colm.Data()))
+      {
+        for (size_t i = 0; i < firstk.Size() && samegraph; i++)
+          if (firstk[i] != firstm[i]) samegraph = false;
+        for (size_t i = 0; i < colk.Size() && samegraph; i++)
+          if (colk[i] != colm[i]) samegraph = false;
+      }
+  }
+
+  AutoVector PairedSparseMatrix :: CreateRowVector () const
+  {
+    return CreateBaseVector (VWidth(), true, 1);
+  }
+
+  AutoVector PairedSparseMatrix :: CreateColVector () const
+  {
+    return CreateBaseVector (VHeight(), true, 1);
+  }
+
+  void PairedSparseMatrix :: Mult (const BaseVector & x, BaseVector & y) const
+  {
+    y = 0.0;
+    MultAdd (Complex(1.0), x, y);
+  }
+
+  void PairedSparseMatrix :: MultAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    MultAdd (Complex(s), x, y);
+  }
+
+  void PairedSparseMatrix :: MultAdd (Complex s, const BaseVector & x, BaseVector & y) const
+  {
+    static Timer t("PairedSparseMatrix::MultAdd"); RegionTimer reg(t);
+    t.AddFlops (4*k->NZE());
+
+    FlatVector<Complex> fx = x.FV<Complex>();
+    FlatVector<Complex> fy = y.FV<Complex>();
+    const double * px = reinterpret_cast<const double*> (fx.Data());
+    auto firstk = k->GetFirstArray(), firstm = m->GetFirstArray();
+    const int * colk = k->GetColIndices().Data();
+    const int * colm = m->GetColIndices().Data();
+    const double * valk = k->GetValues().Data();
+    const double * valm = m->GetValues().Data();
+    Complex hz = z;
+
+    ParallelForRange
+      (k->GetBalancing(), [&] (IntRange myrange)
+       {
+         for (auto i : myrange)
+           {
+             SIMD<double,2> sumk, summ;
+             if (samegraph)
+               PairedRowTimesComplex (firstk[i], firstk[i+1], colk, valk, valm, px, sumk, summ);
+             else
+               {
+                 sumk = RealRowTimesComplex (firstk[i], firstk[i+1], colk, valk, px);
+                 summ = RealRowTimesComplex (firstm[i], firstm[i+1], colm, valm, px);
+               }
+             fy(i) += s * (Complex(sumk[0], sumk[1]) + hz * Complex(summ[0], summ[1]));
+           }
+       });
+  }
+
   template <class TM, class TV>
   shared_ptr<BaseSparseMatrix>
   SparseMatrixSymmetric<TM,TV> :: Restrict (const SparseMatrixTM<double> & prol,
@@ -1702,12 +1508,10 @@ namespace ngla
     static Timer t ("sparsematrix - restrict");
     RegionTimer reg(t);
 
-    // auto prolT = TransposeMatrix(prol);
-    auto prolT = dynamic_pointer_cast<SparseMatrixTM<double>> (prol.CreateTranspose());
-
-    auto prod1 = MatMult<double, double, double>(*this, prol);
-    auto prod = MatMult<double, double, double>(*prolT, *prod1);
-    return prod;
+    return GalerkinProduct<double>
+      (*this, prol, false, nullptr,
+       [] (const Array<int> & cnt, int width) -> shared_ptr<SparseMatrixTM<double>>
+       { return make_shared<SparseMatrix<double>> (cnt, width); });
   }
 
   template <> shared_ptr<BaseSparseMatrix>
@@ -1716,13 +1520,11 @@ namespace ngla
   {
     static Timer t ("sparsematrix - restrict");
     RegionTimer reg(t);
-    // new version
-    // auto prolT = TransposeMatrix(prol);
-    auto prolT = dynamic_pointer_cast<SparseMatrixTM<double>> (prol.CreateTranspose());
-    
-    auto prod1 = MatMult<std::complex<double>, std::complex<double>, double>(*this, prol);
-    auto prod = MatMult<std::complex<double>, double, std::complex<double>>(*prolT, *prod1);
-    return prod;
+
+    return GalerkinProduct<Complex>
+      (*this, prol, false, nullptr,
+       [] (const Array<int> & cnt, int width) -> shared_ptr<SparseMatrixTM<Complex>>
+       { return make_shared<SparseMatrix<Complex>> (cnt, width); });
   }
 
 
@@ -1735,16 +1537,13 @@ namespace ngla
   {
     static Timer t ("sparsematrixsymmetric - restrict");
     RegionTimer reg(t);
-    // new version
-    // auto prolT = TransposeMatrix(prol);
-    auto prolT = dynamic_pointer_cast<SparseMatrixTM<double>> (prol.CreateTranspose());    
+    // full rows of A, only the lower triangle of P^T A P is computed
     auto full = MakeFullMatrix(*this);
 
-    auto prod1 = MatMult<double, double, double>(*full, prol);
-    auto prod = MatMult<double, double, double>(*prolT, *prod1);
-
-    auto prodhalf = GetSymmetricMatrix (*prod);
-    return prodhalf;
+    return GalerkinProduct<double>
+      (*full, prol, true, nullptr,
+       [] (const Array<int> & cnt, int width) -> shared_ptr<SparseMatrixTM<double>>
+       { return make_shared<SparseMatrixSymmetric<double>> (cnt); });
 
 
 #ifdef OLD
@@ -1941,6 +1740,16 @@ namespace ngla
 	throw Exception ("SparseMatrix::InverseMatrix:  MumpsInverse not available");
 #endif
       }
+    else if ( BaseSparseMatrix :: GetInverseType()  == SPARSECHOLESKY_MIXED )
+      {
+        if constexpr (is_same<TM,double>::value && is_same<TV_ROW,double>::value)
+          {
+            auto self = const_cast<BaseMatrix&> (static_cast<const BaseMatrix&> (*this)).SharedFromThis<BaseMatrix>();
+            return make_shared<MixedPrecisionInverse> (self, make_shared<SparseCholeskyFloat> (*this, subset));
+          }
+        else
+          throw Exception ("SparseMatrix::InverseMatrix:  sparsecholesky_mixed is available for real matrices only");
+      }
     else
       return make_shared<SparseCholesky<TM,TV_ROW,TV_COL>> (*this, subset);
   }
@@ -95,10 +95,15 @@ namespace ngla
     
     /// balancing for multi-threading
     Partitioning balance;
+    /// copy of the balancing, shared with the vectors
+    shared_ptr<Partitioning> vecbalance;
 
     /// owner of arrays ?
     bool owner;
 
+    /// keeps external storage (e.g. a memory-mapped file) alive
+    shared_ptr<void> memory_holder;
+
   public:
     /// arbitrary number of els/row
     MatrixGraph (const Array<int> & elsperrow, int awidth);
@@ -111,6 +116,9 @@ namespace ngla
     /// 
     MatrixGraph (int size, int width,
                  const Table<int> & rowelements, const Table<int> & colelements, bool symmetric);
+    /// graph in external memory, arrays are used without copying
+    MatrixGraph (int awidth, FlatArray<size_t> afirsti, FlatArray<int> acolnr,
+                 shared_ptr<void> amemory_holder);
     /// 
     // MatrixGraph (const Table<int> & dof2dof, bool symmetric);
     virtual ~MatrixGraph ();
@@ -147,6 +155,8 @@ namespace ngla
     void FindSameNZE();
     void CalcBalancing ();
     const Partitioning & GetBalancing() const { return balance; } 
+    /// the row balancing for first touch and operations of the vectors
+    shared_ptr<Partitioning> GetVectorBalancing() const { return vecbalance; }
 
     ostream & Print (ostream & ost) const;
 
@@ -239,6 +249,15 @@ namespace ngla
     {
       throw Exception ("BaseSparseMatrix::CreateTranspose");      
     }
+
+    /**
+       y += s * Prow * A * Pcol * x, the projectors keep the rows (columns) where
+       the mask equals keep, no mask for the identity. Sparse matrices skip the
+       masked rows and columns within the product.
+    */
+    virtual void MultAddMasked (double s, const BaseVector & x, BaseVector & y,
+                                shared_ptr<BitArray> rowmask, bool rowkeep,
+                                shared_ptr<BitArray> colmask, bool colkeep) const;
       
     virtual shared_ptr<BaseMatrix>
       InverseMatrix (shared_ptr<BitArray> subset = nullptr) const override
@@ -410,6 +429,16 @@ namespace ngla
       GetMemoryTracer().SetName("SparseMatrix");
     }
 
+    /// use external memory (e.g. a memory-mapped file) for the values, without copying
+    void AssignMemory (FlatArray<TM> avalues, shared_ptr<void> amemory_holder)
+    {
+      if (avalues.Size() != nze)
+        throw Exception ("SparseMatrixTM::AssignMemory: size mismatch");
+      static_cast<Array<TM>&> (data) = Array<TM> (avalues.Size(), avalues.Data());
+      asvec.AssignMemory (nze*sizeof(TM)/sizeof(TSCAL), (void*)data.Addr(0));
+      this->memory_holder = amemory_holder;
+    }
+
     SparseMatrixTM (const SparseMatrixTM & amat)
       : BASE (amat), 
       data(nze), nul(TSCAL(0))
@@ -473,6 +502,18 @@ namespace ngla
     virtual void AddElementMatrixSymmetric(FlatArray<int> dnums,
                                            BareSliceMatrix<TSCAL> elmat,
                                            bool use_atomic = false);
+
+    /**
+       Positions of the element matrix entries within the rows (offsets to First(row)),
+       pos[i*dnums2.Size()+j], -1 for unused dofs. In the symmetric case only the
+       entries added by AddElementMatrixSymmetric get a position.
+       Exception for entries not in the graph.
+    */
+    void GetElementPositions (FlatArray<int> dnums1, FlatArray<int> dnums2, bool symmetric,
+                              FlatArray<int> pos) const;
+    /// adds the element matrix at positions from GetElementPositions
+    void AddElementMatrixPositions (FlatArray<int> dnums1, FlatArray<int> pos,
+                                    BareSliceMatrix<TSCAL> elmat, bool use_atomic = false);
     
 
     virtual void SetZero() override;
@@ -634,6 +675,10 @@ namespace ngla
     virtual void MultAdd1 (double s, const BaseVector & x, BaseVector & y,
 			   const BitArray * ainner = NULL,
 			   const Array<int> * acluster = NULL) const override;
+
+    virtual void MultAddMasked (double s, const BaseVector & x, BaseVector & y,
+                                shared_ptr<BitArray> rowmask, bool rowkeep,
+                                shared_ptr<BitArray> colmask, bool colkeep) const override;
     
     virtual void DoArchive (Archive & ar) override;
   };
@@ -644,6 +689,21 @@ namespace ngla
   template<class TM, class TV>
   class NGS_DLL_HEADER SparseMatrixSymmetric : public SparseMatrix<TM,TV,TV>
   {
+  protected:
+    using SparseMatrixTM<TM>::balance;
+    /*
+      Strictly lower entries (i,j) with row j in an earlier part of the
+      balancing than row i, sorted by j: entry l is at position sep_pos[l]
+      of row sep_row[l]. In the parallel products the task of part p adds
+      only to the rows of part p, the transposed separator entries are
+      added by the task of row j.
+    */
+    mutable Array<size_t> sep_first;
+    mutable Array<int> sep_row;
+    mutable Array<size_t> sep_pos;
+    mutable std::once_flag sep_once;
+
+    void CalcSeparatorEntries () const;
 
   public:
     using SparseMatrixTM<TM>::firsti;
@@ -729,6 +789,12 @@ namespace ngla
     virtual shared_ptr<BaseSparseMatrix> Restrict (const SparseMatrixTM<double> & prol,
 					 shared_ptr<BaseSparseMatrix> cmat = nullptr) const override;
 
+    /// the matrix is its own transpose, keep the symmetric storage
+    virtual shared_ptr<BaseSparseMatrix> CreateTranspose() const override
+    {
+      return make_shared<SparseMatrixSymmetric> (*this);
+    }
+
     ///
     virtual void MultAdd (double s, const BaseVector & x, BaseVector & y) const override;
 
@@ -737,6 +803,14 @@ namespace ngla
       MultAdd (s, x, y);
     }
 
+    /// the lower triangle kernel does not apply, projects the vectors
+    virtual void MultAddMasked (double s, const BaseVector & x, BaseVector & y,
+                                shared_ptr<BitArray> rowmask, bool rowkeep,
+                                shared_ptr<BitArray> colmask, bool colkeep) const override
+    {
+      BaseSparseMatrix::MultAddMasked (s, x, y, rowmask, rowkeep, colmask, colkeep);
+    }
+
 
     /*
       y += s L * x
@@ -800,6 +874,46 @@ namespace ngla
   NGS_DLL_HEADER shared_ptr<SparseMatrixTM<double>>
   MatMult (const SparseMatrixTM<double> & mata, const SparseMatrixTM<double> & matb);
 
+
+  // real matrix times complex vector: SIMD kernel, x is loaded as (re,im) pairs
+  template<> NGS_DLL_HEADER void SparseMatrix<double,Complex,Complex> ::
+  MultAdd (double s, const BaseVector & x, BaseVector & y) const;
+  template<> NGS_DLL_HEADER void SparseMatrix<double,Complex,Complex> ::
+  MultAdd (Complex s, const BaseVector & x, BaseVector & y) const;
+
+  /**
+     K + z M for real sparse matrices K and M on the same graph,
+     applied to complex vectors in one sweep. Every column index and
+     every vector entry is loaded once for both matrices.
+     Matrices with different graphs are applied in the same sweep too,
+     with one row kernel per matrix.
+  */
+  class NGS_DLL_HEADER PairedSparseMatrix : public BaseMatrix
+  {
+    shared_ptr<SparseMatrix<double>> k, m;
+    Complex z;
+    bool samegraph;
+  public:
+    PairedSparseMatrix (shared_ptr<SparseMatrix<double>> ak,
+                        shared_ptr<SparseMatrix<double>> am, Complex az);
+
+    Complex GetFactor () const { return z; }
+    void SetFactor (Complex az) { z = az; }
+    bool SameGraph () const { return samegraph; }
+
+    virtual bool IsComplex() const override { return true; }
+
+    virtual int VHeight() const override { return k->Height(); }
+    virtual int VWidth() const override { return k->Width(); }
+
+    virtual AutoVector CreateRowVector () const override;
+    virtual AutoVector CreateColVector () const override;
+
+    virtual void Mult (const BaseVector & x, BaseVector & y) const override;
+    virtual void MultAdd (double s, const BaseVector & x, BaseVector & y) const override;
+    virtual void MultAdd (Complex s, const BaseVector & x, BaseVector & y) const override;
+  };
+
 #ifdef GOLD
 #include <sparsematrix_spec.hpp>
 #endif
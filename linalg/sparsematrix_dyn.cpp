@@ -51,39 +51,142 @@ namespace ngla
   template <typename TSCAL>
   void SparseMatrixDynamic<TSCAL> :: MultAdd (double s, const BaseVector & x, BaseVector & y) const 
   {
-    // for (size_t i = 0; i < Height(); i++)
-    ParallelForRange
-      (Height(), [&] (IntRange r)
-       {
-         auto fx = x.FV<TSCAL>();
-         auto fy = y.FV<TSCAL>();
-         auto matvecfunc = dispatch_addmatvec[bw];
-
-         size_t my_bw = bw;
-         size_t my_bh = bh;
-         size_t my_bs = bs;
-         double my_s = s;
-
-         TSCAL * pmat = &data[bs*firsti[r.First()]];
-         TSCAL * py = &fy(r.First()*my_bh);
-         for (auto i : r)
-           {
-             auto rowind = GetRowIndices(i);
-             FlatVector<TSCAL> yi(my_bh, py); 
-             for (auto j : rowind)
-               {
-                 FlatVector<TSCAL> xi(my_bw, &fx(j*my_bw));
-                 FlatMatrix<TSCAL> mi(my_bh, my_bw, pmat);
-                 // yi += s * mi * xi;
-                 (*matvecfunc) (my_s, mi, xi, yi);            
-                 pmat += my_bs;
-               }
-             py += my_bh;
-           }
-       });
+    static Timer t("SparseMatrixDynamic::MultAdd");
+    RegionTimer reg(t);
+    t.AddFlops (bs*nze);
+
+    auto fx = x.FV<TSCAL>();
+    auto fy = y.FV<TSCAL>();
+
+    // square blocks up to 12x12: kernels with compile-time block size
+    size_t sbs = (bh == bw && bh <= 12) ? bh : 0;
+    Switch<13> (sbs, [&] (auto BS)
+      {
+        constexpr size_t N = BS.value;
+        if constexpr (N > 0)
+          ParallelForRange
+            (balance, [&] (IntRange r)
+             {
+               for (auto i : r)
+                 {
+                   Vec<N,TSCAL> sum = TSCAL(0.0);
+                   const TSCAL * pmat = &data[N*N*firsti[i]];
+                   for (auto j : GetRowIndices(i))
+                     {
+                       const TSCAL * px = &fx(N*j);
+                       for (size_t k = 0; k < N; k++)
+                         for (size_t l = 0; l < N; l++)
+                           sum(k) += pmat[k*N+l] * px[l];
+                       pmat += N*N;
+                     }
+                   for (size_t k = 0; k < N; k++)
+                     fy(N*i+k) += s * sum(k);
+                 }
+             });
+        else
+          ParallelForRange
+            (balance, [&] (IntRange r)
+             {
+               size_t my_bw = bw;
+               size_t my_bh = bh;
+               size_t my_bs = bs;
+               double my_s = s;
+               
+               TSCAL * pmat = &data[bs*firsti[r.First()]];
+               TSCAL * py = &fy(r.First()*my_bh);
+               for (auto i : r)
+                 {
+                   auto rowind = GetRowIndices(i);
+                   FlatVector<TSCAL> yi(my_bh, py); 
+                   for (auto j : rowind)
+                     {
+                       FlatVector<TSCAL> xi(my_bw, &fx(j*my_bw));
+                       FlatMatrix<TSCAL> mi(my_bh, my_bw, pmat);
+                       // yi += s * mi * xi;
+                       MultAddMatVec (my_s, mi, xi, yi);
+                       pmat += my_bs;
+                     }
+                   py += my_bh;
+                 }
+             });
+      });
+  }
+
+
+  // rows i*bs ... i*bs+bs-1 have the same non-zero pattern, consisting of full blocks
+  template <typename TSCAL>
+  static bool IsBlockRow (const SparseMatrixTM<TSCAL> & mat, size_t i, size_t bs)
+  {
+    auto ind = mat.GetRowIndices(i*bs);
+    if (ind.Size() % bs) return false;
+    for (size_t k = 1; k < bs; k++)
+      if (!(mat.GetRowIndices(i*bs+k) == ind)) return false;
+    for (size_t j = 0; j < ind.Size(); j += bs)
+      {
+        if (ind[j] % bs) return false;
+        for (size_t l = 1; l < bs; l++)
+          if (ind[j+l] != ind[j]+int(l)) return false;
+      }
+    return true;
+  }
+
+  template <typename TSCAL>
+  static Array<int> BlockRowSizes (const SparseMatrixTM<TSCAL> & mat, size_t bs)
+  {
+    if (mat.Height() % bs || mat.Width() % bs)
+      throw Exception ("SparseMatrixDynamic: matrix size is not a multiple of the block size "
+                       + ToString(bs));
+    Array<int> cnt(mat.Height()/bs);
+    for (size_t i = 0; i < cnt.Size(); i++)
+      cnt[i] = mat.GetRowIndices(i*bs).Size() / bs;
+    return cnt;
   }
   
+  template <typename TSCAL>
+  size_t SparseMatrixDynamic<TSCAL> ::
+  FindBlockSize (const SparseMatrixTM<TSCAL> & mat, size_t maxbs)
+  {
+    for (size_t bs = maxbs; bs >= 2; bs--)
+      {
+        if (mat.Height() % bs || mat.Width() % bs) continue;
+        atomic<bool> ok(true);
+        ParallelFor (mat.Height()/bs, [&] (size_t i)
+                     {
+                       if (ok && !IsBlockRow (mat, i, bs))
+                         ok = false;
+                     });
+        if (ok) return bs;
+      }
+    return 1;
+  }
 
+  template <typename TSCAL>
+  SparseMatrixDynamic<TSCAL> ::
+  SparseMatrixDynamic (const SparseMatrixTM<TSCAL> & mat, size_t abs)
+    : BaseSparseMatrix (BlockRowSizes (mat, abs), mat.Width()/abs)
+  {
+    bh = abs;
+    bw = abs;
+    bs = abs*abs;
+    data.SetSize(nze*bs);
+    ParallelFor (size, [&] (size_t i)
+                 {
+                   if (!IsBlockRow (mat, i, abs))
+                     throw Exception ("SparseMatrixDynamic: no block structure in row "
+                                      + ToString(i*abs));
+                   auto ind = mat.GetRowIndices(i*abs);
+                   auto bind = GetRowIndices(i);
+                   for (size_t j = 0; j < bind.Size(); j++)
+                     {
+                       bind[j] = ind[j*abs] / abs;
+                       FlatMatrix<TSCAL> block(bh, bw, &data[(firsti[i]+j)*bs]);
+                       for (size_t k = 0; k < abs; k++)
+                         block.Row(k) = mat.GetRowValues(i*abs+k).Range(j*abs, (j+1)*abs);
+                     }
+                 });
+  }
+
+  
   template class SparseMatrixDynamic<double>;
 
   template <typename TSCAL>
@@ -40,6 +40,16 @@ namespace ngla
         }
     }
 
+    /// abs x abs blocks of a scalar matrix, the graph must consist of full node blocks
+    SparseMatrixDynamic (const SparseMatrixTM<TSCAL> & mat, size_t abs);
+
+    /**
+       largest block size bs <= maxbs such that consecutive groups of bs rows 
+       have the same non-zero pattern (same_nze), consisting of full column blocks.
+       1 if there is no block structure.
+    */
+    static size_t FindBlockSize (const SparseMatrixTM<TSCAL> & mat, size_t maxbs = 12);
+
     virtual int VHeight() const override { return size; }
     virtual int VWidth() const override { return width; }
 
@@ -47,9 +57,9 @@ namespace ngla
     virtual void MultAdd (double s, const BaseVector & x, BaseVector & y) const override;
 
     AutoVector CreateRowVector() const override
-    { throw Exception("CreateRowVector not implemented for SparseMatrixDynamic!"); }
+    { return CreateBaseVector(width, is_same<TSCAL,Complex>::value, bw); }
     AutoVector CreateColVector() const override
-    { throw  Exception("CreateColVector not implemented for SparseMatrixDynamic!"); }
+    { return CreateBaseVector(size, is_same<TSCAL,Complex>::value, bh); }
 
     virtual tuple<int,int> EntrySizes() const override { return { bh, bw }; }
 
@@ -107,6 +107,97 @@ namespace ngla
   }
   
 
+  template <class TM>
+  void SparseMatrixTM<TM> ::
+  GetElementPositions (FlatArray<int> dnums1, FlatArray<int> dnums2, bool symmetric,
+                       FlatArray<int> pos) const
+  {
+    size_t n2 = dnums2.Size();
+    pos = -1;
+
+    ArrayMem<int, 50> map(n2);
+    for (int i = 0; i < map.Size(); i++) map[i] = i;
+    QuickSortI (dnums2, map);
+
+    if (symmetric)
+      {
+        // the same entries as AddElementMatrixSymmetric: sorted dnums, j1 <= i1
+        for (int i1 = 0; i1 < n2; i1++)
+          {
+            int row = dnums2[map[i1]];
+            if (!IsRegularIndex(row)) continue;
+            FlatArray<int> rowind = this->GetRowIndices(row);
+            size_t k = 0;
+            for (int j1 = 0; j1 <= i1; j1++)
+              {
+                int col = dnums2[map[j1]];
+                if (!IsRegularIndex(col)) continue;
+                while (rowind[k] != col)
+                  {
+                    k++;
+                    if (k >= rowind.Size())
+                      throw Exception ("SparseMatrixTM::GetElementPositions: illegal dnums");
+                  }
+                pos[map[i1]*n2+map[j1]] = k;
+              }
+          }
+        return;
+      }
+
+    for (int i = 0; i < dnums1.Size(); i++)
+      if (IsRegularIndex(dnums1[i]))
+	{
+	  FlatArray<int> rowind = this->GetRowIndices(dnums1[i]);
+	  size_t k = 0;
+	  for (int j1 = 0; j1 < n2; j1++)
+	    {
+	      int j = map[j1];
+	      if (IsRegularIndex(dnums2[j]))
+		{
+		  while (rowind[k] != dnums2[j])
+		    {
+		      k++;
+		      if (k >= rowind.Size())
+			throw Exception ("SparseMatrixTM::GetElementPositions: illegal dnums");
+		    }
+                  pos[i*n2+j] = k;
+		}
+	    }
+	}
+  }
+
+  template <class TM>
+  void SparseMatrixTM<TM> ::
+  AddElementMatrixPositions (FlatArray<int> dnums1, FlatArray<int> pos,
+                             BareSliceMatrix<TSCAL> elmat1, bool use_atomic)
+  {
+    static Timer timer("SparseMatrix::AddElementMatrix - positions");
+    ThreadRegionTimer reg (timer, TaskManager::GetThreadId());
+    NgProfiler::AddThreadFlops (timer, TaskManager::GetThreadId(), pos.Size());
+
+    Scalar2ElemMatrix<TM, TSCAL> elmat (elmat1);
+    size_t n1 = dnums1.Size();
+    size_t n2 = n1 ? pos.Size() / n1 : 0;
+
+    for (size_t i = 0; i < n1; i++)
+      if (IsRegularIndex(dnums1[i]))
+        {
+          TM * rowvals = data.Addr(firsti[dnums1[i]]);
+          FlatArray<int> rowpos = pos.Range(i*n2, (i+1)*n2);
+          if (use_atomic)
+            {
+              for (size_t j = 0; j < n2; j++)
+                if (rowpos[j] >= 0)
+                  AtomicAdd (rowvals[rowpos[j]], elmat(i,j));
+            }
+          else
+            for (size_t j = 0; j < n2; j++)
+              if (rowpos[j] >= 0)
+                rowvals[rowpos[j]] += elmat(i,j);
+        }
+  }
+
+
   template <class TM>
   void SparseMatrixTM<TM> :: SetZero ()
   {
@@ -215,6 +306,46 @@ namespace ngla
   
   
 
+  template <class TM, class TV_ROW, class TV_COL>
+  void SparseMatrix<TM,TV_ROW,TV_COL> ::
+  MultAddMasked (double s, const BaseVector & x, BaseVector & y,
+                 shared_ptr<BitArray> rowmask, bool rowkeep,
+                 shared_ptr<BitArray> colmask, bool colkeep) const
+  {
+    static Timer t("SparseMatrix::MultAddMasked"); RegionTimer reg(t);
+    t.AddFlops (this->NZE());
+
+    const BitArray * rows = rowmask.get();
+    const BitArray * cols = colmask.get();
+
+    ParallelForRange
+      (balance, [&] (IntRange myrange)
+       {
+         typedef typename mat_traits<TVY>::TSCAL TTSCAL;
+         FlatVector<TVX> fx = x.FV<TVX>(); 
+         FlatVector<TVY> fy = y.FV<TVY>(); 
+
+         for (auto i : myrange)
+           {
+             if (rows && rows->Test(i) != rowkeep) continue;
+             if (!cols)
+               {
+                 fy(i) += s * RowTimesVector (i, fx);
+                 continue;
+               }
+             TVY sum = TTSCAL(0);
+             for (size_t k = firsti[i]; k < firsti[i+1]; k++)
+               {
+                 int j = colnr[k];
+                 if (cols->Test(j) == colkeep)
+                   sum += data[k] * fx(j);
+               }
+             fy(i) += s * sum;
+           }
+       });
+  }
+
+
   template <class TM, class TV_ROW, class TV_COL>
   void SparseMatrix<TM,TV_ROW,TV_COL> ::
   MultTransAdd (double s, const BaseVector & x, BaseVector & y) const
@@ -347,6 +478,16 @@ namespace ngla
 	  throw Exception ("SparseMatrix::InverseMatrix: MumpsInverse not available");
 #endif
 	}
+      else if ( BaseSparseMatrix :: GetInverseType()  == SPARSECHOLESKY_MIXED )
+        {
+          if constexpr (is_same<TM,double>::value && is_same<TV_ROW,double>::value)
+            {
+              auto self = const_cast<BaseMatrix&> (static_cast<const BaseMatrix&> (*this)).SharedFromThis<BaseMatrix>();
+              return make_shared<MixedPrecisionInverse> (self, make_shared<SparseCholeskyFloat> (*this, subset));
+            }
+          else
+            throw Exception ("SparseMatrix::InverseMatrix:  sparsecholesky_mixed is available for real matrices only");
+        }
       else
 	return make_shared<SparseCholesky<TM,TV_ROW,TV_COL>> (*this, subset);
       //#endif
@@ -474,7 +615,7 @@ namespace ngla
   CreateVector () const
   {
     if (this->size==this->width)
-      return make_unique<VVector<TVY>> (this->size);
+      return make_unique<VVector<TVY>> (this->size, this->GetVectorBalancing());
     throw Exception ("SparseMatrix::CreateVector for rectangular does not make sense, use either CreateColVector or CreateRowVector");
   }
 
@@ -482,6 +623,8 @@ namespace ngla
   AutoVector SparseMatrix<TM,TV_ROW,TV_COL> ::
   CreateRowVector () const
   {
+    if (this->size==this->width)
+      return make_unique<VVector<TVX>> (this->width, this->GetVectorBalancing());
     return make_unique<VVector<TVX>> (this->width);
   }
 
@@ -489,177 +632,221 @@ namespace ngla
   AutoVector SparseMatrix<TM,TV_ROW,TV_COL> ::
   CreateColVector () const
   {
-    return make_unique<VVector<TVY>> (this->size);
+    return make_unique<VVector<TVY>> (this->size, this->GetVectorBalancing());
   }
 
 
-  template<class TM, class TV_ROW, class TV_COL>
-  shared_ptr<BaseSparseMatrix>
-  SparseMatrix<TM,TV_ROW,TV_COL> :: Restrict (const SparseMatrixTM<double> & prol,
-                                  shared_ptr<BaseSparseMatrix> acmat ) const
+  /*
+    Galerkin product  C = P^T A P,  computed row by row of C
+    without forming A P:
+
+      C(I,:) = sum_i P(i,I) sum_j A(i,j) P(j,:)
+
+    The rows I of P^T are taken from the transposed prolongation.
+    For lower, only entries C(I,K) with K <= I are computed.
+    If cmat is given, its graph is reused, otherwise creator(cnt, width)
+    creates the matrix, and the graph is computed.
+  */
+  template <class TM>
+  shared_ptr<SparseMatrixTM<TM>>
+  GalerkinProduct (const SparseMatrixTM<TM> & mat, const SparseMatrixTM<double> & prol, bool lower,
+                   shared_ptr<SparseMatrixTM<TM>> cmat,
+                   const function<shared_ptr<SparseMatrixTM<TM>>(const Array<int>&,int)> & creator)
   {
-    static Timer t ("sparsematrix - restrict");
-    static Timer tbuild ("sparsematrix - restrict, build matrix");
-    static Timer tcomp ("sparsematrix - restrict, compute matrix");
+    static Timer t ("sparsematrix - Galerkin product");
+    static Timer tgraph ("sparsematrix - Galerkin product, graph");
     RegionTimer reg(t);
-    
-    int n = this->Height();
-
-    auto cmat = dynamic_pointer_cast<SparseMatrixTM<TM>> (acmat);
- 
-    // if no coarse matrix, build up matrix-graph!
-    if ( !cmat )
-      {
-        RegionTimer reg(tbuild);
 
-	Array<int> marks(n);
-	Array<INT<2> > e2v;
-	for (int i = 0; i < n; i++)
-	  for (int j = 0; j < this->GetRowIndices(i).Size(); j++)
-	    {
-	      int col = this->GetRowIndices(i)[j];
-	      FlatArray<int> prol_rowind = prol.GetRowIndices(i);
-	      FlatArray<int> prol_colind = prol.GetRowIndices(col);
-
-	      for (int k = 0; k < prol_rowind.Size(); k++)
-		for (int l = 0; l < prol_colind.Size(); l++)
-		  {
-		    int kk = prol_rowind[k];
-		    int ll = prol_colind[l];
-		    
-		    // if (kk >= ll) swap (kk,ll);
-		    e2v.Append (INT<2> (kk,ll));
-		  }
-	    }
+    auto prolT = dynamic_pointer_cast<SparseMatrixTM<double>> (prol.CreateTranspose());
+    size_t nc = prol.Width();
 
-	int nc = 0;
-	for (int i = 0; i < e2v.Size(); i++)
-	  nc = max2 (nc, e2v[i][1]);
-	nc++;
-
-	// *testout << "e2v = " << endl << e2v << endl;
-        
-        // count all entries in row with multiplicity
-	Array<int> cnt(nc);
-	cnt = 0;
-	for (int i = 0; i < e2v.Size(); i++)
-	  cnt[e2v[i][1]]++;
-
-	Table<int> v2e(cnt);
-	cnt = 0;
-	for (int i = 0; i < e2v.Size(); i++)
-	  {
-	    int v1 = e2v[i][1];
-	    v2e[v1][cnt[v1]++] = i;
-	  }
-	
-	cnt = 0;
-	marks = -1;
-
-        // count all entries in row withOUT multiplicity
-	for (int i = 0; i < nc; i++)
-	  for (int j = 0; j < v2e[i].Size(); j++)
-	    {
-	      int jj = v2e[i][j];
-	      int v0 = e2v[jj][0];
-	      if (marks[v0] != i) 
-		{
-		  cnt[i]++;
-		  marks[v0] = i;
-		}
-	    }
+    // per thread: marker, and position of column K in the current row
+    Array<Array<int>> marks(TaskManager::GetNumThreads());
+    auto get_mark = [&] () -> FlatArray<int>
+      {
+        auto & mark = marks[TaskManager::GetThreadId()];
+        if (mark.Size() < nc)
+          {
+            mark.SetSize(nc);
+            mark = -1;
+          }
+        return mark;
+      };
 
-	cmat = make_shared<SparseMatrix<TM,TV_ROW,TV_COL>> (cnt);
+    // calls func(K,val) for all contributions P(i,I) A(i,j) P(j,K) to row I
+    auto iterate_row = [&] (int I, auto func)
+      {
+        auto pti = prolT->GetRowIndices(I);
+        auto ptv = prolT->GetRowValues(I);
+        for (size_t ii = 0; ii < pti.Size(); ii++)
+          {
+            int i = pti[ii];
+            auto ai = mat.GetRowIndices(i);
+            auto av = mat.GetRowValues(i);
+            for (size_t jj = 0; jj < ai.Size(); jj++)
+              {
+                auto pj = prol.GetRowIndices(ai[jj]);
+                auto pv = prol.GetRowValues(ai[jj]);
+                for (size_t kk = 0; kk < pj.Size(); kk++)
+                  if (!lower || pj[kk] <= I)
+                    func (pj[kk], ptv(ii), av(jj), pv(kk));
+              }
+          }
+      };
 
-	marks = -1;
-	for (int i = 0; i < nc; i++)
-	  for (int j = 0; j < v2e[i].Size(); j++)
-	    {
-	      int jj = v2e[i][j];
-	      int v0 = e2v[jj][0];
-	      if (marks[v0] != i) 
-		{
-		  marks[v0] = i;
-		  cmat -> CreatePosition (i, v0);
-		}
-	    }
+    if (!cmat)
+      {
+        RegionTimer reg(tgraph);
+        Array<int> cnt(nc);
+        ParallelForRange (nc, [&] (IntRange r)
+          {
+            auto mark = get_mark();
+            for (int I : r)
+              {
+                int cnti = 0;
+                iterate_row (I, [&] (int K, double, const TM &, double)
+                             {
+                               if (mark[K] != I)
+                                 {
+                                   mark[K] = I;
+                                   cnti++;
+                                 }
+                             });
+                cnt[I] = cnti;
+              }
+          }, TasksPerThread(10));
+
+        cmat = creator (cnt, nc);
+
+        for (auto & mark : marks)
+          mark = -1;
+
+        ParallelForRange (nc, [&] (IntRange r)
+          {
+            auto mark = get_mark();
+            for (int I : r)
+              {
+                auto ind = cmat->GetRowIndices(I);
+                size_t k = 0;
+                iterate_row (I, [&] (int K, double, const TM &, double)
+                             {
+                               if (mark[K] != I)
+                                 {
+                                   mark[K] = I;
+                                   ind[k++] = K;
+                                 }
+                             });
+                QuickSort (ind);
+              }
+          }, TasksPerThread(10));
+
+        for (auto & mark : marks)
+          mark = -1;
       }
 
-    cmat->AsVector() = 0.0;
-    RegionTimer reg2(tcomp);
-	  
-    for (int i = 0; i < n; i++)
+    auto & c = *cmat;
+    ParallelForRange (min2(nc, size_t(c.Height())), [&] (IntRange r)
       {
-        FlatArray<int> mat_ri = this->GetRowIndices(i);
-        FlatVector<TM> mat_rval = this->GetRowValues(i);
-
-        for (int j = 0; j < mat_ri.Size(); j++)
+        auto pos = get_mark();
+        for (int I : r)
           {
-            int col = mat_ri[j];
-            TM mat_val = mat_rval[j]; 
-
-            FlatArray<int> prol_ri_i = prol.GetRowIndices(i);
-            FlatArray<int> prol_ri_col = prol.GetRowIndices(col);
-            FlatVector<double> prol_rval_i = prol.GetRowValues(i);
-            FlatVector<double> prol_rval_col = prol.GetRowValues(col);
-
-            for (int k = 0; k < prol_ri_i.Size(); k++)
-              for (int l = 0; l < prol_ri_col.Size(); l++)
-                {
-                  int kk = prol_ri_i[k];
-                  int ll = prol_ri_col[l];
-                  
-                  if ( /*kk>=ll &&*/ kk < cmat->Height() )
-                    {
-                      (*cmat)(kk,ll) += 
-                        prol_rval_i[k] * prol_rval_col[l] * mat_val; 
-                    }
-                  
-                  // if (ll >= kk && i != col && ll < cmat->Height() )
-                  //   {
-                  //     (*cmat)(ll,kk) += 
-                  //       prol_rval_col[l] * prol_rval_i[k] * Trans(mat_val); 
-                  //   }
-                  
-                }
+            auto ind = c.GetRowIndices(I);
+            auto vals = c.GetRowValues(I);
+            for (size_t k = 0; k < ind.Size(); k++)
+              pos[ind[k]] = k;
+            vals = TM(0.0);
+
+            bool missing = false;
+            iterate_row (I, [&] (int K, double pi, const TM & a, double pk)
+                         {
+                           if (pos[K] >= 0)
+                             vals(pos[K]) += (pi*pk) * a;
+                           else
+                             missing = true;
+                         });
+
+            for (int K : ind)
+              pos[K] = -1;
+            if (missing)
+              throw Exception ("GalerkinProduct: coarse matrix graph does not fit");
           }
-      }
+      }, TasksPerThread(10));
+
     return cmat;
   }
 
+  
+  template<class TM, class TV_ROW, class TV_COL>
+  shared_ptr<BaseSparseMatrix>
+  SparseMatrix<TM,TV_ROW,TV_COL> :: Restrict (const SparseMatrixTM<double> & prol,
+                                  shared_ptr<BaseSparseMatrix> acmat ) const
+  {
+    static Timer t ("sparsematrix - restrict");
+    RegionTimer reg(t);
+
+    return GalerkinProduct<TM>
+      (*this, prol, false, dynamic_pointer_cast<SparseMatrixTM<TM>> (acmat),
+       [] (const Array<int> & cnt, int width) -> shared_ptr<SparseMatrixTM<TM>>
+       { return make_shared<SparseMatrix<TM,TV_ROW,TV_COL>> (cnt, width); });
+  }
+
   template <class TM>
   shared_ptr<BaseSparseMatrix> SparseMatrixTM<TM> ::
   CreateTransposeTM (const function<shared_ptr<SparseMatrixTM<decltype(Trans(TM()))>>(const Array<int>&,int)> & creator) const
   {
-    Array<int> cnt(this->Width());
-    cnt = 0;
-    ParallelFor (this->Height(), [&] (int i)
+    // the source rows are split into blocks, each block counts its entries
+    // per column. The prefix sums over the blocks give each block its
+    // positions in the rows of the transpose: the scatter is stable,
+    // rows of the transpose are sorted without atomics and without sorting.
+    size_t h = this->Height(), w = this->Width();
+    size_t nblocks = min3 (size_t(TaskManager::GetNumThreads()), h/256+1,
+                           max2 (size_t(1), (size_t(1) << 24) / (w+1)));
+    Array<int> blockcnt(nblocks*w);
+    
+    ParallelFor (nblocks, [&] (size_t b)
                  {
-                   for (int c : this->GetRowIndices(i))
-                     AsAtomic (cnt[c]) ++;
+                   FlatArray<int> bcnt = blockcnt.Range(b*w, (b+1)*w);
+                   bcnt = 0;
+                   for (size_t i : ngstd::Range(h).Split(b, nblocks))
+                     for (int c : this->GetRowIndices(i))
+                       bcnt[c]++;
                  });
 
-    auto trans = creator(cnt, this->Height());
+    Array<int> cnt(w);
+    ParallelForRange (w, [&] (IntRange r)
+                      {
+                        for (size_t c : r)
+                          {
+                            int sum = 0;
+                            for (size_t b = 0; b < nblocks; b++)
+                              {
+                                int bc = blockcnt[b*w+c];
+                                blockcnt[b*w+c] = sum;
+                                sum += bc;
+                              }
+                            cnt[c] = sum;
+                          }
+                      });
+
+    auto trans = creator(cnt, h);
 
-    cnt = 0;
-    ParallelFor (this->Height(), [&] (int i)
+    ParallelFor (nblocks, [&] (size_t b)
                  {
-                   for (int ci : Range(this->GetRowIndices(i)))
+                   FlatArray<int> pos = blockcnt.Range(b*w, (b+1)*w);
+                   for (size_t i : ngstd::Range(h).Split(b, nblocks))
                      {
-                       int c = this->GetRowIndices(i)[ci];
-                       int pos = AsAtomic(cnt[c])++;
-                       trans -> GetRowIndices(c)[pos] = i;
-                       trans -> GetRowValues(c)[pos] = Trans(this->GetRowValues(i)[ci]);
+                       auto ind = this->GetRowIndices(i);
+                       auto vals = this->GetRowValues(i);
+                       for (int ci : Range(ind))
+                         {
+                           int c = ind[ci];
+                           int p = pos[c]++;
+                           trans -> GetRowIndices(c)[p] = i;
+                           trans -> GetRowValues(c)[p] = Trans(vals[ci]);
+                         }
                      }
                  });
 
-    ParallelFor (trans->Height(), [&] (int r)
-                 {
-                   auto rowvals = trans->GetRowValues(r);
-                   BubbleSort (trans->GetRowIndices(r),
-                               FlatArray(rowvals.Size(), rowvals.Data()));
-                 });
-
     return trans;
   }
 
@@ -769,6 +956,45 @@ namespace ngla
     ; 
   }
 
+  template <class TM, class TV>
+  void SparseMatrixSymmetric<TM,TV> :: CalcSeparatorEntries () const
+  {
+    static Timer timer("SparseMatrixSymmetric::CalcSeparatorEntries");
+    RegionTimer reg (timer);
+
+    size_t n = this->Height();
+    auto for_separator_entries = [&] (auto f)
+      {
+        for (size_t p = 0; p < balance.Size(); p++)
+          {
+            IntRange r = balance[p];
+            for (auto i : r)
+              for (size_t k = firsti[i]; k < firsti[i+1]; k++)
+                if (colnr[k] < int(r.First()))
+                  f (i, k);
+          }
+      };
+
+    sep_first.SetSize (n+1);
+    sep_first = 0;
+    for_separator_entries ([&] (size_t i, size_t k) { sep_first[colnr[k]+1]++; });
+    for (size_t j = 0; j < n; j++)
+      sep_first[j+1] += sep_first[j];
+
+    sep_row.SetSize (sep_first[n]);
+    sep_pos.SetSize (sep_first[n]);
+    Array<size_t> cnt(n);
+    for (size_t j = 0; j < n; j++)
+      cnt[j] = sep_first[j];
+    for_separator_entries ([&] (size_t i, size_t k)
+                           {
+                             size_t l = cnt[colnr[k]]++;
+                             sep_row[l] = i;
+                             sep_pos[l] = k;
+                           });
+  }
+
+
   template <class TM, class TV>
   void SparseMatrixSymmetric<TM,TV> :: 
   MultAdd (double s, const BaseVector & x, BaseVector & y) const
@@ -780,11 +1006,30 @@ namespace ngla
     const FlatVector<TV_ROW> fx = x.FV<TV_ROW>();
     FlatVector<TV_COL> fy = y.FV<TV_COL>();
 
-    for (int i = 0; i < this->Height(); i++)
-      {
-	fy(i) += s * RowTimesVector (i, fx);
-	AddRowTransToVectorNoDiag (i, s * fx(i), fy);
-      }
+    std::call_once (sep_once, [this] () { CalcSeparatorEntries(); });
+
+    ParallelForRange
+      (balance, [&] (IntRange myrange)
+       {
+         typedef typename mat_traits<TVY>::TSCAL TTSCAL;
+         int first = myrange.First();
+         for (int i : myrange)
+           {
+             TVY sum = TTSCAL(0);
+             TVX sxi = s * fx(i);
+             for (size_t k = firsti[i]; k < firsti[i+1]; k++)
+               {
+                 int j = colnr[k];
+                 sum += data[k] * fx(j);
+                 if (j < i && j >= first)
+                   fy(j) += Trans(data[k]) * sxi;
+               }
+             fy(i) += s * sum;
+
+             for (size_t l = sep_first[i]; l < sep_first[i+1]; l++)
+               fy(i) += Trans(data[sep_pos[l]]) * (s * fx(sep_row[l]));
+           }
+       });
   }
 
   template <class TM, class TV>
@@ -795,33 +1040,36 @@ namespace ngla
   {
     const FlatVector<TV_ROW> fx = x.FV<TV_ROW> ();
     FlatVector<TV_COL> fy = y.FV<TV_COL> ();
+
+    // rows are independent
+    auto multadd1 = [&] (auto use_row)
+      {
+        ParallelForRange
+          (balance, [&] (IntRange myrange)
+           {
+             for (int i : myrange)
+               if (use_row(i))
+                 fy(i) += s * RowTimesVectorNoDiag (i, fx);
+           });
+      };
     
     if (inner)
       {
 	static Timer timer("SparseMatrixSymmetric::MultAdd1 - inner");
 	RegionTimer reg (timer);
-
-	for (int i = 0; i < this->Height(); i++)
-	  if (inner->Test(i))
-	    fy(i) += s * RowTimesVectorNoDiag (i, fx);
+        multadd1 ([inner] (int i) { return inner->Test(i); });
       }
     else if (cluster)
       {
 	static Timer timer("SparseMatrixSymmetric::MultAdd1 - cluster");
 	RegionTimer reg (timer);
-
-	for (int i = 0; i < this->Height(); i++)
-	  if ( (*cluster)[i])
-	    fy(i) += s * RowTimesVectorNoDiag (i, fx);
+        multadd1 ([cluster] (int i) { return (*cluster)[i] != 0; });
       }
     else
       {
 	static Timer timer("SparseMatrixSymmetric::MultAdd1");
 	RegionTimer reg (timer);
-	
-
-	for (int i = 0; i < this->Height(); i++)
-	  fy(i) += s * RowTimesVectorNoDiag (i, fx);
+        multadd1 ([] (int i) { return true; });
       }
   }
   
@@ -839,21 +1087,39 @@ namespace ngla
     const FlatVector<TV_ROW> fx = x.FV<TV_ROW> ();
     FlatVector<TV_COL> fy = y.FV<TV_COL> ();
 
-    if (inner)
+    std::call_once (sep_once, [this] () { CalcSeparatorEntries(); });
+
+    // the transposed entries of the own part are scattered,
+    // the separator entries of earlier parts are gathered
+    auto multadd2 = [&] (auto use_row)
       {
-	for (int i = 0; i < this->Height(); i++)
-	  if (inner->Test(i))
-	    AddRowTransToVector (i, s * fx(i), fy);
-      }
+        ParallelForRange
+          (balance, [&] (IntRange myrange)
+           {
+             int first = myrange.First();
+             for (int i : myrange)
+               {
+                 if (use_row(i))
+                   {
+                     TVX sxi = s * fx(i);
+                     for (size_t k = firsti[i]; k < firsti[i+1]; k++)
+                       if (colnr[k] >= first)
+                         fy(colnr[k]) += Trans(data[k]) * sxi;
+                   }
+
+                 for (size_t l = sep_first[i]; l < sep_first[i+1]; l++)
+                   if (use_row(sep_row[l]))
+                     fy(i) += Trans(data[sep_pos[l]]) * (s * fx(sep_row[l]));
+               }
+           });
+      };
+
+    if (inner)
+      multadd2 ([inner] (int i) { return inner->Test(i); });
     else if (cluster)
-      {
-	for (int i = 0; i < this->Height(); i++)
-	  if ( (*cluster)[i])
-	    AddRowTransToVector (i, s * fx(i), fy);
-      }
+      multadd2 ([cluster] (int i) { return (*cluster)[i] != 0; });
     else
-      for (int i = 0; i < this->Height(); i++)
-	AddRowTransToVector (i, s * fx(i), fy);
+      multadd2 ([] (int i) { return true; });
   }
 
 
@@ -163,6 +163,54 @@ namespace ngla
     else
       setval (*bits, x.SV<double>());
   }
+
+
+
+  void MaskedMatrix :: Mult (const BaseVector & x, BaseVector & y) const
+  {
+    y = 0.0;
+    MultAdd (1.0, x, y);
+  }
+
+  void MaskedMatrix :: MultAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    mat->MultAddMasked (s, x, y, rowmask, rowkeep, colmask, colkeep);
+  }
+
+  void MaskedMatrix :: MultAdd (Complex s, const BaseVector & x, BaseVector & y) const
+  {
+    auto hx = mat->CreateRowVector();
+    auto hy = mat->CreateColVector();
+    *hx = x;
+    if (colmask) Projector(colmask, colkeep).Project(*hx);
+    mat->Mult (*hx, *hy);
+    if (rowmask) Projector(rowmask, rowkeep).Project(*hy);
+    y.Add (s, *hy);
+  }
+
+  void MaskedMatrix :: MultTrans (const BaseVector & x, BaseVector & hy) const
+  {
+    // (Prow A Pcol)^T = Pcol A^T Prow
+    auto hx = mat->CreateColVector();
+    *hx = x;
+    if (rowmask) Projector(rowmask, rowkeep).Project(*hx);
+    mat->MultTrans (*hx, hy);
+    if (colmask) Projector(colmask, colkeep).Project(hy);
+  }
+
+  void MaskedMatrix :: MultTransAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    auto hy = mat->CreateRowVector();
+    MultTrans (x, *hy);
+    y.Add (s, *hy);
+  }
+
+  void MaskedMatrix :: MultTransAdd (Complex s, const BaseVector & x, BaseVector & y) const
+  {
+    auto hy = mat->CreateRowVector();
+    MultTrans (x, *hy);
+    y.Add (s, *hy);
+  }
   
 
 
@@ -20,6 +20,9 @@ namespace ngla
     Projector (shared_ptr<BitArray> abits, bool akeep_values = true)
       : bits(abits), keep_values(akeep_values) { ; }
 
+    shared_ptr<BitArray> GetMask () const { return bits; }
+    bool KeepValues () const { return keep_values; }
+
     virtual bool IsComplex() const override { return false; } 
 
     virtual int VHeight() const override { return bits->Size(); }
@@ -40,6 +43,47 @@ namespace ngla
   };
 
 
+  /**
+     Prow * A * Pcol for a sparse matrix A and projectors given by masks.
+     The real product skips the masked rows and columns within the sparse
+     matrix-vector product (BaseSparseMatrix::MultAddMasked).
+     A nullptr mask is the identity.
+  */
+  class NGS_DLL_HEADER MaskedMatrix : public BaseMatrix
+  {
+    shared_ptr<BaseSparseMatrix> mat;
+    shared_ptr<BitArray> rowmask, colmask;
+    bool rowkeep, colkeep;
+  public:
+    MaskedMatrix (shared_ptr<BaseSparseMatrix> amat,
+                  shared_ptr<BitArray> arowmask, bool arowkeep,
+                  shared_ptr<BitArray> acolmask, bool acolkeep)
+      : mat(amat), rowmask(arowmask), colmask(acolmask),
+        rowkeep(arowkeep), colkeep(acolkeep) { ; }
+
+    shared_ptr<BaseSparseMatrix> GetMatrix () const { return mat; }
+    shared_ptr<BitArray> GetRowMask () const { return rowmask; }
+    shared_ptr<BitArray> GetColMask () const { return colmask; }
+    bool RowKeep () const { return rowkeep; }
+    bool ColKeep () const { return colkeep; }
+
+    virtual bool IsComplex() const override { return mat->IsComplex(); }
+
+    virtual int VHeight() const override { return mat->VHeight(); }
+    virtual int VWidth() const override { return mat->VWidth(); }
+
+    virtual AutoVector CreateRowVector () const override { return mat->CreateRowVector(); }
+    virtual AutoVector CreateColVector () const override { return mat->CreateColVector(); }
+
+    virtual void Mult (const BaseVector & x, BaseVector & y) const override;
+    virtual void MultAdd (double s, const BaseVector & x, BaseVector & y) const override;
+    virtual void MultAdd (Complex s, const BaseVector & x, BaseVector & y) const override;
+    virtual void MultTrans (const BaseVector & x, BaseVector & y) const override;
+    virtual void MultTransAdd (double s, const BaseVector & x, BaseVector & y) const override;
+    virtual void MultTransAdd (Complex s, const BaseVector & x, BaseVector & y) const override;
+  };
+
+
   template <typename TM=double>
   class DiagonalMatrix : public BaseMatrix
   {
@@ -82,6 +126,9 @@ namespace ngla
     PermutationMatrix (size_t awidth, Array<size_t> aind)
       : width(awidth), ind(aind) { ; } 
 
+    /// y(i) = x(ind[i])
+    FlatArray<size_t> GetIndices () const { return ind; }
+
     virtual bool IsComplex() const override { return false; } 
 
     virtual int VHeight() const override { return ind.Size(); }
@@ -149,6 +196,9 @@ namespace ngla
     EmbeddedMatrix (size_t aheight, IntRange arange, shared_ptr<BaseMatrix> amat)
       : height(aheight), range(arange), mat(amat) { ; }
 
+    IntRange GetRange () const { return range; }
+    shared_ptr<BaseMatrix> GetMatrix () const { return mat; }
+
     virtual bool IsComplex() const override { return mat->IsComplex(); } 
 
     virtual int VHeight() const override { return height; }
@@ -217,6 +267,9 @@ namespace ngla
     EmbeddedTransposeMatrix (size_t awidth, IntRange arange, shared_ptr<BaseMatrix> amat)
       : width(awidth), range(arange), mat(amat) { ; }
 
+    IntRange GetRange () const { return range; }
+    shared_ptr<BaseMatrix> GetMatrix () const { return mat; }
+
     virtual bool IsComplex() const override { return mat->IsComplex(); } 
 
     virtual BaseMatrix::OperatorInfo GetOperatorInfo () const override;
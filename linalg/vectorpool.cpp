@@ -0,0 +1,145 @@
+/**************************************************************************/
+/* File:   vectorpool.cpp                                                 */
+/**************************************************************************/
+
+#include <la.hpp>
+
+namespace ngla
+{
+
+  // blocks are aligned to cache lines
+  constexpr size_t POOL_ALIGN = 64;
+
+  static void * NewBlock (size_t nbytes)
+  {
+    return ::operator new (nbytes, std::align_val_t(POOL_ALIGN));
+  }
+
+  static void DeleteBlock (void * p)
+  {
+    ::operator delete (p, std::align_val_t(POOL_ALIGN));
+  }
+
+  // zero the block with the static partitioning of the vector operations,
+  // the first touch places the pages on the NUMA node of the thread
+  static void TouchBlock (void * p, size_t nbytes, const Partitioning * part)
+  {
+    char * cp = static_cast<char*> (p);
+    if (nbytes < 65536)
+      {
+        memset (cp, 0, nbytes);
+        return;
+      }
+
+    size_t n = part ? part->Range().Next() : 0;
+    if (n && nbytes % n == 0 && part->Size() >= size_t(TaskManager::GetNumThreads()))
+      {
+        // the tasks of the vector operations and of the matrix rows
+        size_t bs = nbytes / n;
+        ParallelJob ([cp,bs,part] (TaskInfo ti)
+                     {
+                       auto r = (*part)[ti.task_nr];
+                       memset (cp+bs*r.First(), 0, bs*r.Size());
+                     }, part->Size());
+        return;
+      }
+    
+    ParallelForRange (nbytes, [cp] (IntRange r)
+                      {
+                        memset (cp+r.First(), 0, r.Size());
+                      }, TasksPerThread(1));
+  }
+
+
+  VectorPool & VectorPool :: Get ()
+  {
+    // never destroyed, vectors may be freed during static destruction
+    static VectorPool * pool = new VectorPool;
+    return *pool;
+  }
+
+  void * VectorPool :: Alloc (size_t nbytes, bool zero, const Partitioning * part)
+  {
+    if (nbytes == 0) return nullptr;
+
+    void * p = nullptr;
+    {
+      lock_guard<mutex> guard(mtx);
+      inuse += nbytes;
+      ninuse++;
+      auto pos = freeblocks.find (nbytes);
+      if (pos != freeblocks.end() && pos->second.Size())
+        {
+          p = pos->second.Last();
+          pos->second.DeleteLast();
+          cached -= nbytes;
+          ncached--;
+          reused += nbytes;
+          nreused++;
+        }
+    }
+
+    if (p)
+      {
+        if (zero) TouchBlock (p, nbytes, part);
+        return p;
+      }
+
+    static Timer t("VectorPool::Alloc - new block");
+    RegionTimer reg(t);
+    p = NewBlock (nbytes);
+    TouchBlock (p, nbytes, part);
+    return p;
+  }
+
+  void VectorPool :: Free (void * p, size_t nbytes)
+  {
+    if (!p) return;
+    {
+      lock_guard<mutex> guard(mtx);
+      inuse -= nbytes;
+      ninuse--;
+      if (cached + nbytes <= maxcached)
+        {
+          freeblocks[nbytes].Append (p);
+          cached += nbytes;
+          ncached++;
+          return;
+        }
+    }
+    DeleteBlock (p);
+  }
+
+  void VectorPool :: SetMaxCached (size_t amaxcached)
+  {
+    {
+      lock_guard<mutex> guard(mtx);
+      maxcached = amaxcached;
+      if (cached <= maxcached) return;
+    }
+    Clear();
+  }
+
+  void VectorPool :: Clear ()
+  {
+    std::map<size_t, Array<void*>> blocks;
+    {
+      lock_guard<mutex> guard(mtx);
+      swap (blocks, freeblocks);
+      cached = 0;
+      ncached = 0;
+    }
+    for (auto & b : blocks)
+      for (void * p : b.second)
+        DeleteBlock (p);
+  }
+
+  Array<MemoryUsage> VectorPool :: GetMemoryUsage () const
+  {
+    lock_guard<mutex> guard(mtx);
+    return { { "VectorPool, cached", cached, ncached },
+             { "VectorPool, in use", inuse, ninuse },
+             { "VectorPool, reused", reused, nreused } };
+  }
+
+}
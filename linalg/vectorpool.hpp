@@ -0,0 +1,56 @@
+#ifndef FILE_VECTORPOOL
+#define FILE_VECTORPOOL
+
+#include <map>
+
+/**************************************************************************/
+/* File:   vectorpool.hpp                                                 */
+/**************************************************************************/
+
+/*
+  Pool for the memory of vectors.
+
+  Freed blocks are kept up to a limit, and handed out again for requests
+  of the same size. Temporary vectors of matrix compositions and solvers
+  then neither go through malloc nor through the page faults of the first
+  touch again. New blocks are touched in parallel, such that the pages are
+  distributed over the NUMA nodes like the parallel vector operations.
+*/
+
+namespace ngla
+{
+
+  class NGS_DLL_HEADER VectorPool
+  {
+    mutable mutex mtx;
+    /// free blocks, sorted by size in bytes
+    std::map<size_t, Array<void*>> freeblocks;
+    /// maximal number of bytes kept in the pool
+    size_t maxcached = size_t(1) << 30;
+    size_t cached = 0, ncached = 0;
+    size_t inuse = 0, ninuse = 0;
+    size_t reused = 0, nreused = 0;
+
+  public:
+    /// the global pool
+    static VectorPool & Get ();
+
+    /// memory for nbytes, zero-initialized if zero == true.
+    /// new blocks are touched following the partitioning of the entries
+    void * Alloc (size_t nbytes, bool zero = false, const Partitioning * part = nullptr);
+    /// returns the block of nbytes to the pool
+    void Free (void * p, size_t nbytes);
+
+    /// maximal number of cached bytes, 0 disables the pool
+    void SetMaxCached (size_t amaxcached);
+    size_t GetMaxCached () const { return maxcached; }
+    /// releases all cached blocks
+    void Clear ();
+
+    /// cached, used and reused memory
+    Array<MemoryUsage> GetMemoryUsage () const;
+  };
+
+}
+
+#endif
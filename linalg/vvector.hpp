@@ -26,37 +26,56 @@ namespace ngla
       this->entrysize = es * sizeof(TSCAL) / sizeof(double);
     }
 
-    S_BaseVectorPtr (size_t as, int aes)
+    /// memory from the VectorPool, complex vectors are zero-initialized.
+    /// The pages are first touched following the partitioning.
+    S_BaseVectorPtr (size_t as, int aes, shared_ptr<Partitioning> apartition = nullptr)
     {
       this->size = as;
+      this->partition = apartition;
       es = aes;
-      pdata = new TSCAL[as*aes];
+      pdata = AllocData (as*aes);
       ownmem = true;
-      GetMemoryTracer().Alloc(sizeof(TSCAL) * as * aes);
       this->entrysize = es * sizeof(TSCAL) / sizeof(double);
     }
 
     void SetSize (size_t as)
     {
       if (ownmem)
-        {
-          GetMemoryTracer().Free(sizeof(TSCAL) * this->size * es);
-          delete [] pdata;
-        }
+        FreeData ();
       this->size = as;
-      pdata = new TSCAL[as*es];
+      pdata = AllocData (as*es);
       ownmem = true;
-      GetMemoryTracer().Alloc(sizeof(TSCAL) * as * es);
     }
 
     void AssignMemory (size_t as, void * adata)
     {
+      if (ownmem)
+        FreeData ();
+      ownmem = false;
       this->size = as; 
       this->pdata = static_cast<TSCAL*> (adata); 
     }
     
     virtual ~S_BaseVectorPtr ();
 
+  protected:
+    TSCAL * AllocData (size_t n)
+    {
+      GetMemoryTracer().Alloc(sizeof(TSCAL) * n);
+      return static_cast<TSCAL*> (VectorPool::Get().Alloc (sizeof(TSCAL) * n,
+                                                           !is_same<TSCAL,double>::value,
+                                                           this->partition.get()));
+    }
+
+    void FreeData ()
+    {
+      size_t nbytes = sizeof(TSCAL) * this->size * es;
+      GetMemoryTracer().Free(nbytes);
+      VectorPool::Get().Free (pdata, nbytes);
+    }
+
+  public:
+
     virtual void * Memory () const throw() override
     {
       return pdata; 
@@ -150,12 +169,12 @@ namespace ngla
     typedef typename mat_traits<T>::TSCAL TSCAL;
     enum { ES = sizeof(T) / sizeof(TSCAL) };
 
-    explicit VVector (size_t as)
-      : S_BaseVectorPtr<TSCAL> (as, ES) 
+    explicit VVector (size_t as, shared_ptr<Partitioning> apartition = nullptr)
+      : S_BaseVectorPtr<TSCAL> (as, ES, apartition) 
     { ; }
 
     explicit VVector (const VVector & v2)
-      : S_BaseVectorPtr<TSCAL> (v2.Size(), ES)
+      : S_BaseVectorPtr<TSCAL> (v2.Size(), ES, v2.GetPartitioning())
     {
       *this = v2;
     }
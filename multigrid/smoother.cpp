@@ -947,6 +947,152 @@ namespace ngmg
 
 
 
+  ChebyshevSmoother :: 
+  ChebyshevSmoother  (const MeshAccess & ama,
+                      const BilinearForm & abiform, const Flags & aflags)
+    : Smoother(aflags), biform(abiform)
+  {
+    useblocks = flags.GetDefineFlag ("chebyshev_blocks");
+    degree = int(flags.GetNumFlag ("chebyshev_degree", 3));
+    eigratio = flags.GetNumFlag ("chebyshev_ratio", 30);
+    lanczossteps = int(flags.GetNumFlag ("lanczossteps", 10));
+    Update();
+  }
+
+  ChebyshevSmoother :: ~ChebyshevSmoother()
+  { ; }
+  
+  void ChebyshevSmoother :: Update (bool force_update)
+  {
+    static Timer t("ChebyshevSmoother::Update"); RegionTimer reg(t);
+    int level = biform.GetNLevels();
+   
+    if (level < 0) return;
+    if (updateall)
+      {
+	jac.DeleteAll();
+        lmax.DeleteAll();
+      }
+    if (jac.Size() == level && !force_update)
+      return;
+
+    if (useblocks)
+      {
+        if (biform.UsesEliminateInternal())
+          flags.SetFlag("eliminate_internal");
+        
+        while (smoothing_blocks.Size() < level)
+          smoothing_blocks.Append(nullptr);
+        
+        if (!smoothing_blocks.Last())
+          smoothing_blocks.Last() = biform.GetFESpace()->CreateSmoothingBlocks(flags);
+      }
+    
+    while (jac.Size() < level)
+      jac.Append(nullptr);
+    while (lmax.Size() < level)
+      lmax.Append(0);
+
+    int startlevel = updateall ? 1 : level;
+    for (auto lvl : Range(startlevel,level+1))
+      {
+        const BaseSparseMatrix & mat = dynamic_cast<const BaseSparseMatrix&> (biform.GetMatrix(lvl-1));
+        if (useblocks && smoothing_blocks[lvl-1])
+          jac[lvl-1] = mat.CreateBlockJacobiPrecond(smoothing_blocks[lvl-1]);
+        else
+          jac[lvl-1] = mat.CreateJacobiPrecond(biform.GetFESpace()->GetFreeDofs());
+        string name = "ChebyshevSmootherLevel" + ToString(lvl);
+        GetMemoryTracer().Track(*jac[lvl-1], name);
+
+        // a few Lanczos steps for the upper bound, a fixed step estimate
+        EigenSystem eigen(biform.GetMatrix(lvl-1), *jac[lvl-1]);
+        eigen.SetMaxSteps (lanczossteps);
+        eigen.SetPrintWarning (false);
+        eigen.Calc();
+        lmax[lvl-1] = eigen.MaxEigenValue();
+        cout << IM(4) << "Chebyshev smoother, level " << lvl-1
+             << ", estimated lmax = " << lmax[lvl-1] << endl;
+      }
+  }
+
+
+  void ChebyshevSmoother :: Smooth (int level, BaseVector & u, 
+                                    const BaseVector & f) const
+  {
+    static Timer t("ChebyshevSmoother::Smooth"); RegionTimer reg(t);
+
+    const BaseMatrix & mat = biform.GetMatrix(level);
+    const BaseMatrix & pre = *jac[level];
+
+    // safety factor for the Lanczos estimate
+    double lmin = lmax[level] / eigratio;
+    double lupper = 1.1 * lmax[level];
+    double theta = 0.5 * (lupper + lmin);
+    double delta = 0.5 * (lupper - lmin);
+    double sigma = theta / delta;
+    double rho = 1 / sigma;
+
+    auto r = f.CreateVector();
+    auto d = f.CreateVector();
+
+    *r = f - mat * u;
+    *d = pre * *r;
+    *d *= 1/theta;
+
+    for (int k = 1; k <= degree; k++)
+      {
+        u += *d;
+        if (k == degree) break;
+
+        mat.MultAdd (-1, *d, *r);
+        double rhonew = 1 / (2*sigma - rho);
+        *d *= rhonew * rho;
+        pre.MultAdd (2*rhonew/delta, *r, *d);
+        rho = rhonew;
+      }
+  }
+
+  void ChebyshevSmoother :: PreSmooth (int level, BaseVector & u, 
+                                       const BaseVector & f, int steps) const
+  {
+    for (int i = 0; i < steps; i++)
+      Smooth (level, u, f);
+  }
+
+  void ChebyshevSmoother :: PostSmooth (int level, BaseVector & u, 
+                                        const BaseVector & f, int steps) const
+  {
+    for (int i = 0; i < steps; i++)
+      Smooth (level, u, f);
+  }
+  
+  void ChebyshevSmoother :: Residuum (int level, BaseVector & u, 
+                                      const BaseVector & f, 
+                                      BaseVector & d) const
+  {
+    d = f - biform.GetMatrix (level) * u;
+  }
+  
+  AutoVector ChebyshevSmoother :: CreateVector(int level) const
+  {
+    return biform.GetMatrix(level).CreateColVector();
+  }
+
+  Array<MemoryUsage> ChebyshevSmoother :: GetMemoryUsage () const
+  {
+    Array<MemoryUsage> mu;
+    for (int i = 0; i < jac.Size(); i++)
+      if (jac[i]) mu += jac[i]->GetMemoryUsage ();
+    return mu;
+  }
+
+
+
+
+
+
+
+
 
 
 #ifdef XXX_OBSOLTE
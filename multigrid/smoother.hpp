@@ -223,6 +223,66 @@ namespace ngmg
 
 
 
+  /**
+     Chebyshev-accelerated (block-)Jacobi smoother.
+     The largest eigenvalue of the Jacobi-preconditioned matrix is
+     estimated by a few Lanczos steps at setup, the smoothing interval
+     is [lmax/chebyshev_ratio, 1.1*lmax]. No coloring is needed.
+  */
+  class ChebyshevSmoother : public Smoother
+  {
+    ///
+    const BilinearForm & biform;
+    /// point or block Jacobi preconditioner for every level
+    Array<shared_ptr<BaseMatrix>> jac;
+    /// estimated largest eigenvalue for every level
+    Array<double> lmax;
+    ///
+    Array<shared_ptr<Table<int>>> smoothing_blocks;
+    /// use FESpace smoothing blocks instead of point Jacobi
+    bool useblocks;
+    /// polynomial degree of one smoothing step
+    int degree;
+    /// lmax / lmin 
+    double eigratio;
+    /// steps for lmax estimation
+    int lanczossteps;
+
+  public:
+    ///
+    ChebyshevSmoother (const MeshAccess & ama,
+                       const BilinearForm & abiform, const Flags & aflags);
+    ///
+    virtual ~ChebyshevSmoother();
+  
+    ///
+    virtual void Update (bool force_update = 0);
+    ///
+    virtual void PreSmooth (int level, BaseVector & u, 
+			    const BaseVector & f, int steps) const;
+    ///
+    virtual void PostSmooth (int level, BaseVector & u, 
+			     const BaseVector & f, int steps) const;
+    ///
+    virtual void Residuum (int level, BaseVector & u, 
+			   const BaseVector & f, BaseVector & d) const;
+    ///
+    virtual AutoVector CreateVector(int level) const;
+
+    virtual Array<MemoryUsage> GetMemoryUsage () const;
+
+    /// estimated largest eigenvalue of the preconditioned matrix on level
+    double GetMaxEigenValue (int level) const { return lmax[level]; }
+
+  private:
+    /// one Chebyshev sweep of given degree
+    void Smooth (int level, BaseVector & u, const BaseVector & f) const;
+  };
+
+
+
+
+
 #ifdef XXX_OBSOLETE
   /**
      Matrix - vector multiplication by smoothing step.
@@ -18,9 +18,9 @@ from pyngcore import BitArray, TaskManager, SetNumThreads, PajeTrace
 from .ngstd import Timers, Timer, IntRange
 from .bla import Matrix, Vector, InnerProduct, Norm
 from .la import BaseMatrix, BaseVector, BlockVector, MultiVector, BlockMatrix, \
-    CreateVVector, CGSolver, QMRSolver, GMRESSolver, ArnoldiSolver, \
-    Projector, IdentityMatrix, Embedding, PermutationMatrix, \
-    ConstEBEMatrix, ParallelMatrix, PARALLEL_STATUS
+    CreateVVector, CGSolver, QMRSolver, GMRESSolver, DeflatedCGSolver, GCRODRSolver, ArnoldiSolver, \
+    KrylovSchurSolver, MultiShiftSolver, Projector, IdentityMatrix, Embedding, PermutationMatrix, \
+    ConstEBEMatrix, ParallelMatrix, FuseOperator, PARALLEL_STATUS
 from .fem import BFI, LFI, CoefficientFunction, Parameter, ParameterC, ET, \
     POINT, SEGM, TRIG, QUAD, TET, PRISM, PYRAMID, HEX, CELL, FACE, EDGE, \
     VERTEX, FACET, ELEMENT, sin, cos, tan, atan, acos, asin, sinh, cosh, \
@@ -68,3 +68,30 @@ def test_derive_basematrix_lifetime():
 
 
 
+
+def test_fuse_operator():
+    from netgen.geom2d import unit_square
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=2, dirichlet=".*")
+    u,v = fes.TnT()
+    a = BilinearForm(grad(u)*grad(v)*dx).Assemble()
+    b = BilinearForm(u*v*dx).Assemble()
+    n = fes.ndof
+
+    perm = PermutationMatrix(n, list(reversed(range(n))))
+    proj = Projector(fes.FreeDofs(), True)
+    emb = Embedding(n+3, IntRange(2, n+2))
+    op = emb @ (proj @ perm @ a.mat @ perm.T @ proj + 2*b.mat.T - proj) @ emb.T
+
+    fused = FuseOperator(op)
+    assert fused.nfused == 2
+    assert fused.nother == 1
+
+    x = op.CreateRowVector()
+    x.SetRandom()
+    y1 = op.CreateColVector()
+    y2 = op.CreateColVector()
+    y1.data = op * x
+    y2.data = fused * x
+    y2.data -= y1
+    assert Norm(y2) < 1e-12 * Norm(y1)
@@ -99,6 +99,31 @@ def test_SurfaceGetFE(quads=False):
                         assert space.GetFE(el).ndof == len(space.GetDofNrs(el)), [spacename,vb,order]
     return
 
+@pytest.mark.parametrize("reorder", ["rcm", "hilbert"])
+def test_reorder(reorder):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=3, dirichlet="left|bottom")
+    refes = Reorder(fes, reorder=reorder)
+
+    def solve(V):
+        u,v = V.TnT()
+        a = BilinearForm(V, symmetric=True)
+        a += grad(u)*grad(v)*dx
+        f = LinearForm(V)
+        f += x*v*dx
+        a.Assemble()
+        f.Assemble()
+        gfu = GridFunction(V)
+        gfu.vec.data = a.mat.Inverse(V.FreeDofs()) * f.vec
+        rows,cols,vals = a.mat.COO()
+        return gfu, max(abs(r-c) for r,c in zip(rows,cols))
+
+    gfu, bw = solve(fes)
+    regfu, rebw = solve(refes)
+    assert Integrate((gfu-regfu)**2, mesh) < 1e-20
+    if reorder == "rcm":
+        assert rebw < bw
+
 if __name__ == "__main__":
     test_2DGetFE(quads=False)
     test_2DGetFE(quads=True)
@@ -99,6 +99,366 @@ def test_sparsematrix_access():
     a.Assemble()
     assert abs(a.mat[1,1][0,0] - (reference_values[3])) < 1e-8
 
+@pytest.mark.parametrize("symmetric", [True, False])
+def test_sparsematrix_binary(tmpdir, symmetric):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = VectorH1(mesh, order=2)
+    u,v = fes.TnT()
+    a = BilinearForm(fes, symmetric=symmetric)
+    a += InnerProduct(Grad(u),Grad(v))*dx
+    a.Assemble()
+    x = a.mat.CreateColVector()
+    x.FV().NumPy()[:] = np.random.rand(len(x))
+
+    la.SaveBinary(a.mat, str(tmpdir.join("mat.bin")))
+    la.SaveBinary(x, str(tmpdir.join("vec.bin")))
+    for copy in [False, True]:
+        mat = la.LoadBinaryMatrix(str(tmpdir.join("mat.bin")), copy=copy)
+        vec = la.LoadBinaryVector(str(tmpdir.join("vec.bin")), copy=copy)
+        assert mat.nze == a.mat.nze
+        assert np.array_equal(vec.FV().NumPy(), x.FV().NumPy())
+        y = vec.CreateVector()
+        y.data = mat*vec - a.mat*x
+        assert Norm(y) < 1e-12 * Norm(x)
+
+    # corrupted files are rejected before the data is used
+    data = bytearray(open(str(tmpdir.join("mat.bin")), "rb").read())
+    offset_colnr = int.from_bytes(data[64:72], "little")
+    offset_last = offset_colnr + 4*(a.mat.nze-2)
+    swapped = data[offset_last+4:offset_last+8] + data[offset_last:offset_last+4]
+    for pos, value in [(72, (1 << 62).to_bytes(8, "little")),       # offset_values
+                       (offset_colnr, (1 << 30).to_bytes(4, "little")),  # colnr[0]
+                       (offset_last, swapped)]:                      # last two colnr of the last row
+        corrupt = bytearray(data)
+        corrupt[pos:pos+len(value)] = value
+        open(str(tmpdir.join("corrupt.bin")), "wb").write(corrupt)
+        with pytest.raises(Exception):
+            la.LoadBinaryMatrix(str(tmpdir.join("corrupt.bin")))
+
+def test_symmetric_multadd():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=3)
+    u,v = fes.TnT()
+    mats = []
+    for symmetric in [True, False]:
+        a = BilinearForm(fes, symmetric=symmetric)
+        a += grad(u)*grad(v)*dx + u*v*dx
+        a.Assemble()
+        mats.append(a.mat)
+    x = mats[0].CreateColVector()
+    x.FV().NumPy()[:] = np.random.rand(len(x))
+    y0 = x.CreateVector()
+    y1 = x.CreateVector()
+    with TaskManager():
+        y0.data = mats[0]*x
+        y1.data = mats[1]*x
+    y0 -= y1
+    assert Norm(y0) < 1e-12 * Norm(y1)
+
+def test_sparsematrix_transpose():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=3)
+    u,v = fes.TnT()
+    a = BilinearForm(fes)
+    a += grad(u)*grad(v)*dx + (CF((1,2))*grad(u))*v*dx
+    a.Assemble()
+    x = a.mat.CreateColVector()
+    x.FV().NumPy()[:] = np.random.rand(len(x))
+    y0 = x.CreateVector()
+    y1 = x.CreateVector()
+    with TaskManager():
+        at = a.mat.CreateTranspose()
+        y0.data = at*x
+        y1.data = a.mat.T*x
+    y0 -= y1
+    assert Norm(y0) < 1e-12 * Norm(y1)
+
+@pytest.mark.parametrize("symmetric", [False, True])
+def test_restrict(symmetric):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=2)
+    u,v = fes.TnT()
+    a = BilinearForm(fes, symmetric=symmetric)
+    a += grad(u)*grad(v)*dx + u*v*dx
+    a.Assemble()
+
+    # a prolongation with two random weights per fine dof
+    n = fes.ndof
+    nc = n // 3
+    rows = [i for i in range(n) for k in range(2)]
+    cols = [(i//3 + k) % nc for i in range(n) for k in range(2)]
+    vals = list(np.random.rand(2*n))
+    prol = la.SparseMatrixd.CreateFromCOO(rows, cols, vals, n, nc)
+
+    with TaskManager():
+        ac = a.mat.Restrict(prol)
+    xc = ac.CreateColVector()
+    xc.FV().NumPy()[:] = np.random.rand(nc)
+    y0 = xc.CreateVector()
+    y1 = xc.CreateVector()
+    y0.data = ac * xc
+    y1.data = prol.T * (a.mat * (prol * xc))
+    y0 -= y1
+    assert Norm(y0) < 1e-12 * Norm(y1)
+
+    # the explicit transpose has sorted rows and the same action
+    prolt = prol.CreateTranspose()
+    ri, ci, _ = prolt.COO()
+    ri, ci = np.array(ri), np.array(ci)
+    same_row = ri[1:] == ri[:-1]
+    assert np.all(ci[1:][same_row] > ci[:-1][same_row])
+    x = a.mat.CreateColVector()
+    x.FV().NumPy()[:] = np.random.rand(n)
+    y0.data = prolt * x
+    y1.data = prol.T * x
+    y0 -= y1
+    assert Norm(y0) < 1e-12 * Norm(y1)
+
+def test_matrixgraph_symmetric():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=3)
+    u,v = fes.TnT()
+    patterns = []
+    for symmetric in [True, False]:
+        a = BilinearForm(fes, symmetric=symmetric)
+        a += u*v*dx
+        with TaskManager():
+            a.Assemble()
+        rows,cols,vals = a.mat.COO()
+        patterns.append(set((r,c) for r,c in zip(rows,cols) if c <= r))
+    assert patterns[0] == patterns[1]
+    assert all((i,i) in patterns[0] for i in range(fes.ndof))
+
+def test_shared_graph():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=2)
+    u,v = fes.TnT()
+    for l in range(2):
+        m = BilinearForm(u*v*dx).Assemble()
+        k = BilinearForm(grad(u)*grad(v)*dx).Assemble()
+        assert m.mat.nze == k.mat.nze
+        # the column indices are one array
+        colnr = lambda mat: np.asarray(mat.CSR()[1]).ctypes.data
+        assert colnr(m.mat) == colnr(k.mat)
+        x = k.mat.CreateColVector()
+        x.SetRandom()
+        y = x.CreateVector()
+        # same graph, but the values are not shared
+        fes2 = H1(mesh, order=2)
+        m2 = BilinearForm(fes2.TrialFunction()*fes2.TestFunction()*dx).Assemble()
+        y.data = m.mat * x - m2.mat * x
+        assert Norm(y) < 1e-12 * Norm(x)
+        # a different space with other element tables gets its own graph
+        fes3 = H1(mesh, order=3)
+        m3 = BilinearForm(fes3.TrialFunction()*fes3.TestFunction()*dx).Assemble()
+        assert colnr(m3.mat) != colnr(m.mat)
+        mesh.Refine()
+        fes.Update()
+
+@pytest.mark.parametrize("symmetric", [True, False])
+def test_store_positions(symmetric):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=3, dirichlet="left")
+    u,v = fes.TnT()
+    coef = Parameter(1)
+    integrand = coef*grad(u)*grad(v)*dx + u*v*ds
+    a = BilinearForm(fes, symmetric=symmetric, store_positions=True)
+    a += integrand
+    b = BilinearForm(fes, symmetric=symmetric)
+    b += integrand
+    for c in [1, 2]:
+        coef.Set(c)
+        with TaskManager():
+            a.Assemble()
+            b.Assemble()
+        diff = a.mat.AsVector().CreateVector()
+        diff.data = a.mat.AsVector() - b.mat.AsVector()
+        assert Norm(diff) < 1e-12 * Norm(b.mat.AsVector())
+
+@pytest.mark.parametrize("symmetric", [True, False])
+def test_masked_matrix(symmetric):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=2, dirichlet="left|bottom")
+    u,v = fes.TnT()
+    a = BilinearForm(grad(u)*grad(v)*dx + (CF((1,2))*grad(u))*v*dx, symmetric=symmetric).Assemble()
+    fd = fes.FreeDofs()
+    proj = Projector(fd, True)
+    pmat = proj @ a.mat @ proj
+    from ngsolve.la import MaskedMatrix
+    assert isinstance(pmat, MaskedMatrix)
+    x = a.mat.CreateColVector()
+    x.SetRandom()
+    y0 = x.CreateVector()
+    y1 = x.CreateVector()
+    y2 = x.CreateVector()
+    with TaskManager():
+        y0.data = pmat * x
+        y1.data = proj * x
+        y2.data = a.mat * y1
+        y1.data = proj * y2
+        y0 -= y1
+        assert Norm(y0) < 1e-12 * Norm(y1)
+        # only the dirichlet rows
+        y0.data = Projector(fd, False) @ a.mat * x
+        y1.data = a.mat * x
+        y2.data = Projector(fd, False) * y1
+        y0 -= y2
+        assert Norm(y0) < 1e-12 * Norm(y2)
+        # transpose, the convection term makes the matrix non-symmetric
+        y0.data = pmat.T * x
+        y1.data = proj * x
+        y2.data = a.mat.T * y1
+        y1.data = proj * y2
+        y0 -= y1
+        assert Norm(y0) < 1e-12 * Norm(y1)
+
+def test_paired_sparse_matrix():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=2)
+    u,v = fes.TnT()
+    k = BilinearForm(grad(u)*grad(v)*dx).Assemble()
+    m = BilinearForm(u*v*dx).Assemble()
+    omega = 3.0
+    from ngsolve.la import PairedSparseMatrix
+    op = PairedSparseMatrix(k.mat, m.mat, 1j*omega)
+    assert op.samegraph
+    xr = np.random.rand(fes.ndof)
+    xi = np.random.rand(fes.ndof)
+    x = op.CreateRowVector()
+    x.FV().NumPy()[:] = xr + 1j*xi
+    y = op.CreateColVector()
+    with TaskManager():
+        y.data = op * x
+    vr = k.mat.CreateColVector()
+    hv = k.mat.CreateColVector()
+    ref = np.zeros(fes.ndof, dtype=complex)
+    for part, scal in [(xr, 1), (xi, 1j)]:
+        vr.FV().NumPy()[:] = part
+        hv.data = k.mat * vr
+        ref += scal * hv.FV().NumPy()
+        hv.data = m.mat * vr
+        ref += scal * 1j*omega * hv.FV().NumPy()
+    assert np.linalg.norm(y.FV().NumPy() - ref) < 1e-12 * np.linalg.norm(ref)
+
+    # a second matrix with a different graph (diagonal)
+    diag = np.random.rand(fes.ndof)
+    d = la.SparseMatrixd.CreateFromCOO(list(range(fes.ndof)), list(range(fes.ndof)), list(diag),
+                                       fes.ndof, fes.ndof)
+    op = PairedSparseMatrix(k.mat, d, 1j*omega)
+    assert not op.samegraph
+    with TaskManager():
+        y.data = op * x
+    ref = np.zeros(fes.ndof, dtype=complex)
+    for part, scal in [(xr, 1), (xi, 1j)]:
+        vr.FV().NumPy()[:] = part
+        hv.data = k.mat * vr
+        ref += scal * hv.FV().NumPy()
+    ref += 1j*omega * diag * (xr + 1j*xi)
+    assert np.linalg.norm(y.FV().NumPy() - ref) < 1e-12 * np.linalg.norm(ref)
+
+def test_real_matrix_complex_vector():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=3)
+    fesc = H1(mesh, order=3, complex=True)
+    integrand = lambda u, v: grad(u)*grad(v)*dx + (CF((1,2))*grad(u))*v*dx
+    a = BilinearForm(integrand(*fes.TnT())).Assemble()
+    # real matrix for complex vectors
+    ac = BilinearForm(fesc, real=True)
+    ac += integrand(*fesc.TnT())
+    ac.Assemble()
+
+    xr = np.random.rand(fes.ndof)
+    xi = np.random.rand(fes.ndof)
+    x = ac.mat.CreateColVector()
+    x.FV().NumPy()[:] = xr + 1j*xi
+    y = x.CreateVector()
+    vr = a.mat.CreateColVector()
+    hv = a.mat.CreateColVector()
+    ref = np.zeros(fes.ndof, dtype=complex)
+    for part, scal in [(xr, 1), (xi, 1j)]:
+        vr.FV().NumPy()[:] = part
+        hv.data = a.mat * vr
+        ref += scal * hv.FV().NumPy()
+
+    with TaskManager():
+        y.data = ac.mat * x
+    assert np.linalg.norm(y.FV().NumPy() - ref) < 1e-12 * np.linalg.norm(ref)
+    with TaskManager():
+        y.data += (2-1j) * ac.mat * x
+    assert np.linalg.norm(y.FV().NumPy() - (3-1j)*ref) < 1e-12 * np.linalg.norm(ref)
+
+def test_simd_ebe():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=4)
+    u,v = fes.TnT()
+    coef = Parameter(1)
+    integrand = coef*grad(u)*grad(v)*dx + u*v*dx
+    a = BilinearForm(fes, condense=True, store_inner=True, simd_ebe=True)
+    a += integrand
+    aref = BilinearForm(fes, condense=True, store_inner=True)
+    aref += integrand
+    b = BilinearForm(fes)
+    b += integrand
+
+    local = BitArray(fes.ndof)
+    local.Clear()
+    for i in range(fes.ndof):
+        if fes.CouplingType(i) == COUPLING_TYPE.LOCAL_DOF:
+            local.Set(i)
+    proj = Projector(local, True)
+
+    for c in [1, 2]:
+        # the second assembly writes into the SIMD layout
+        coef.Set(c)
+        with TaskManager():
+            a.Assemble()
+            aref.Assemble()
+            b.Assemble()
+        x = b.mat.CreateColVector()
+        x.SetRandom()
+        y = x.CreateVector()
+        yref = x.CreateVector()
+        with TaskManager():
+            # inner dofs couple within one element only
+            y.data = a.inner_matrix * x
+            yref.data = proj @ b.mat @ proj * x
+            y -= yref
+            assert Norm(y) < 1e-10 * Norm(yref)
+            for op, opref in [(a.harmonic_extension, aref.harmonic_extension),
+                              (a.harmonic_extension_trans, aref.harmonic_extension_trans),
+                              (a.inner_solve, aref.inner_solve)]:
+                y.data = op * x
+                yref.data = opref * x
+                y -= yref
+                assert Norm(y) < 1e-10 * Norm(yref)
+                y.data = op.T * x
+                yref.data = opref.T * x
+                y -= yref
+                assert Norm(y) < 1e-10 * Norm(yref)
+
+def test_sparsematrix_dynamic_blocks():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    bs = 3
+    dnums, elmats = [], []
+    for el in mesh.Elements(VOL):
+        dnums.append([bs*v.nr+k for v in el.vertices for k in range(bs)])
+        elmats.append(Matrix(np.random.rand(3*bs, 3*bs)))
+    n = bs*mesh.nv
+    mat = la.SparseMatrixd.CreateFromElmat(dnums, dnums, elmats, n, n)
+    dyn = la.SparseMatrixDynamic(mat, blocksize=0)
+    assert dyn.entrysizes == (bs, bs)
+    # vectors of the block matrix have entry size bs
+    xb = dyn.CreateRowVector()
+    yb = dyn.CreateColVector()
+    x = mat.CreateColVector()
+    y = mat.CreateColVector()
+    x.FV().NumPy()[:] = np.random.rand(n)
+    xb.FV().NumPy()[:] = x.FV().NumPy()
+    with TaskManager():
+        yb.data = dyn*xb
+        y.data = mat*x
+    assert np.linalg.norm(yb.FV().NumPy()-y.FV().NumPy()) < 1e-12 * Norm(y)
+
 if __name__ == "__main__":
     test_matrix()
     test_matrix_numpy()
@@ -42,6 +42,189 @@ def test_arnoldi():
 
     Draw(laplace(evec),mesh,"laplace")
 
+def test_krylovschur():
+    from math import pi
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=2, dirichlet="top|bottom|left|right")
+    u,v = fes.TnT()
+    a = BilinearForm(fes)
+    a += grad(u)*grad(v)*dx
+    m = BilinearForm(fes)
+    m += u*v*dx
+    a.Assemble()
+    m.Assemble()
+
+    # small Krylov space forces several thick restarts
+    lam, evecs = KrylovSchurSolver(a.mat, m.mat, fes.FreeDofs(), nev=4, shift=10,
+                                   maxdim=12, tol=1e-10, maxiter=200)
+    exact = [2*pi**2, 5*pi**2, 5*pi**2, 8*pi**2]
+    for l, ex in zip(sorted(lam), exact):
+        assert abs(l-ex) < 1e-2 * ex
+
+    proj = Projector(fes.FreeDofs(), True)
+    res = evecs[0].CreateVector()
+    ax = evecs[0].CreateVector()
+    for i in range(len(lam)):
+        ax.data = a.mat * evecs[i]
+        res.data = proj * (ax - lam[i] * m.mat * evecs[i])
+        assert Norm(res) < 1e-6 * Norm(ax)
+
+def test_lobpcg():
+    from math import pi
+    from ngsolve.la import LOBPCG
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=2, dirichlet="top|bottom|left|right")
+    u,v = fes.TnT()
+    a = BilinearForm(fes)
+    a += grad(u)*grad(v)*dx
+    m = BilinearForm(fes)
+    m += u*v*dx
+    a.Assemble()
+    m.Assemble()
+
+    pre = a.mat.Inverse(fes.FreeDofs())
+    vecs = MultiVector(a.mat.CreateColVector(), 4)
+    for i in range(4):
+        vecs[i].SetRandom()
+        vecs[i].data = pre * vecs[i]
+    lam = LOBPCG(a.mat, m.mat, pre, vecs, tol=1e-10, maxit=50)
+    exact = [2*pi**2, 5*pi**2, 5*pi**2, 8*pi**2]
+    for l, ex in zip(lam, exact):
+        assert abs(l-ex) < 1e-2 * ex
+
+    proj = Projector(fes.FreeDofs(), True)
+    res = vecs[0].CreateVector()
+    ax = vecs[0].CreateVector()
+    for i in range(4):
+        ax.data = a.mat * vecs[i]
+        res.data = proj * (ax - lam[i] * m.mat * vecs[i])
+        assert Norm(res) < 1e-6 * Norm(ax)
+
+def test_lobpcg_freedofs():
+    from math import pi
+    from ngsolve.la import LOBPCG
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=2, dirichlet="top|bottom|left|right")
+    u,v = fes.TnT()
+    a = BilinearForm(fes)
+    a += grad(u)*grad(v)*dx
+    m = BilinearForm(fes)
+    m += u*v*dx
+    a.Assemble()
+    m.Assemble()
+
+    # neither the initial vectors nor the preconditioner respect the Dirichlet dofs
+    pre = a.mat.CreateSmoother()
+    vecs = MultiVector(a.mat.CreateColVector(), 4)
+    for i in range(4):
+        vecs[i].SetRandom()
+    tol = 1e-8
+    lam = LOBPCG(a.mat, m.mat, pre, vecs, tol=tol, maxit=300, freedofs=fes.FreeDofs())
+    exact = [2*pi**2, 5*pi**2, 5*pi**2, 8*pi**2]
+    for l, ex in zip(lam, exact):
+        assert abs(l-ex) < 2e-2 * ex
+
+    # converged before maxit: all residuals are below tol
+    proj = Projector(fes.FreeDofs(), True)
+    res = vecs[0].CreateVector()
+    ax = vecs[0].CreateVector()
+    mx = vecs[0].CreateVector()
+    for i in range(4):
+        ax.data = a.mat * vecs[i]
+        mx.data = m.mat * vecs[i]
+        res.data = proj * (ax - lam[i] * mx)
+        assert Norm(res) <= 2 * tol * (Norm(ax) + lam[i] * Norm(mx))
+
+def test_recycling_solvers():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.05))
+    fes = H1(mesh, order=2, dirichlet="top|bottom|left|right")
+    u,v = fes.TnT()
+    a = BilinearForm(fes)
+    a += grad(u)*grad(v)*dx
+    a.Assemble()
+    jacobi = a.mat.CreateSmoother(fes.FreeDofs())
+    proj = Projector(fes.FreeDofs(), True)
+
+    rhs = [x*y, sin(3*x)*y, (1+x)*(1-y)]
+    for solvertype, kwargs in [(DeflatedCGSolver, { "ndefl" : 8 }),
+                               (GCRODRSolver, { "restart" : 40, "nrecycle" : 10 })]:
+        solver = solvertype(a.mat, jacobi, printrates=False, precision=1e-10, maxsteps=1000, **kwargs)
+        steps = []
+        for cf in rhs:
+            f = LinearForm(fes)
+            f += cf*v*dx
+            f.Assemble()
+            gfu = GridFunction(fes)
+            gfu.vec.data = solver * f.vec
+            steps.append(solver.GetSteps())
+            res = f.vec.CreateVector()
+            res.data = proj * (f.vec - a.mat * gfu.vec)
+            assert Norm(res) < 1e-7 * Norm(f.vec)
+        # the recycled space reduces the iteration count of the following solves
+        assert steps[2] < steps[0]
+
+def test_sparsecholesky_mixed():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.05))
+    fes = H1(mesh, order=3, dirichlet="left|bottom")
+    u,v = fes.TnT()
+    a = BilinearForm(fes, symmetric=True)
+    a += grad(u)*grad(v)*dx + u*v*dx
+    a.Assemble()
+    f = LinearForm(fes)
+    f += x*y*v*dx
+    f.Assemble()
+
+    inv = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky_mixed")
+    assert isinstance(inv, la.MixedPrecisionInverse)
+    gfu = GridFunction(fes)
+    gfu.vec.data = inv * f.vec
+    assert inv.steps < 10
+
+    gfu2 = GridFunction(fes)
+    gfu2.vec.data = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky") * f.vec
+    gfu2.vec -= gfu.vec
+    assert Norm(gfu2.vec) < 1e-10 * Norm(gfu.vec)
+
+def test_multishift():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=2, dirichlet="left|right|top|bottom")
+    u,v = fes.TnT()
+    k = BilinearForm(grad(u)*grad(v)*dx).Assemble()
+    m = BilinearForm(u*v*dx).Assemble()
+    f = LinearForm(x*y*v*dx).Assemble()
+
+    shifts = [1, 2, 4, 6, 9, 12]
+    sols = MultiShiftSolver(k.mat, m.mat, f.vec, shifts, fes.FreeDofs(),
+                            nanchors=2, tol=1e-12)
+    assert len(sols) == len(shifts)
+
+    mat = k.mat.CreateMatrix()
+    diff = f.vec.CreateVector()
+    for s, sol in zip(shifts, sols):
+        mat.AsVector().data = k.mat.AsVector() - s * m.mat.AsVector()
+        diff.data = mat.Inverse(fes.FreeDofs()) * f.vec
+        diff -= sol
+        assert Norm(diff) < 1e-8 * Norm(sol)
+
+def test_multishift_scaled_rhs():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=2, dirichlet="left|right|top|bottom")
+    u,v = fes.TnT()
+    k = BilinearForm(grad(u)*grad(v)*dx).Assemble()
+    m = BilinearForm(u*v*dx).Assemble()
+    f = LinearForm(x*y*v*dx).Assemble()
+
+    # the breakdown test must not depend on the scale of the rhs
+    shifts = [1, 4, 9]
+    sols = MultiShiftSolver(k.mat, m.mat, f.vec, shifts, fes.FreeDofs(), tol=1e-12)
+    f.vec.data *= 1e12
+    sols_scaled = MultiShiftSolver(k.mat, m.mat, f.vec, shifts, fes.FreeDofs(), tol=1e-12)
+
+    diff = f.vec.CreateVector()
+    for sol, sol_scaled in zip(sols, sols_scaled):
+        diff.data = sol_scaled - 1e12 * sol
+        assert Norm(diff) < 1e-8 * Norm(sol_scaled)
+
 def test_newton_with_dirichlet():
     mesh = Mesh (unit_square.GenerateMesh(maxh=0.3))
     V = H1(mesh, order=3, dirichlet=[1,2,3,4])
@@ -53,6 +236,137 @@ def test_newton_with_dirichlet():
     dirichlet.Set(0)
     newton = solvers.Newton(a, gfu, dirichletvalues=dirichlet.vec)
 
+def test_blockjacobi_equal_blocks():
+    np = pytest.importorskip("numpy")
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=3)
+    u,v = fes.TnT()
+    a = BilinearForm(fes, symmetric=False)
+    a += (grad(u) * grad(v) + u*v)*dx
+    a.Assemble()
+
+    # many blocks of the same size, processed SIMD-batched
+    blocks = [list(fes.GetDofNrs(edge)) for edge in mesh.edges]
+    blocks += [list(fes.GetDofNrs(vertex)) for vertex in mesh.vertices]
+    pre = a.mat.CreateBlockSmoother(blocks)
+
+    rows,cols,vals = a.mat.COO()
+    dense = np.zeros((fes.ndof, fes.ndof))
+    dense[np.array(rows), np.array(cols)] = np.array(vals)
+
+    x = a.mat.CreateColVector()
+    x.FV().NumPy()[:] = np.random.rand(fes.ndof)
+    y = x.CreateVector()
+    y.data = pre * x
+
+    xnp = x.FV().NumPy()
+    ynp = np.zeros(fes.ndof)
+    for block in blocks:
+        ynp[block] += np.linalg.solve(dense[np.ix_(block,block)], xnp[block])
+    assert np.linalg.norm(y.FV().NumPy() - ynp) < 1e-10 * np.linalg.norm(ynp)
+
+    yt = x.CreateVector()
+    yt.data = pre.T * x
+    ynp[:] = 0
+    for block in blocks:
+        ynp[block] += np.linalg.solve(dense[np.ix_(block,block)].T, xnp[block])
+    assert np.linalg.norm(yt.FV().NumPy() - ynp) < 1e-10 * np.linalg.norm(ynp)
+
+def test_multigrid_chebyshev_smoother():
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.3))
+    fes = H1(mesh, order=1, dirichlet="left|right|top|bottom")
+    u,v = fes.TnT()
+    a = BilinearForm(fes)
+    a += grad(u) * grad(v)*dx
+    f = LinearForm(fes)
+    f += v*dx
+    c = Preconditioner(a, "multigrid", smoother="chebyshev")
+    a.Assemble()
+    for l in range(3):
+        mesh.Refine()
+        fes.Update()
+        a.Assemble()
+    f.Assemble()
+
+    inv = CGSolver(a.mat, c.mat, precision=1e-10, printrates=False)
+    gfu = GridFunction(fes)
+    gfu.vec.data = inv * f.vec
+    assert inv.GetSteps() < 30
+    proj = Projector(fes.FreeDofs(), True)
+    res = f.vec.CreateVector()
+    res.data = proj * (f.vec - a.mat * gfu.vec)
+    assert Norm(res) < 1e-8 * Norm(f.vec)
+
+def test_saamg_elasticity():
+    from netgen.csg import unit_cube
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.15))
+    fes = H1(mesh, order=1, dim=3, dirichlet="left")
+    u,v = fes.TnT()
+    a = BilinearForm(fes)
+    a += (2*InnerProduct(Sym(Grad(u)), Sym(Grad(v))) + Trace(Grad(u))*Trace(Grad(v))) * dx
+    f = LinearForm(fes)
+    f += CoefficientFunction((0,0,-1)) * v * dx
+    c = Preconditioner(a, "saamg", coarsesize=50)
+    a.Assemble()
+    f.Assemble()
+
+    inv = CGSolver(a.mat, c.mat, precision=1e-8, maxsteps=200, printrates=False)
+    gfu = GridFunction(fes)
+    gfu.vec.data = inv * f.vec
+    assert inv.GetSteps() < 100
+    proj = Projector(fes.FreeDofs(), True)
+    res = f.vec.CreateVector()
+    res.data = proj * (f.vec - a.mat * gfu.vec)
+    assert Norm(res) < 1e-6 * Norm(f.vec)
+
+def test_saamg_scaling():
+    from netgen.csg import unit_cube
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=1, dim=3, dirichlet="left")
+    u,v = fes.TnT()
+    aggregates = []
+    for E in [1, 1e10]:
+        a = BilinearForm(fes)
+        a += E * (2*InnerProduct(Sym(Grad(u)), Sym(Grad(v))) + Trace(Grad(u))*Trace(Grad(v))) * dx
+        c = Preconditioner(a, "saamg", coarsesize=50)
+        a.Assemble()
+        aggregates.append (c.mat.aggregates)
+    # the strength of connection does not depend on the scaling
+    assert aggregates[0] == aggregates[1]
+    assert len(set(aggregates[0])) < len(aggregates[0]) / 2
+
+def test_blockjacobi_equal_blocks_gssmooth():
+    np = pytest.importorskip("numpy")
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.2))
+    # the complex matrix has the same values, its smoother uses the scalar block path
+    mats = []
+    for cplx in [False, True]:
+        fes = H1(mesh, order=3, complex=cplx)
+        u,v = fes.TnT()
+        a = BilinearForm(fes, symmetric=False)
+        a += (grad(u) * grad(v) + u*v)*dx
+        a.Assemble()
+        mats.append(a.mat)
+
+    blocks = [list(fes.GetDofNrs(edge)) for edge in mesh.edges]
+    blocks += [list(fes.GetDofNrs(vertex)) for vertex in mesh.vertices]
+    f = np.random.rand(fes.ndof)
+
+    results = []
+    for mat in mats:
+        pre = mat.CreateBlockSmoother(blocks)
+        x = mat.CreateColVector()
+        b = mat.CreateColVector()
+        b.FV().NumPy()[:] = f
+        x[:] = 0
+        with TaskManager():
+            pre.Smooth(x, b, steps=2)
+            pre.SmoothBack(x, b)
+        results.append(np.array(x.FV().NumPy()))
+
+    assert np.linalg.norm(results[0] - results[1].real) < 1e-10 * np.linalg.norm(results[0])
+    assert np.linalg.norm(results[1].imag) == 0
+
 
 if __name__ == "__main__":
     test_arnoldi()
@@ -40,3 +40,103 @@ def test_vector_numpy():
     assert d[0] == c[0]
     d[1] = 1+3j
     assert d[1] == c[1]
+
+def test_multivector():
+    np = pytest.importorskip("numpy")
+    n, m = 1000, 7
+    x = BaseVector(n)
+    mv = MultiVector(x, 0)
+    data = np.random.rand(m, n)
+    for i in range(m):
+        x.FV().NumPy()[:] = data[i]
+        mv.Append(x)              # grows storage, earlier vectors must survive
+        if i == 0:
+            first = mv[0]
+            view = first.FV().NumPy()
+    for i in range(m):
+        assert np.allclose(mv[i].FV().NumPy(), data[i])
+
+    ip = np.array(mv.InnerProduct(mv))
+    assert np.allclose(ip, data @ data.T)
+    assert np.array_equal(ip, np.array(mv.InnerProduct(mv)))   # reproducible
+    # vectors handed out before growing still are the components
+    view[:] = 2*data[0]
+    assert np.allclose(mv[0].FV().NumPy(), 2*data[0])
+    view[:] = data[0]
+    assert np.allclose(np.array(mv[2:5].InnerProduct(mv[0:3])), data[2:5] @ data[0:3].T)
+
+    coefs = np.random.rand(m, 3)
+    mat = Matrix(m, 3)
+    mat.NumPy()[:] = coefs
+    mv2 = MultiVector(x, 3)
+    mv2[:] = mv * mat
+    for j in range(3):
+        assert np.allclose(mv2[j].FV().NumPy(), data.T @ coefs[:,j])
+
+    y = x.CreateVector()
+    y.data = mv * Vector(list(coefs[:,0]))
+    assert np.allclose(y.FV().NumPy(), data.T @ coefs[:,0])
+
+def test_fused_vector_expression():
+    np = pytest.importorskip("numpy")
+    n = 5000
+    vecs = [BaseVector(n) for i in range(4)]
+    data = [np.random.rand(n) for i in range(4)]
+    for v, d in zip(vecs, data):
+        v.FV().NumPy()[:] = d
+    x, y, z, w = vecs
+    dx, dy, dz, dw = data
+
+    r = x.CreateVector()
+    r.data = 2*x - 3*(y + 0.5*z) + w
+    assert np.allclose(r.FV().NumPy(), 2*dx - 3*(dy + 0.5*dz) + dw)
+    r.data += x - y
+    assert np.allclose(r.FV().NumPy(), 3*dx - 4*dy - 1.5*dz + dw)
+    # the target may appear in the expression
+    r.data = 0.5*r - z
+    assert np.allclose(r.FV().NumPy(), 1.5*dx - 2*dy - 1.75*dz + 0.5*dw)
+    r.data = x - 2*r
+    assert np.allclose(r.FV().NumPy(), -2*dx + 4*dy + 3.5*dz - dw)
+    r.data += r + y
+    assert np.allclose(r.FV().NumPy(), -4*dx + 9*dy + 7*dz - 2*dw)
+
+    c = BaseVector(n, complex=True)
+    c.data = 1j*x + y
+    assert np.allclose(c.FV().NumPy(), 1j*dx + dy)
+
+def test_vector_pool():
+    from ngsolve.la import VectorPoolMemoryUsage
+    usage = lambda: { name : (nbytes, nblocks) for name, nbytes, nblocks in VectorPoolMemoryUsage() }
+    n = 12345
+    v = BaseVector(n)
+    v[:] = 1
+    del v
+    reused = usage()["VectorPool, reused"][1]
+    w = BaseVector(n)
+    assert usage()["VectorPool, reused"][1] == reused + 1
+    c = BaseVector(n, complex=True)
+    assert c.Norm() == 0
+
+    from ngsolve.la import ClearVectorPool
+    del w, c
+    ClearVectorPool()
+    assert usage()["VectorPool, cached"] == (0, 0)
+
+def test_vector_pickle():
+    import pickle
+    from ngsolve.la import VectorPoolMemoryUsage
+    inuse = lambda: [nbytes for name, nbytes, nblocks in VectorPoolMemoryUsage() if name == "VectorPool, in use"][0]
+    n = 1000
+    for is_complex in [False, True]:
+        v = BaseVector(n, complex=is_complex)
+        for i in range(n):
+            v[i] = i + (1j*i if is_complex else 0)
+        before = inuse()
+        w = pickle.loads(pickle.dumps(v))
+        # the unpickled vector owns its memory, and returns it on deletion
+        assert inuse() == before + v.FV().NumPy().nbytes
+        assert len(w) == n and w.is_complex == is_complex
+        w -= v
+        assert w.Norm() == 0
+        del w
+        assert inuse() == before